@@ -9,6 +9,8 @@
 #include <queue>
 #include <tuple>
 #include <filesystem>
+#include <algorithm>
+#include <cmath>
 
 #include <flags/flags.h>
 
@@ -227,6 +229,15 @@ int our::Application::run(int run_for_frames) {
         }
     }
 
+    // Start the job system that the states and systems can use to run work on the other cores.
+    // The number of workers can be set by "workers" in the app config (0 or missing means one per hardware thread).
+    jobSystem = std::make_unique<our::JobSystem>(app_config.value("workers", 0));
+
+    // Read the fixed step settings (a step that is not positive would never let the fixed updates catch up)
+    fixedTimeStep = app_config.value("fixed-time-step", fixedTimeStep);
+    if(fixedTimeStep <= 0.0) fixedTimeStep = 1.0 / 60.0;
+    maxFixedSteps = std::max(app_config.value("max-fixed-steps", maxFixedSteps), 1);
+
     // If a scene change was requested, apply it
     if(nextState) {
         currentState = nextState;
@@ -238,6 +249,8 @@ int our::Application::run(int run_for_frames) {
     // The time at which the last frame started. But there was no frames yet, so we'll just pick the current time.
     double last_frame_time = glfwGetTime();
     int current_frame = 0;
+    // The time that passed but wasn't simulated by a fixed update yet
+    double fixed_time_accumulator = 0.0;
 
     //Game loop
     //glClearColor(1,0,0,1);                  //!Clear is here :D
@@ -269,10 +282,25 @@ int our::Application::run(int run_for_frames) {
         // Get the current time (the time at which we are starting the current frame).
         double current_frame_time = glfwGetTime();
 
-        // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
-        if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
+        double frame_time = current_frame_time - last_frame_time;
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
 
+        // Run a fixed update for every whole step of time that passed, so the simulation doesn't depend on the frame rate
+        fixed_time_accumulator += frame_time;
+        int fixed_steps = 0;
+        while(fixed_time_accumulator >= fixedTimeStep && fixed_steps < maxFixedSteps){
+            if(currentState) currentState->onFixedUpdate(fixedTimeStep);
+            keyboard.fixedUpdate();
+            fixed_time_accumulator -= fixedTimeStep;
+            ++fixed_steps;
+        }
+        // If the frame was too long to catch up, the time we couldn't simulate is dropped (only the partial step is kept)
+        if(fixed_time_accumulator >= fixedTimeStep) fixed_time_accumulator = std::fmod(fixed_time_accumulator, fixedTimeStep);
+        interpolationFactor = (float)(fixed_time_accumulator / fixedTimeStep);
+
+        // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
+        if(currentState) currentState->onDraw(frame_time);
+
 #if defined(ENABLE_OPENGL_DEBUG_MESSAGES)
         // Since ImGui causes many messages to be thrown, we are temporarily disabling the debug messages till we render the ImGui
         glDisable(GL_DEBUG_OUTPUT);
@@ -323,6 +351,9 @@ int our::Application::run(int run_for_frames) {
             nextState = nullptr;
             // Initialize the new scene
             currentState->onInitialize(nextStateMessage);
+            // The new scene starts its simulation from scratch
+            fixed_time_accumulator = 0.0;
+            last_frame_time = glfwGetTime();
         }
 
         ++current_frame;
@@ -331,6 +362,9 @@ int our::Application::run(int run_for_frames) {
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
 
+    // Stop the worker threads now that no state can schedule jobs
+    jobSystem.reset();
+
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
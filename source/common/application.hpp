@@ -6,12 +6,14 @@
 #include <imgui.h>
 
 #include <string>
+#include <memory>
 #include <unordered_map>
 #include <type_traits>
 #include <json/json.hpp>
 
 #include "input/keyboard.hpp"
 #include "input/mouse.hpp"
+#include "jobs/job-system.hpp"
 
 namespace our {
 
@@ -33,6 +35,7 @@ namespace our {
     public:
         virtual void onInitialize(std::string){}        // Called once before the game loop.
         virtual void onImmediateGui(){}                 // Called every frame to draw the Immediate GUI (if any).
+        virtual void onFixedUpdate(double fixedDeltaTime){} // Called zero or more times per frame (before "onDraw") so that the simulation advances by the same step every time.
         virtual void onDraw(double deltaTime){}         // Called every frame in the game loop passing the time taken to draw the frame "Delta time".
         virtual void onDestroy(){}                      // Called once after the game loop ends for house cleaning.
 
@@ -58,6 +61,16 @@ namespace our {
         Mouse mouse;                        // Instance of "our" mouse class that handles mouse functionalities.
 
         nlohmann::json app_config;           // A Json file that contains all application configuration
+        std::string config_path;             // The path of the file from which "app_config" was read (empty if unknown)
+
+        std::unique_ptr<JobSystem> jobSystem; // The job system that runs work on the other cores. It lives as long as "run" is running.
+
+        // The simulation advances in fixed steps (see "State::onFixedUpdate"): the frame times are accumulated and a fixed update runs
+        // for every whole step in the accumulator. They can be set by "fixed-time-step" and "max-fixed-steps" in the app config.
+        double fixedTimeStep = 1.0 / 60.0;  // The time simulated by each fixed update (in seconds)
+        int maxFixedSteps = 5;              // The maximum number of fixed updates per frame. If a frame is too slow, the rest of its time is dropped
+                                            // instead of being simulated in the next frames, which would make them slower still (a spiral of death).
+        float interpolationFactor = 0.0f;   // The fraction of a fixed step that is left in the accumulator after the fixed updates of the frame
 
         std::unordered_map<std::string, State*> states;   // This will store all the states that the application can run
         State * currentState = nullptr;         // This will store the current scene that is being run
@@ -73,7 +86,8 @@ namespace our {
     public:
 
         // Create an application with following configuration
-        Application(const nlohmann::json& app_config) : app_config(app_config) {}
+        // The config path is optional. It is used to find the cooked copies of the scenes (see "ecs/cooked-scene.hpp")
+        Application(const nlohmann::json& app_config, std::string config_path = "") : app_config(app_config), config_path(std::move(config_path)) {}
         // On destruction, delete all the states
         ~Application(){ for (auto &it : states) delete it.second; }
 
@@ -119,6 +133,16 @@ namespace our {
         [[nodiscard]] const Mouse& getMouse() const { return mouse; }
 
         [[nodiscard]] const nlohmann::json& getConfig() const { return app_config; }
+        [[nodiscard]] const std::string& getConfigPath() const { return config_path; }
+
+        // Returns the time simulated by each fixed update (in seconds)
+        [[nodiscard]] double getFixedTimeStep() const { return fixedTimeStep; }
+        // Returns how far the current frame is between the last fixed update (0) and the next one (1).
+        // It is used to blend the transforms of the last two fixed updates when drawing (see "World::setInterpolationFactor").
+        [[nodiscard]] float getInterpolationFactor() const { return interpolationFactor; }
+
+        // The job system can only be used while the application is running (from the states and the systems they run)
+        JobSystem& getJobSystem() { return *jobSystem; }
 
         // Get the size of the frame buffer of the window in pixels.
         glm::ivec2 getFrameBufferSize() {
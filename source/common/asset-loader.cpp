@@ -8,6 +8,9 @@
 #include "mesh/mesh-utils.hpp"
 #include "material/material.hpp"
 #include "deserialize-utils.hpp"
+#include "json-stream.hpp"
+
+#include <fstream>
 
 namespace our {
 
@@ -65,12 +68,18 @@ namespace our {
     // This will load all the meshes defined in "data"
     // data must be in the form:
     //    { mesh_name : "path/to/3d-model-file", ... }
+    // or, to generate the simplified levels of detail of a mesh (see "mesh_utils::generateLODs"):
+    //    { mesh_name : { "path": "path/to/3d-model-file", "lods": true }, ... }
     template<>
     void AssetLoader<Mesh>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
-                std::string path = desc.get<std::string>();
-                assets[name] = mesh_utils::loadOBJ(path);
+                if(desc.is_object()){
+                    assets[name] = mesh_utils::loadOBJ(desc.value("path", ""), desc.value("lods", false));
+                } else {
+                    std::string path = desc.get<std::string>();
+                    assets[name] = mesh_utils::loadOBJ(path);
+                }
             }
         }
     };
@@ -113,6 +122,30 @@ namespace our {
             AssetLoader<Material>::deserialize(assetData["materials"]);
     }
 
+    void deserializeAllAssetsStreamed(std::istream& input, const std::string& pointer){
+        nlohmann::json materials;
+        parseJsonStreaming(input, {{pointer, [&materials](const std::string& type, nlohmann::json& data){
+            if(type == "materials"){
+                materials = std::move(data);
+                return;
+            }
+            nlohmann::json assets = nlohmann::json::object();
+            assets[type] = std::move(data);
+            deserializeAllAssets(assets);
+        }}}, false);
+        if(!materials.is_null())
+            AssetLoader<Material>::deserialize(materials);
+    }
+
+    void loadAllAssets(const nlohmann::json& assetData, const std::string& sourcePath, const std::string& pointer){
+        if(!assetData.is_null() || sourcePath.empty()){
+            deserializeAllAssets(assetData);
+            return;
+        }
+        std::ifstream file(sourcePath);
+        if(file) deserializeAllAssetsStreamed(file, pointer);
+    }
+
     void clearAllAssets(){
         AssetLoader<ShaderProgram>::clear();
         AssetLoader<Texture2D>::clear();
@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <string>
+#include <istream>
 #include <json/json.hpp>
 
 namespace our {
@@ -32,6 +33,14 @@ namespace our {
             }
             return nullptr;
         };
+        // This function returns the name of the given asset (or an empty string if it isn't held by this class)
+        // It is a linear search, so it should only be used when saving data (e.g. when cooking a scene)
+        static const std::string& getName(const T* asset) {
+            static const std::string none;
+            for(auto& [name, loaded] : assets)
+                if(loaded == asset) return name;
+            return none;
+        }
         // This function deletes all the assets held by this class and clear the assets map 
         static void clear(){
             for(auto& [name, asset] : assets){
@@ -46,6 +55,13 @@ namespace our {
     // For example, a json in the form {"shaders": ... , "textures": ... } will call "deserialize" for:
     // AssetLoader<ShaderProgram> and AssetLoader<Texture2D>
     void deserializeAllAssets(const nlohmann::json& assetData);
+    // This parses the json in "input" and loads the assets of the object found at the given JSON pointer (e.g. "/scene/assets").
+    // Each asset type is loaded as soon as the parser reaches its end, so the json of all the assets is never held at once.
+    // Only the materials wait for the end of the assets object since they depend on the shaders, textures and samplers.
+    void deserializeAllAssetsStreamed(std::istream& input, const std::string& pointer);
+    // Loads the assets of a scene. "assetData" is the "assets" object of the scene config.
+    // If it was left out of the config (it is null, see "main.cpp"), the assets are streamed from the config file at "sourcePath" instead.
+    void loadAllAssets(const nlohmann::json& assetData, const std::string& sourcePath, const std::string& pointer = "/scene/assets");
     // This will call "AssetLoader<T>::clear" for all the different asset types T
     void clearAllAssets();
 }
\ No newline at end of file
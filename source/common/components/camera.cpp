@@ -1,5 +1,6 @@
 #include "camera.hpp"
 #include "../ecs/entity.hpp"
+#include "../ecs/cooked-scene.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
 
@@ -19,10 +20,28 @@ namespace our {
         orthoHeight = data.value("orthoHeight", 1.0f);
     }
 
+    // Writes the camera parameters into a cooked scene
+    void CameraComponent::writeCooked(CookedWriter& writer) const {
+        writer.write(cameraType);
+        writer.write(near);
+        writer.write(far);
+        writer.write(fovY);
+        writer.write(orthoHeight);
+    }
+
+    // Reads the camera parameters from a cooked scene (the angles are already in radians)
+    void CameraComponent::readCooked(CookedReader& reader){
+        cameraType = reader.read<CameraType>();
+        near = reader.read<float>();
+        far = reader.read<float>();
+        fovY = reader.read<float>();
+        orthoHeight = reader.read<float>();
+    }
+
     // Creates and returns the camera view matrix
     glm::mat4 CameraComponent::getViewMatrix() const {
         auto owner = getOwner();
-        auto M = owner->getLocalToWorldMatrix();
+        auto M = owner->getInterpolatedLocalToWorldMatrix();
         //DONE: (Req 8) Complete this function
         //HINT:
         // In the camera space:
@@ -59,4 +78,14 @@ namespace our {
         const float l = -r;
         return glm::ortho(l, r, b, t, near, far);
     }
-}
\ No newline at end of file
+
+    // The point is moved to the normalized device coordinates, then its points on the near and far planes are moved back to the world space
+    void CameraComponent::getRay(glm::ivec2 viewportSize, glm::vec2 screenPoint, glm::vec3& origin, glm::vec3& direction) const {
+        glm::vec2 ndc(2.0f * screenPoint.x / viewportSize.x - 1.0f, 1.0f - 2.0f * screenPoint.y / viewportSize.y);
+        glm::mat4 inverseVP = glm::inverse(getProjectionMatrix(viewportSize) * getViewMatrix());
+        glm::vec4 nearPoint = inverseVP * glm::vec4(ndc, -1.0f, 1.0f);
+        glm::vec4 farPoint = inverseVP * glm::vec4(ndc, 1.0f, 1.0f);
+        origin = glm::vec3(nearPoint) / nearPoint.w;
+        direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+    }
+}
@@ -26,13 +26,22 @@ namespace our {
 
         // Reads camera parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes the camera parameters into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads the camera parameters from a cooked scene
+        void readCooked(CookedReader& reader) override;
 
-        // Creates and returns the camera view matrix
+        // Creates and returns the camera view matrix (from the drawn matrix of the owner, see "Entity::getInterpolatedLocalToWorldMatrix")
         glm::mat4 getViewMatrix() const;
         
         // Creates and returns the camera projection matrix
         // "viewportSize" is used to compute the aspect ratio
         glm::mat4 getProjectionMatrix(glm::ivec2 viewportSize) const;
+
+        // Computes the world space ray that goes through the given point of the screen (in pixels with the origin at the top left corner
+        // like the mouse position), so it can be given to "World::raycast" to find what is under the mouse.
+        // The ray starts on the near plane and "direction" is normalized.
+        void getRay(glm::ivec2 viewportSize, glm::vec2 screenPoint, glm::vec3& origin, glm::vec3& direction) const;
     };
 
 }
\ No newline at end of file
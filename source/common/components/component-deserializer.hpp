@@ -1,32 +1,49 @@
 #pragma once
 
-#include "../ecs/entity.hpp"
+#include "../ecs/world.hpp"
 #include "camera.hpp"
 #include "light.hpp"
 #include "mesh-renderer.hpp"
 #include "free-camera-controller.hpp"
 #include "movement.hpp"
+#include "occluder.hpp"
+
+#include <unordered_map>
+#include <cstdint>
 
 namespace our {
 
+    // A factory creates a component of a certain type in the given entity and returns it
+    typedef Component* (*ComponentFactory)(Entity*);
+
+    // Returns an entry for the component factory table. The key is the hash of the component type name returned by "T::getID()".
+    template<typename T>
+    std::pair<const std::uint64_t, ComponentFactory> registerComponent(){
+        return { hashComponentName(T::getID()), [](Entity* entity) -> Component* { return entity->addComponent<T>(); } };
+    }
+
+    // This table maps the hashed name of each component type to a factory that creates it.
+    //DONE: (Req 8) Add an option to deserialize a "MeshRendererComponent" to the following table
+    // When you create a new type of components, register it here so that it can be deserialized
+    inline const std::unordered_map<std::uint64_t, ComponentFactory> componentFactories = {
+        registerComponent<CameraComponent>(),
+        registerComponent<FreeCameraControllerComponent>(),
+        registerComponent<MovementComponent>(),
+        registerComponent<MeshRendererComponent>(),
+        registerComponent<LightComponent>(),
+        registerComponent<OccluderComponent>(),
+    };
+
     // Given a json object, this function picks and creates a component in the given entity
     // based on the "type" specified in the json object which is later deserialized from the rest of the json object
     inline void deserializeComponent(const nlohmann::json& data, Entity* entity){
-        std::string type = data.value("type", "");
-        Component* component = nullptr;
-        //DONE: (Req 8) Add an option to deserialize a "MeshRendererComponent" to the following if-else statement
-        if(type == CameraComponent::getID()){
-            component = entity->addComponent<CameraComponent>();
-        } else if (type == FreeCameraControllerComponent::getID()) {
-            component = entity->addComponent<FreeCameraControllerComponent>();
-        } else if (type == MovementComponent::getID()) {
-            component = entity->addComponent<MovementComponent>();
-        } else if (type == MeshRendererComponent::getID()) {
-            component = entity->addComponent<MeshRendererComponent>();
-        } else if (type == LightComponent::getID()) {
-            component = entity->addComponent<LightComponent>();
-        }
-        if(component) component->deserialize(data);
+        auto type = data.find("type");
+        if(type == data.end() || !type->is_string()) return;
+        // We hash the type name once and find its factory instead of comparing it against the name of every component type
+        auto factory = componentFactories.find(hashComponentName(type->get_ref<const std::string&>()));
+        if(factory == componentFactories.end()) return;
+        Component* component = factory->second(entity);
+        component->deserialize(data);
     }
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "free-camera-controller.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
+#include "../ecs/cooked-scene.hpp"
 
 namespace our {
     // Reads sensitivities & speedupFactor from the given json object
@@ -11,4 +12,20 @@ namespace our {
         positionSensitivity = data.value("positionSensitivity", positionSensitivity);
         speedupFactor = data.value("speedupFactor", speedupFactor);
     }
+
+    // Writes the sensitivities & speedupFactor into a cooked scene
+    void FreeCameraControllerComponent::writeCooked(CookedWriter& writer) const {
+        writer.write(rotationSensitivity);
+        writer.write(fovSensitivity);
+        writer.write(positionSensitivity);
+        writer.write(speedupFactor);
+    }
+
+    // Reads the sensitivities & speedupFactor from a cooked scene
+    void FreeCameraControllerComponent::readCooked(CookedReader& reader){
+        rotationSensitivity = reader.read<float>();
+        fovSensitivity = reader.read<float>();
+        positionSensitivity = reader.read<glm::vec3>();
+        speedupFactor = reader.read<float>();
+    }
 }
\ No newline at end of file
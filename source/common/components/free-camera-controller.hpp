@@ -24,6 +24,10 @@ namespace our {
 
         // Reads sensitivities & speedupFactor from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes the sensitivities & speedupFactor into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads the sensitivities & speedupFactor from a cooked scene
+        void readCooked(CookedReader& reader) override;
     };
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "light.hpp"
 #include "../deserialize-utils.hpp"
 #include "../ecs/entity.hpp"
+#include "../ecs/cooked-scene.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
 
@@ -27,17 +28,37 @@ namespace our {
         cone = data.value("cone", cone) * (glm::pi<float>() / 180);;
     }
 
+    // Writes the light parameters into a cooked scene
+    void LightComponent::writeCooked(CookedWriter& writer) const {
+        writer.write(lightType);
+        writer.write(diffuse);
+        writer.write(specular);
+        writer.write(ambient);
+        writer.write(attenuation);
+        writer.write(cone);
+    }
+
+    // Reads the light parameters from a cooked scene (the cone angles are already in radians)
+    void LightComponent::readCooked(CookedReader& reader){
+        lightType = reader.read<LightType>();
+        diffuse = reader.read<glm::vec3>();
+        specular = reader.read<glm::vec3>();
+        ambient = reader.read<glm::vec3>();
+        attenuation = reader.read<glm::vec3>();
+        cone = reader.read<glm::vec2>();
+    }
+
     //Get light position from owning entity
     glm::vec3 LightComponent::getPosition() const{
         auto owner = getOwner();
-        auto M = owner->getLocalToWorldMatrix();
+        auto M = owner->getInterpolatedLocalToWorldMatrix();
         return M * glm::vec4(0, 0, 0, 1);
     }
     
     //Get light direction from owning entity        
     glm::vec3 LightComponent::getDirection() const{
         auto owner = getOwner();
-        auto M = owner->getLocalToWorldMatrix();
+        auto M = owner->getInterpolatedLocalToWorldMatrix();
         return M * glm::vec4(0, -1, 0, 0);
     }
 }
\ No newline at end of file
@@ -31,6 +31,10 @@ namespace our {
 
         // Reads light parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes the light parameters into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads the light parameters from a cooked scene
+        void readCooked(CookedReader& reader) override;
 
         glm::vec3 getPosition() const;
 
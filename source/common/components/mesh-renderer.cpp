@@ -1,5 +1,6 @@
 #include "mesh-renderer.hpp"
 #include "../asset-loader.hpp"
+#include "../ecs/cooked-scene.hpp"
 
 namespace our {
     // Receives the mesh & material from the AssetLoader by the names given in the json object
@@ -14,4 +15,22 @@ namespace our {
         mesh = AssetLoader<Mesh>::get(data["mesh"].get<std::string>());
         material = AssetLoader<Material>::get(data["material"].get<std::string>());
     }
+
+    // Since the assets are loaded again every time, the cooked scene stores the names of the mesh & material instead of the pointers
+    void MeshRendererComponent::writeCooked(CookedWriter& writer) const {
+        writer.writeString(AssetLoader<Mesh>::getName(mesh));
+        writer.writeString(AssetLoader<Material>::getName(material));
+    }
+
+    // Receives the mesh & material from the AssetLoader by the names read from the cooked scene
+    void MeshRendererComponent::readCooked(CookedReader& reader){
+        mesh = AssetLoader<Mesh>::get(std::string(reader.readString()));
+        material = AssetLoader<Material>::get(std::string(reader.readString()));
+    }
+
+    bool MeshRendererComponent::getLocalBounds(AABB& bounds) const {
+        if(!mesh) return false;
+        bounds = mesh->getBounds();
+        return true;
+    }
 }
\ No newline at end of file
@@ -10,14 +10,22 @@ namespace our {
     // This component denotes that any renderer should draw the given mesh using the given material at the transformation of the owning entity.
     class MeshRendererComponent : public Component {
     public:
-        Mesh* mesh; // The mesh that should be drawn
-        Material* material; // The material used to draw the mesh
+        Mesh* mesh = nullptr; // The mesh that should be drawn
+        Material* material = nullptr; // The material used to draw the mesh
 
         // The ID of this component type is "Mesh Renderer"
         static std::string getID() { return "Mesh Renderer"; }
 
         // Receives the mesh & material from the AssetLoader by the names given in the json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes the names of the mesh & material into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads the names of the mesh & material from a cooked scene
+        void readCooked(CookedReader& reader) override;
+        // Returns the bounds of the mesh (false if there is no mesh)
+        bool getLocalBounds(AABB& bounds) const override;
+        // Returns the drawn mesh, so the ray and shape queries hit what is seen
+        const Mesh* getCollisionMesh() const override { return mesh; }
     };
 
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "movement.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
+#include "../ecs/cooked-scene.hpp"
 
 namespace our {
     // Reads linearVelocity & angularVelocity from the given json object
@@ -9,4 +10,16 @@ namespace our {
         linearVelocity = data.value("linearVelocity", linearVelocity);
         angularVelocity = glm::radians(data.value("angularVelocity", angularVelocity));
     }
+
+    // Writes linearVelocity & angularVelocity into a cooked scene
+    void MovementComponent::writeCooked(CookedWriter& writer) const {
+        writer.write(linearVelocity);
+        writer.write(angularVelocity);
+    }
+
+    // Reads linearVelocity & angularVelocity from a cooked scene (the angular velocity is already in radians)
+    void MovementComponent::readCooked(CookedReader& reader){
+        linearVelocity = reader.read<glm::vec3>();
+        angularVelocity = reader.read<glm::vec3>();
+    }
 }
\ No newline at end of file
@@ -20,6 +20,10 @@ namespace our {
 
         // Reads linearVelocity & angularVelocity from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes linearVelocity & angularVelocity into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads linearVelocity & angularVelocity from a cooked scene
+        void readCooked(CookedReader& reader) override;
     };
 
 }
\ No newline at end of file
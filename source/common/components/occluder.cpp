@@ -0,0 +1,29 @@
+#include "occluder.hpp"
+#include "mesh-renderer.hpp"
+#include "../asset-loader.hpp"
+#include "../ecs/entity.hpp"
+#include "../ecs/cooked-scene.hpp"
+
+namespace our {
+    // Receives the optional occluder mesh from the AssetLoader by the name given in the json object
+    void OccluderComponent::deserialize(const nlohmann::json& data){
+        if(!data.is_object()) return;
+        mesh = AssetLoader<Mesh>::get(data.value("mesh", ""));
+    }
+
+    // The cooked scene stores the name of the mesh (an empty name means that the owner's mesh is used)
+    void OccluderComponent::writeCooked(CookedWriter& writer) const {
+        writer.writeString(mesh ? AssetLoader<Mesh>::getName(mesh) : std::string());
+    }
+
+    // Receives the occluder mesh from the AssetLoader by the name read from the cooked scene
+    void OccluderComponent::readCooked(CookedReader& reader){
+        mesh = AssetLoader<Mesh>::get(std::string(reader.readString()));
+    }
+
+    Mesh* OccluderComponent::getOccluderMesh() const {
+        if(mesh) return mesh;
+        auto meshRenderer = getOwner()->getComponent<MeshRendererComponent>();
+        return meshRenderer ? meshRenderer->mesh : nullptr;
+    }
+}
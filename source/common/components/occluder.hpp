@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../ecs/component.hpp"
+#include "../mesh/mesh.hpp"
+
+namespace our {
+
+    // This component denotes that the owning entity is big enough to hide other entities behind it.
+    // The renderer draws the occluders into a small depth buffer on the CPU and skips the entities that are hidden by them
+    // (see "ForwardRenderer::render" and "OcclusionBuffer").
+    class OccluderComponent : public Component {
+    public:
+        // A simplified mesh drawn instead of the owner's mesh (it should be inside the owner's mesh so that it never hides a visible entity).
+        // If there is none, the mesh of the owner's mesh renderer is used.
+        Mesh* mesh = nullptr;
+
+        // The ID of this component type is "Occluder"
+        static std::string getID() { return "Occluder"; }
+
+        // Receives the optional occluder mesh from the AssetLoader by the name given in the json object
+        void deserialize(const nlohmann::json& data) override;
+        // Writes the name of the occluder mesh (empty if there is none) into a cooked scene
+        void writeCooked(CookedWriter& writer) const override;
+        // Reads the name of the occluder mesh from a cooked scene
+        void readCooked(CookedReader& reader) override;
+
+        // Returns the mesh to draw into the occlusion buffer (or nullptr if there is none)
+        Mesh* getOccluderMesh() const;
+    };
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "entity-handle.hpp"
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+    class Entity; // A forward declaration of the Entity Class
+
+    // A command buffer records structural changes to a world (creating or destroying entities and adding or removing components)
+    // so that they can be applied later at a known point of the frame instead of while the systems are iterating.
+    // Recording is guarded by a mutex, so systems running on different threads can record into the same buffer
+    // without touching the world's containers. The commands are applied in the order they were recorded by "World::playbackCommands".
+    class CommandBuffer {
+    public:
+        typedef std::function<void(World*)> Command;
+
+    private:
+        std::mutex mutex; // Guards "commands"
+        std::vector<Command> commands; // The recorded commands waiting for the playback
+
+        // Appends a command to the buffer
+        void record(Command command){
+            std::lock_guard<std::mutex> lock(mutex);
+            commands.push_back(std::move(command));
+        }
+
+    public:
+        CommandBuffer() = default;
+
+        // Records the creation of an entity. When the command is played back, the entity is added to the world and passed to "setup"
+        // (if given) so that it can be named and given its components.
+        void create(std::function<void(Entity*)> setup = nullptr);
+
+        // Records the destruction of the entity referred to by the handle. Nothing happens if the entity was already deleted by then.
+        void destroy(EntityHandle entity);
+
+        // Records adding a component of type T to the entity. When the command is played back, the new component is passed to "setup" (if given).
+        template<typename T>
+        void addComponent(EntityHandle entity, std::function<void(T*)> setup = nullptr);
+
+        // Records removing the component of type T from the entity (if it has one by then)
+        template<typename T>
+        void removeComponent(EntityHandle entity);
+
+        // Records an arbitrary change to the world
+        void custom(Command command){
+            record(std::move(command));
+        }
+
+        // Applies the recorded commands to the world and empties the buffer.
+        // Commands recorded by the commands themselves are also applied before this function returns.
+        // This must be called from the thread that owns the world while no system is iterating over it.
+        void playback(World* world){
+            std::vector<Command> pending;
+            while(true){
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if(commands.empty()) break;
+                    pending.swap(commands);
+                }
+                for(auto& command : pending) command(world);
+                pending.clear();
+            }
+        }
+
+        // Returns true if no commands are waiting for the playback
+        bool empty(){
+            std::lock_guard<std::mutex> lock(mutex);
+            return commands.empty();
+        }
+
+        // Drops the recorded commands without applying them
+        void clear(){
+            std::lock_guard<std::mutex> lock(mutex);
+            commands.clear();
+        }
+
+        // The buffer should not be copyable since it holds a mutex
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer &operator=(CommandBuffer const &) = delete;
+    };
+
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "component.hpp"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+namespace our {
+
+    // The type-erased functions that copy the data of a component type.
+    // They are used by "WorldSnapshot" to save and restore components without knowing their concrete types.
+    struct ComponentCopyFunctions {
+        size_t size; // The size of a component of this type
+        size_t alignment; // The alignment of a component of this type
+        void (*construct)(void* memory, const Component* source); // Constructs a copy of the component in the given memory
+        void (*assign)(Component* target, const void* copy); // Copies the data of a saved copy into a live component
+        void (*destroy)(void* copy); // Destroys a saved copy
+    };
+
+    // Returns the copy functions of the component type T (they are created once per type)
+    template<typename T>
+    const ComponentCopyFunctions& getComponentCopyFunctions() {
+        static_assert(std::is_copy_constructible<T>::value && std::is_copy_assignable<T>::value, "Components must be copyable to be saved in snapshots");
+        static const ComponentCopyFunctions functions{
+            sizeof(T), alignof(T),
+            [](void* memory, const Component* source){ new (memory) T(*static_cast<const T*>(source)); },
+            [](Component* target, const void* copy){ *static_cast<T*>(target) = *static_cast<const T*>(copy); },
+            [](void* copy){ static_cast<T*>(copy)->~T(); }
+        };
+        return functions;
+    }
+
+    // This is the type-erased interface of a component storage.
+    // It allows an entity to release one of its components without knowing the component's concrete type.
+    class ComponentStorageBase {
+    public:
+        // Constructs a new component inside the storage and returns a pointer to it
+        virtual Component* create() = 0;
+        // Calls the destructor of the given component and returns its slot to the storage
+        virtual void destroy(Component* component) = 0;
+        // Returns the number of live components in this storage
+        virtual size_t size() const = 0;
+        // Destroys all the live components at once. The chunks are kept so that refilling the storage doesn't allocate.
+        virtual void clear() = 0;
+        // Returns the functions that copy the data of the components held by this storage
+        virtual const ComponentCopyFunctions& getCopyFunctions() const = 0;
+        // Returns the hash of the type name of the components held by this storage (see "hashComponentName")
+        virtual std::uint64_t getNameHash() const = 0;
+        // Returns a new empty storage for the same component type (it is used to copy components into a world that has no storage for their type yet)
+        virtual std::unique_ptr<ComponentStorageBase> createEmpty() const = 0;
+        virtual ~ComponentStorageBase() = default;
+    };
+
+    // This class stores all the components of type T in fixed-size chunks.
+    // Components of the same type are laid out next to each other in memory, so iterating over all of them
+    // walks a few contiguous blocks instead of chasing a separately allocated heap node for every component.
+    // A chunk is never moved or reallocated, so a pointer to a component stays valid until the component is destroyed.
+    template<typename T>
+    class ComponentStorage : public ComponentStorageBase {
+    public:
+        // The number of components held by a single chunk (it matches the number of bits in the "alive" mask)
+        static constexpr size_t CHUNK_CAPACITY = 64;
+
+    private:
+        struct Chunk {
+            alignas(T) unsigned char data[CHUNK_CAPACITY * sizeof(T)]; // The raw memory of the components
+            std::uint64_t alive = 0; // Bit "i" is set if slot "i" currently holds a live component
+
+            T* at(size_t index) { return std::launder(reinterpret_cast<T*>(data + index * sizeof(T))); }
+            bool isAlive(size_t index) const { return (alive >> index) & 1u; }
+        };
+
+        std::vector<std::unique_ptr<Chunk>> chunks; // The chunks are individually allocated so that they never move
+        std::vector<size_t> freeSlots; // Slots that were released and can be reused by "create"
+        size_t highWaterMark = 0; // Every slot below this index has been used at least once
+        size_t count = 0; // The number of live components
+
+    public:
+        // This iterator walks over the live components in memory order and returns a pointer to each of them
+        class Iterator {
+            ComponentStorage* storage;
+            size_t slot;
+
+            // Skip the dead slots till we find a live one or reach the end
+            void skipDead(){
+                while(slot < storage->highWaterMark){
+                    const Chunk& chunk = *storage->chunks[slot / CHUNK_CAPACITY];
+                    if(chunk.alive == 0) { slot = (slot / CHUNK_CAPACITY + 1) * CHUNK_CAPACITY; continue; }
+                    if(chunk.isAlive(slot % CHUNK_CAPACITY)) return;
+                    ++slot;
+                }
+                slot = storage->highWaterMark;
+            }
+        public:
+            Iterator(ComponentStorage* storage, size_t slot) : storage(storage), slot(slot) { skipDead(); }
+            T* operator*() const { return storage->chunks[slot / CHUNK_CAPACITY]->at(slot % CHUNK_CAPACITY); }
+            Iterator& operator++() { ++slot; skipDead(); return *this; }
+            bool operator==(const Iterator& other) const { return slot == other.slot; }
+            bool operator!=(const Iterator& other) const { return slot != other.slot; }
+        };
+
+        ComponentStorage() = default;
+
+        // Constructs a new component of type T inside the storage and returns a pointer to it
+        T* create() override {
+            size_t slot;
+            if(!freeSlots.empty()){
+                slot = freeSlots.back();
+                freeSlots.pop_back();
+            } else {
+                slot = highWaterMark++;
+                if(slot / CHUNK_CAPACITY >= chunks.size()) chunks.push_back(std::make_unique<Chunk>());
+            }
+            Chunk& chunk = *chunks[slot / CHUNK_CAPACITY];
+            T* component = new (chunk.at(slot % CHUNK_CAPACITY)) T();
+            chunk.alive |= std::uint64_t(1) << (slot % CHUNK_CAPACITY);
+            component->storage = this;
+            component->slot = slot;
+            component->typeID = getComponentTypeID<T>();
+            ++count;
+            return component;
+        }
+
+        // Calls the destructor of the given component and marks its slot as free
+        void destroy(Component* component) override {
+            size_t slot = component->slot;
+            static_cast<T*>(component)->~T();
+            chunks[slot / CHUNK_CAPACITY]->alive &= ~(std::uint64_t(1) << (slot % CHUNK_CAPACITY));
+            freeSlots.push_back(slot);
+            --count;
+        }
+
+        size_t size() const override { return count; }
+
+        const ComponentCopyFunctions& getCopyFunctions() const override { return getComponentCopyFunctions<T>(); }
+
+        std::uint64_t getNameHash() const override {
+            static const std::uint64_t hash = hashComponentName(T::getID());
+            return hash;
+        }
+
+        std::unique_ptr<ComponentStorageBase> createEmpty() const override { return std::make_unique<ComponentStorage<T>>(); }
+
+        // Since every component is destroyed, we don't need to push the slots into the free list one by one.
+        // Instead, we reset the alive masks and the high water mark so that "create" refills the kept chunks from the start.
+        void clear() override {
+            for(size_t chunkIndex = 0; chunkIndex * CHUNK_CAPACITY < highWaterMark; ++chunkIndex){
+                Chunk& chunk = *chunks[chunkIndex];
+                if constexpr (!std::is_trivially_destructible<T>::value) {
+                    for(size_t index = 0; index < CHUNK_CAPACITY && (chunk.alive >> index); ++index)
+                        if(chunk.isAlive(index)) chunk.at(index)->~T();
+                }
+                chunk.alive = 0;
+            }
+            freeSlots.clear();
+            highWaterMark = 0;
+            count = 0;
+        }
+
+        Iterator begin() { return Iterator(this, 0); }
+        Iterator end() { return Iterator(this, highWaterMark); }
+
+        // Since the storage owns the memory of its components, any component that is still alive is destroyed with it
+        ~ComponentStorage() override {
+            for(size_t slot = 0; slot < highWaterMark; ++slot){
+                Chunk& chunk = *chunks[slot / CHUNK_CAPACITY];
+                if(chunk.isAlive(slot % CHUNK_CAPACITY)) chunk.at(slot % CHUNK_CAPACITY)->~T();
+            }
+        }
+
+        // The storage should not be copyable since the components point back to it
+        ComponentStorage(const ComponentStorage&) = delete;
+        ComponentStorage &operator=(ComponentStorage const &) = delete;
+    };
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+namespace our {
+
+    // Every component type gets a small dense integer ID the first time it is used.
+    // The IDs are used to index the component storages in the world and the component slots in each entity,
+    // and to build a bitmask of the component types owned by an entity.
+    typedef std::uint32_t ComponentTypeID;
+
+    // The maximum number of component types that can be used in the program (it is the size of the component bitmask)
+    constexpr ComponentTypeID MAX_COMPONENT_TYPES = 32;
+
+    // A set of component types where bit "i" is set if the component type whose ID is "i" is in the set
+    typedef std::bitset<MAX_COMPONENT_TYPES> ComponentMask;
+
+    namespace detail {
+        // Returns a new ID every time it is called. It is atomic since two types could get their IDs concurrently from different threads.
+        // The IDs are handed out at runtime, so the compiler can't check the limit. An ID past the limit would index past the end
+        // of the masks and of the storage arrays, so it stops the program in every build (not only when the asserts are enabled).
+        inline ComponentTypeID nextComponentTypeID() {
+            static std::atomic<ComponentTypeID> next{0};
+            ComponentTypeID id = next++;
+            if(id >= MAX_COMPONENT_TYPES){
+                std::fprintf(stderr, "Too many component types (the limit is %u), increase MAX_COMPONENT_TYPES\n", (unsigned)MAX_COMPONENT_TYPES);
+                std::abort();
+            }
+            return id;
+        }
+    }
+
+    // Returns the ID of the component type T.
+    // The ID is generated once per type (the static local is initialized on the first call), so after that it is just a load.
+    template<typename T>
+    ComponentTypeID getComponentTypeID() {
+        static const ComponentTypeID id = detail::nextComponentTypeID();
+        return id;
+    }
+
+    // Returns a mask containing the component types "Components..."
+    template<typename... Components>
+    ComponentMask makeComponentMask() {
+        ComponentMask mask;
+        (mask.set(getComponentTypeID<Components>()), ...);
+        return mask;
+    }
+
+    // A 64-bit FNV-1a hash of a component type name (e.g. "Mesh Renderer").
+    // It is used as the key of the component factory table so that deserialization doesn't compare strings one by one.
+    constexpr std::uint64_t hashComponentName(std::string_view name) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for(char c : name){
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+}
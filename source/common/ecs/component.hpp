@@ -1,29 +1,85 @@
 #pragma once
 
+#include "component-type.hpp"
+#include "../spatial/aabb.hpp"
 #include <json/json.hpp>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 namespace our {
 
     class Entity; // A forward declaration of the Entity Class
+    class ComponentStorageBase; // A forward declaration of the ComponentStorageBase Class
+    template<typename T> class ComponentStorage; // A forward declaration of the ComponentStorage Class
+    class World; // A forward declaration of the World Class
+    class CookedWriter; // A forward declaration of the CookedWriter Class
+    class CookedReader; // A forward declaration of the CookedReader Class
+    class Mesh; // A forward declaration of the Mesh Class
+
+    // A tick is a counter that the world increments once per frame (see "World::advanceTick").
+    // Components and component types remember the tick at which they last changed, so a system can tell what changed since it last looked.
+    typedef std::uint32_t Tick;
+
+    // The events that the world sends to the observers of a component type (see "World::observe")
+    enum class ComponentEvent {
+        ADDED,    // A component was added to an entity
+        REMOVED,  // A component is about to be removed (it is still valid while the observers are called)
+        MODIFIED  // A component was marked as changed by "Component::markChanged"
+    };
 
     // A component is a data container that can be added to an entity.
     // The role of the entity in the world is defined by the components it holds.
     // For example, an entity with a camera component specifies that this entity should be used as a camera
     // Thus any renderer system should look for an entity holding a camera component in order to compute the camera related uniforms (e.g. VP matrix)
     class Component {
-        Entity* owner; // A pointer to the entity that owns this component
+        Entity* owner = nullptr; // A pointer to the entity that owns this component
         friend Entity; // The entity is a friend since it is the only one allowed to set itself as an owner of a certain component.
+
+        ComponentStorageBase* storage = nullptr; // The storage (owned by the world) in which the memory of this component lives
+        size_t slot = 0; // The index of this component inside its storage
+        ComponentTypeID typeID = 0; // The ID of the concrete type of this component (see "component-type.hpp")
+        template<typename T> friend class ComponentStorage; // The storage is a friend since it is the only one allowed to place a component in a slot
+
+        Tick addedTick = 0; // The world tick at which this component was added
+        Tick changedTick = 0; // The world tick at which this component was added or last marked as changed
+        friend World; // The world is a friend since it sets the ticks
     public:
+        Component() = default;
+        // Copying a component only copies the data of the derived type (which is what "WorldSnapshot" saves and restores).
+        // The owner, the storage slot, the type and the ticks stay the ones of the component being assigned to.
+        Component(const Component&) {}
+        Component& operator=(const Component&) { return *this; }
+
         // This static method returns a unique string that identifies each type of components
-        // This ID will be used as the key to store a component into the entity's component map 
+        // The hash of this ID is the key used to find the factory of the component type in "component-deserializer.hpp"
         // When you create a new type of components, override this function to return a new unique ID
         static std::string getID() { return "Component"; }
         // Reads the data of the component from a json object
         // It is abstract since it must be overriden by derived components
         virtual void deserialize(const nlohmann::json& data) = 0;
+        // Writes the data of the component into a cooked scene (see "cooked-scene.hpp")
+        // It is abstract since every component type decides how its data is stored
+        virtual void writeCooked(CookedWriter& writer) const = 0;
+        // Reads the data written by "writeCooked" from a cooked scene
+        virtual void readCooked(CookedReader& reader) = 0;
+        // Returns the bounds of what this component occupies in the local space of its owner (e.g. the box around a mesh).
+        // It returns false if the component has no extent, which is the case for most component types.
+        virtual bool getLocalBounds(AABB&) const { return false; }
+        // Returns the mesh whose triangles (in the local space of the owner) are tested by the world's ray and shape queries
+        // (see "World::raycast"), or null if the component has no surface
+        virtual const Mesh* getCollisionMesh() const { return nullptr; }
         // Returns the owner of this component
         Entity* getOwner() const { return owner; }
+        // Returns the ID of the concrete type of this component
+        ComponentTypeID getTypeID() const { return typeID; }
+        // Returns the world tick at which this component was added
+        Tick getAddedTick() const { return addedTick; }
+        // Returns the world tick at which this component was added or last marked as changed
+        Tick getChangedTick() const { return changedTick; }
+        // Since the data members of the components are changed directly, a system that changes a component should call this function
+        // so that the world updates the change ticks and notifies the observers of MODIFIED events. It is defined in "world.hpp".
+        void markChanged();
         // Define a virtual destructor
         virtual ~Component(){}
     };
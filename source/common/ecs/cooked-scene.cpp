@@ -0,0 +1,217 @@
+#include "cooked-scene.hpp"
+#include "world.hpp"
+#include "../mapped-file.hpp"
+#include "../components/component-deserializer.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace our {
+
+    // This writes all the entities of the world and the data of their components into a cooked scene file
+    bool World::cook(const std::string& path, std::uint64_t sourceSize, std::uint64_t sourceHash){
+        std::vector<cooked::EntityRecord> entityRecords;
+        std::vector<std::uint32_t> tagIndices;
+        std::vector<cooked::ComponentRecord> componentRecords;
+        std::vector<unsigned char> data;
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, std::uint32_t> stringIndices;
+        CookedWriter writer(data, strings, stringIndices);
+
+        entityRecords.reserve(entities.size());
+        for(Entity* entity : entities){
+            cooked::EntityRecord record;
+            record.name = writer.addString(getNameString(entity->name));
+            // The records follow the order of "entities", so the index of the parent's record is the parent's dense index
+            record.parent = entity->parent ? (std::int32_t)entity->parent->denseIndex : -1;
+            record.localTransform = entity->localTransform;
+            record.firstTag = (std::uint32_t)tagIndices.size();
+            record.tagCount = (std::uint32_t)entity->tags.size();
+            for(NameID tag : entity->tags)
+                tagIndices.push_back(writer.addString(getNameString(tag)));
+            record.firstComponent = (std::uint32_t)componentRecords.size();
+            record.componentCount = (std::uint32_t)entity->components.size();
+            for(Component* component : entity->components){
+                std::uint64_t type = component->storage->getNameHash();
+                // A component that can't be created from its name couldn't be loaded back, so there is no point in cooking the scene
+                if(componentFactories.find(type) == componentFactories.end()) return false;
+                size_t offset = data.size();
+                component->writeCooked(writer);
+                componentRecords.push_back({type, (std::uint32_t)offset, (std::uint32_t)(data.size() - offset)});
+            }
+            entityRecords.push_back(record);
+        }
+
+        // The string table is the offset of every string (plus the end of the last one) followed by all the characters
+        std::vector<std::uint32_t> stringOffsets;
+        std::string characters;
+        for(auto& string : strings){
+            stringOffsets.push_back((std::uint32_t)characters.size());
+            characters += string;
+        }
+        stringOffsets.push_back((std::uint32_t)characters.size());
+
+        cooked::Header header;
+        header.magic = cooked::MAGIC;
+        header.version = cooked::VERSION;
+        header.entityCount = (std::uint32_t)entityRecords.size();
+        header.tagCount = (std::uint32_t)tagIndices.size();
+        header.componentCount = (std::uint32_t)componentRecords.size();
+        header.stringCount = (std::uint32_t)strings.size();
+        header.dataSize = (std::uint32_t)data.size();
+        header.stringSize = (std::uint32_t)characters.size();
+        header.sourceSize = sourceSize;
+        header.sourceHash = sourceHash;
+
+        // The file is written under a temporary name then renamed, so a half written file is never loaded
+        std::string temporaryPath = path + ".tmp";
+        {
+            std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+            if(!file) return false;
+            // Writes an array then pads it with zeros so that the next array starts at a multiple of 8
+            auto writeArray = [&file](const void* bytes, size_t size){
+                static const char padding[8] = {};
+                if(size) file.write(static_cast<const char*>(bytes), (std::streamsize)size);
+                file.write(padding, (std::streamsize)(cooked::align(size) - size));
+            };
+            writeArray(&header, sizeof(header));
+            writeArray(entityRecords.data(), entityRecords.size() * sizeof(cooked::EntityRecord));
+            writeArray(tagIndices.data(), tagIndices.size() * sizeof(std::uint32_t));
+            writeArray(componentRecords.data(), componentRecords.size() * sizeof(cooked::ComponentRecord));
+            writeArray(data.data(), data.size());
+            writeArray(stringOffsets.data(), stringOffsets.size() * sizeof(std::uint32_t));
+            writeArray(characters.data(), characters.size());
+            if(!file) return false;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if(error) std::filesystem::remove(temporaryPath, error);
+        return !error;
+    }
+
+    // This adds the entities of a cooked scene file to the world
+    bool World::deserializeCooked(const std::string& path, std::uint64_t sourceSize, std::uint64_t sourceHash){
+        MappedFile file;
+        if(!file.open(path) || file.size() < sizeof(cooked::Header)) return false;
+        const unsigned char* bytes = file.data();
+        cooked::Header header;
+        std::memcpy(&header, bytes, sizeof(header));
+        if(header.magic != cooked::MAGIC || header.version != cooked::VERSION) return false;
+        if(header.sourceSize != sourceSize || header.sourceHash != sourceHash) return false;
+
+        // The offsets of the arrays (the counts are 32 bits, so these can't overflow)
+        std::uint64_t entitiesOffset = cooked::align(sizeof(cooked::Header));
+        std::uint64_t tagsOffset = entitiesOffset + cooked::align((std::uint64_t)header.entityCount * sizeof(cooked::EntityRecord));
+        std::uint64_t componentsOffset = tagsOffset + cooked::align((std::uint64_t)header.tagCount * sizeof(std::uint32_t));
+        std::uint64_t dataOffset = componentsOffset + cooked::align((std::uint64_t)header.componentCount * sizeof(cooked::ComponentRecord));
+        std::uint64_t stringOffsetsOffset = dataOffset + cooked::align(header.dataSize);
+        std::uint64_t charactersOffset = stringOffsetsOffset + cooked::align(((std::uint64_t)header.stringCount + 1) * sizeof(std::uint32_t));
+        if(charactersOffset + header.stringSize > file.size()) return false;
+
+        // The records of each array are copied out of the file with a single copy since the mapped memory is not guaranteed to be aligned for them.
+        // The component data can't be copied that way since the components hold pointers (to assets, strings, ...), so each component reads its own.
+        std::vector<cooked::EntityRecord> entityRecords(header.entityCount);
+        std::vector<std::uint32_t> tagIndices(header.tagCount);
+        std::vector<cooked::ComponentRecord> componentRecords(header.componentCount);
+        std::vector<std::uint32_t> stringOffsets((size_t)header.stringCount + 1);
+        auto copyArray = [bytes](auto& array, std::uint64_t offset){
+            if(!array.empty()) std::memcpy(array.data(), bytes + offset, array.size() * sizeof(array[0]));
+        };
+        copyArray(entityRecords, entitiesOffset);
+        copyArray(tagIndices, tagsOffset);
+        copyArray(componentRecords, componentsOffset);
+        copyArray(stringOffsets, stringOffsetsOffset);
+
+        // The strings point into the mapped file. Each of them is interned once, then the names and the tags refer to them by index.
+        const char* characters = reinterpret_cast<const char*>(bytes + charactersOffset);
+        std::vector<std::string_view> strings(header.stringCount);
+        std::vector<NameID> names(header.stringCount);
+        for(std::uint32_t index = 0; index < header.stringCount; ++index){
+            std::uint32_t begin = stringOffsets[index], end = stringOffsets[index + 1];
+            if(begin > end || end > header.stringSize) return false;
+            strings[index] = std::string_view(characters + begin, end - begin);
+            names[index] = internName(strings[index]);
+        }
+
+        // Everything is checked before the first entity is added, so a bad file doesn't leave half a scene in the world
+        std::vector<ComponentFactory> factories(header.componentCount);
+        for(std::uint32_t index = 0; index < header.componentCount; ++index){
+            const cooked::ComponentRecord& record = componentRecords[index];
+            auto factory = componentFactories.find(record.type);
+            if(factory == componentFactories.end() || (std::uint64_t)record.offset + record.size > header.dataSize) return false;
+            factories[index] = factory->second;
+        }
+        for(std::uint32_t tag : tagIndices)
+            if(tag >= header.stringCount) return false;
+        for(const cooked::EntityRecord& record : entityRecords){
+            if(record.name >= header.stringCount || record.parent < -1 || record.parent >= (std::int64_t)header.entityCount) return false;
+            if((std::uint64_t)record.firstTag + record.tagCount > header.tagCount) return false;
+            if((std::uint64_t)record.firstComponent + record.componentCount > header.componentCount) return false;
+        }
+
+        size_t first = entities.size();
+        for(const cooked::EntityRecord& record : entityRecords){
+            Entity* entity = add();
+            entity->setName(names[record.name]);
+            for(std::uint32_t tag = 0; tag < record.tagCount; ++tag)
+                entity->addTag(names[tagIndices[record.firstTag + tag]]);
+            entity->localTransform = record.localTransform;
+            for(std::uint32_t component = record.firstComponent; component < record.firstComponent + record.componentCount; ++component){
+                const cooked::ComponentRecord& componentRecord = componentRecords[component];
+                CookedReader reader(bytes + dataOffset + componentRecord.offset, componentRecord.size, strings.data(), header.stringCount);
+                factories[component](entity)->readCooked(reader);
+            }
+        }
+        // The parents are set once all the entities exist since a parent could come after its children
+        for(std::uint32_t index = 0; index < header.entityCount; ++index){
+            std::int32_t parent = entityRecords[index].parent;
+            if(parent >= 0) entities[first + index]->setParent(entities[first + parent]);
+        }
+        return true;
+    }
+
+    std::string cooked::getCachePath(const std::string& sourcePath){
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::absolute(sourcePath, error);
+        if(error) path = sourcePath;
+        std::string fullPath = path.lexically_normal().generic_string();
+        std::uint64_t hash = hashBytes(reinterpret_cast<const unsigned char*>(fullPath.data()), fullPath.size());
+        char suffix[20];
+        std::snprintf(suffix, sizeof(suffix), "-%016llx", (unsigned long long)hash);
+        return (std::filesystem::path(CACHE_DIRECTORY) / (path.filename().string() + suffix + ".cooked")).string();
+    }
+
+    // Adds the entities of a scene to the world from its cooked copy if it is up to date, otherwise from the json
+    void loadWorld(World& world, const nlohmann::json& data, const std::string& sourcePath, const std::string& pointer){
+        if(sourcePath.empty()){
+            world.deserialize(data);
+            return;
+        }
+        // The config is hashed to check that the cooked copy is up to date. It is mapped, so hashing it is a single pass over the bytes
+        // (which is still much cheaper than parsing it as json).
+        std::uint64_t sourceSize = 0, sourceHash = cooked::hashBytes(nullptr, 0);
+        bool sourceFound = std::filesystem::exists(sourcePath);
+        if(MappedFile source; source.open(sourcePath)){
+            sourceSize = source.size();
+            sourceHash = cooked::hashBytes(source.data(), source.size());
+        }
+        std::string cookedPath = cooked::getCachePath(sourcePath);
+        if(sourceFound && world.deserializeCooked(cookedPath, sourceSize, sourceHash)) return;
+        // The cooked scene is missing, stale or unreadable, so we walk the json and cook the result for the next time.
+        // If the world already had entities, they would end up in the cooked file too, so we only cook into an empty world.
+        bool wasEmpty = world.getEntities().empty();
+        if(data.is_null()){
+            std::ifstream file(sourcePath);
+            if(!file) return;
+            world.deserializeStreamed(file, pointer);
+        } else {
+            world.deserialize(data);
+        }
+        if(!wasEmpty || !sourceFound) return;
+        std::error_code error;
+        std::filesystem::create_directories(cooked::CACHE_DIRECTORY, error);
+        if(!error) world.cook(cookedPath, sourceSize, sourceHash);
+    }
+
+}
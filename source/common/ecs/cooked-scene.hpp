@@ -0,0 +1,137 @@
+#pragma once
+
+#include "transform.hpp"
+
+#include <json/json.hpp>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+
+    // A cooked scene is a binary copy of a deserialized world (see "World::cook" and "World::deserializeCooked").
+    // Instead of a tree of json objects looked up by key, it is made of flat arrays that are read in place from a memory mapped file:
+    //  - A header holding the size of each array
+    //  - The entity records (in the order of the world's entities)
+    //  - The tags of all the entities (as indices into the string table)
+    //  - The component records (the hashed type name of each component and the range of its data)
+    //  - The data of all the components (written by "Component::writeCooked")
+    //  - The string table (the offset of each string followed by the characters of all the strings)
+    // Every array starts at an offset that is a multiple of 8. The file is only meant to be read on the machine that cooked it.
+    // The header also holds the size and the hash of the config file the scene was cooked from, so an edited config is detected
+    // even if its modification time didn't change (or went back, e.g. after a checkout).
+    namespace cooked {
+        constexpr std::uint32_t MAGIC = 0x4e43534f; // "OSCN" in little endian
+        constexpr std::uint32_t VERSION = 2; // Increment this whenever the layout or the data written by a component changes
+        constexpr const char* CACHE_DIRECTORY = "cache/cooked"; // The cooked scenes are written here instead of next to the config files
+
+        struct Header {
+            std::uint32_t magic, version;
+            std::uint32_t entityCount, tagCount, componentCount, stringCount;
+            std::uint32_t dataSize, stringSize; // The size of the component data and of the characters of the string table (in bytes)
+            std::uint64_t sourceSize, sourceHash; // The size (in bytes) and the hash of the content of the config file
+        };
+
+        struct EntityRecord {
+            std::uint32_t name; // The index of the name in the string table
+            std::int32_t parent; // The index of the parent's record (or -1 if the entity is a root entity)
+            Transform localTransform;
+            std::uint32_t firstTag, tagCount;
+            std::uint32_t firstComponent, componentCount;
+        };
+
+        struct ComponentRecord {
+            std::uint64_t type; // The hash of the component type name (the key of its factory in "componentFactories")
+            std::uint32_t offset, size; // The range of the component data
+        };
+
+        static_assert(std::is_trivially_copyable<EntityRecord>::value, "The records are copied byte by byte");
+
+        // Rounds the size up to a multiple of 8 so that the next array is aligned
+        constexpr size_t align(size_t size) { return (size + 7) & ~size_t(7); }
+
+        // A 64-bit FNV-1a hash of the given bytes (it is used to detect that a config file changed since it was cooked)
+        inline std::uint64_t hashBytes(const unsigned char* bytes, size_t size, std::uint64_t hash = 14695981039346656037ull) {
+            for(size_t index = 0; index < size; ++index){
+                hash ^= bytes[index];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        // Returns the path of the cooked copy of the given config file inside "CACHE_DIRECTORY".
+        // The name of the config is kept to make the cache readable, and the hash of its full path tells apart configs with the same name.
+        std::string getCachePath(const std::string& sourcePath);
+    }
+
+    // A cooked writer appends the data of a component to a cooked scene.
+    // Plain values (numbers, enums, glm vectors) are written as they are in memory and strings are written as indices into the string table.
+    class CookedWriter {
+        std::vector<unsigned char>& bytes; // The component data of the scene
+        std::vector<std::string>& strings; // The string table of the scene
+        std::unordered_map<std::string, std::uint32_t>& stringIndices; // The index of each string in the table
+    public:
+        CookedWriter(std::vector<unsigned char>& bytes, std::vector<std::string>& strings, std::unordered_map<std::string, std::uint32_t>& stringIndices)
+            : bytes(bytes), strings(strings), stringIndices(stringIndices) {}
+
+        template<typename T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written directly");
+            const auto* source = reinterpret_cast<const unsigned char*>(&value);
+            bytes.insert(bytes.end(), source, source + sizeof(T));
+        }
+
+        // Adds the string to the string table (if it isn't there already) and writes its index
+        void writeString(std::string_view string) {
+            write(addString(string));
+        }
+
+        // Returns the index of the string in the string table (it is added if it isn't there already)
+        std::uint32_t addString(std::string_view string) {
+            auto [it, inserted] = stringIndices.emplace(std::string(string), (std::uint32_t)strings.size());
+            if(inserted) strings.emplace_back(string);
+            return it->second;
+        }
+    };
+
+    // A cooked reader reads the data written by a cooked writer directly from the mapped file.
+    // Reading past the end of the component's data returns zeros instead of reading another component's data.
+    class CookedReader {
+        const unsigned char* cursor; // The next byte to read
+        const unsigned char* end; // The end of the component's data
+        const std::string_view* strings; // The string table of the scene
+        std::uint32_t stringCount;
+    public:
+        CookedReader(const unsigned char* data, size_t size, const std::string_view* strings, std::uint32_t stringCount)
+            : cursor(data), end(data + size), strings(strings), stringCount(stringCount) {}
+
+        template<typename T>
+        T read() {
+            static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read directly");
+            T value{};
+            if((size_t)(end - cursor) < sizeof(T)) { cursor = end; return value; }
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+
+        // Reads a string index and returns the string (it points into the mapped file, so it must be copied if it is kept)
+        std::string_view readString() {
+            std::uint32_t index = read<std::uint32_t>();
+            return index < stringCount ? strings[index] : std::string_view();
+        }
+    };
+
+    // Adds the entities of a scene to the world. "data" is the json array of the entities and "sourcePath" is the path of the config file it came from.
+    // If the cooked copy of the scene (see "cooked::getCachePath") exists and was cooked from the same content as the config file, it is loaded instead of the json.
+    // Otherwise, the json is deserialized and the world is cooked into that file so that the next load is fast.
+    // If "data" is null since the entities were left out of the config (see "main.cpp"), they are streamed from the array at "pointer" in the config file.
+    void loadWorld(World& world, const nlohmann::json& data, const std::string& sourcePath, const std::string& pointer = "/scene/world");
+
+}
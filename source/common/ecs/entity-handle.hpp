@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+namespace our {
+
+    // An entity handle is a 32-bit reference to an entity that can be safely kept across frames.
+    // The low bits hold the index of the entity's slot in the world's entity pool and the high bits hold the generation of that slot.
+    // Every time a slot is freed, its generation is incremented, so a handle to a deleted entity no longer matches its slot
+    // and "World::get" returns null for it instead of a dangling pointer.
+    struct EntityHandle {
+        static constexpr std::uint32_t INDEX_BITS = 20; // Up to ~1 million live entities
+        static constexpr std::uint32_t GENERATION_BITS = 32 - INDEX_BITS; // A slot can be reused 4096 times before a generation repeats
+        static constexpr std::uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+        static constexpr std::uint32_t GENERATION_MASK = (1u << GENERATION_BITS) - 1;
+        static constexpr std::uint32_t NULL_VALUE = 0xFFFFFFFFu; // A handle that never refers to an entity
+
+        std::uint32_t value = NULL_VALUE;
+
+        EntityHandle() = default;
+        EntityHandle(std::uint32_t index, std::uint32_t generation) :
+            value((index & INDEX_MASK) | ((generation & GENERATION_MASK) << INDEX_BITS)) {}
+
+        std::uint32_t getIndex() const { return value & INDEX_MASK; }
+        std::uint32_t getGeneration() const { return value >> INDEX_BITS; }
+        bool isNull() const { return value == NULL_VALUE; }
+        explicit operator bool() const { return !isNull(); }
+
+        bool operator==(const EntityHandle& other) const { return value == other.value; }
+        bool operator!=(const EntityHandle& other) const { return value != other.value; }
+    };
+
+}
+
+// We define a hash function for EntityHandle so that it can be used as a key in unordered maps
+namespace std {
+    template<> struct hash<our::EntityHandle> {
+        size_t operator()(our::EntityHandle const& handle) const {
+            return hash<std::uint32_t>()(handle.value);
+        }
+    };
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "entity.hpp"
+#include "entity-handle.hpp"
+
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <new>
+
+namespace our {
+
+    // This class allocates the entities of a world from fixed-size slabs instead of calling "new" for each entity.
+    // Freed slots are recycled through a free list, so spawning and despawning entities at a steady rate does not touch the heap.
+    // An entity is constructed the first time its slot is used and is only reset (not destroyed) when it is released,
+    // so the memory of its containers (components, children, tags) is kept and reused by the next entity in the slot.
+    // Each slot has a generation that is incremented when the slot is freed, which is what makes stale EntityHandles detectable.
+    class EntityPool {
+    public:
+        // The number of entities held by a single slab
+        static constexpr std::uint32_t SLAB_CAPACITY = 256;
+
+    private:
+        struct Slab {
+            alignas(Entity) unsigned char data[SLAB_CAPACITY * sizeof(Entity)]; // The raw memory of the entities
+
+            Entity* at(std::uint32_t index) { return std::launder(reinterpret_cast<Entity*>(data + index * sizeof(Entity))); }
+        };
+
+        std::vector<std::unique_ptr<Slab>> slabs; // The slabs are individually allocated so that they never move
+        std::vector<std::uint32_t> generations; // The current generation of every slot
+        std::vector<bool> alive; // Whether each slot currently holds a live entity
+        std::vector<std::uint32_t> freeSlots; // Slots that were released and can be reused
+
+        Entity* slot(std::uint32_t index) { return slabs[index / SLAB_CAPACITY]->at(index % SLAB_CAPACITY); }
+
+        // Marks the slot as free and makes the handles that refer to it stale
+        void release(std::uint32_t index){
+            alive[index] = false;
+            generations[index] = (generations[index] + 1) & EntityHandle::GENERATION_MASK;
+            freeSlots.push_back(index);
+        }
+
+    public:
+        EntityPool() = default;
+
+        // Returns a new entity from a free slot (or a new slot if there are no free ones). The handle of the new entity is stored in it.
+        Entity* create(){
+            std::uint32_t index;
+            Entity* entity;
+            if(!freeSlots.empty()){
+                index = freeSlots.back();
+                freeSlots.pop_back();
+                entity = slot(index); // The entity in a free slot was already reset when it was released
+            } else {
+                index = (std::uint32_t)generations.size();
+                // The last index is reserved so that a valid handle can never be equal to the null handle
+                assert(index < EntityHandle::INDEX_MASK && "Too many entities for the handle index bits");
+                if(index / SLAB_CAPACITY >= slabs.size()) slabs.push_back(std::make_unique<Slab>());
+                generations.push_back(0);
+                alive.push_back(false);
+                entity = new (slot(index)) Entity();
+            }
+            entity->handle = EntityHandle(index, generations[index]);
+            alive[index] = true;
+            return entity;
+        }
+
+        // Resets the given entity (releasing its components) and frees its slot. Any handle that refers to it becomes stale.
+        void destroy(Entity* entity){
+            entity->reset(true);
+            release(entity->handle.getIndex());
+        }
+
+        // Resets and frees every live entity. The components are not released one by one since the caller is expected
+        // to clear the component storages as a whole (see "World::clear").
+        void clear(){
+            freeSlots.clear();
+            // The slots are freed from the last to the first so that the next entities are created in the order of the slots
+            for(std::uint32_t index = (std::uint32_t)generations.size(); index-- > 0;){
+                if(alive[index]){
+                    slot(index)->reset(false);
+                    alive[index] = false;
+                    generations[index] = (generations[index] + 1) & EntityHandle::GENERATION_MASK;
+                }
+                freeSlots.push_back(index);
+            }
+        }
+
+        // Returns the number of slots ever used (it is an upper bound for the handle indices of the live entities)
+        std::uint32_t capacity() const { return (std::uint32_t)generations.size(); }
+
+        // The entities that were constructed in the slots are destroyed with the pool
+        ~EntityPool(){
+            for(std::uint32_t index = 0; index < generations.size(); ++index)
+                slot(index)->~Entity();
+        }
+
+        // Returns the entity referred to by the handle or null if the handle is null or stale
+        Entity* get(EntityHandle handle){
+            if(handle.isNull()) return nullptr;
+            std::uint32_t index = handle.getIndex();
+            if(index >= generations.size() || !alive[index] || generations[index] != handle.getGeneration()) return nullptr;
+            return slot(index);
+        }
+
+        // The pool should not be copyable since it owns the entities' memory
+        EntityPool(const EntityPool&) = delete;
+        EntityPool &operator=(EntityPool const &) = delete;
+    };
+
+}
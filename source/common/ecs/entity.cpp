@@ -1,8 +1,11 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
 #include <glm/gtx/euler_angles.hpp>
+#include <algorithm>
+#include <cassert>
 
 namespace our {
 
@@ -10,17 +13,132 @@ namespace our {
     // Remember that you can get the transformation matrix from this entity to its parent from "localTransform"
     // To get the local to world matrix, you need to combine this entities matrix with its parent's matrix and
     // its parent's parent's matrix and so on till you reach the root.
-    glm::mat4 Entity::getLocalToWorldMatrix() const {
+    // The hierarchy computes every matrix in its batched update, so the chain is only walked for the entities whose cache was invalidated.
+    const glm::mat4& Entity::getLocalToWorldMatrix() const {
         //DONE: (Req 8) Write this function
-        if (!parent)
-            return localTransform.toMat4();
-        return parent->getLocalToWorldMatrix() * localTransform.toMat4();
+        if (worldMatrixValid) return cachedWorldMatrix;
+        cachedLocalTransform = localTransform;
+        cachedLocalMatrix = localTransform.toMat4();
+        // The parent's matrix is either cached or computed the same way (so only the invalid part of the chain is walked)
+        cachedWorldMatrix = parent ? parent->getLocalToWorldMatrix() * cachedLocalMatrix : cachedLocalMatrix;
+        worldMatrixValid = true;
+        ++worldMatrixVersion;
+        return cachedWorldMatrix;
+    }
+
+    // The matrices are blended component by component, which is close enough to blending the transforms
+    // for the small moves and rotations between two fixed updates
+    glm::mat4 Entity::getInterpolatedLocalToWorldMatrix() const {
+        const glm::mat4& current = getLocalToWorldMatrix();
+        if (!isInterpolated()) return current;
+        float factor = world->getInterpolationFactor();
+        return previousWorldMatrix * (1.0f - factor) + current * factor;
+    }
+
+    // The bounds of the components are merged in the local space, so only one box is transformed
+    bool Entity::getLocalBounds(AABB& bounds) const {
+        bounds = AABB();
+        bool found = false;
+        for(const Component* component : components){
+            AABB componentBounds;
+            if(component->getLocalBounds(componentBounds)){
+                bounds.expand(componentBounds);
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    bool Entity::getWorldBounds(AABB& bounds) const {
+        if(!getLocalBounds(bounds)) return false;
+        bounds = bounds.transformed(getLocalToWorldMatrix());
+        return true;
+    }
+
+    // Puts the entity back in the state of a new entity while keeping the memory of its containers
+    void Entity::reset(bool releaseComponents){
+        if(releaseComponents)
+            for(Component* component : components){
+                world->notify(component, ComponentEvent::REMOVED);
+                releaseComponent(component);
+            }
+        components.clear();
+        componentsByType.fill(nullptr);
+        componentMask.reset();
+        parent = nullptr;
+        children.clear();
+        name = EMPTY_NAME;
+        tags.clear();
+        localTransform = Transform();
+        interpolates = false;
+        // The version keeps increasing so that a system that cached the version of the previous entity in this slot sees a change
+        worldMatrixValid = false;
+        ++worldMatrixVersion;
+        markedForRemoval = false;
+    }
+
+    // Changes the parent of this entity and keeps the children lists and the world's transform hierarchy up to date
+    void Entity::setParent(Entity* newParent){
+        if(newParent == parent) return;
+        assert((!newParent || newParent->world == world) && "The parent must belong to the same world");
+        for(Entity* ancestor = newParent; ancestor; ancestor = ancestor->parent)
+            assert(ancestor != this && "An entity can't be parented to itself or to one of its descendants");
+        if(parent){
+            auto& siblings = parent->children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+        }
+        parent = newParent;
+        if(parent) parent->children.push_back(this);
+        invalidateWorldMatrices();
+        world->transforms.markDirty();
+    }
+
+    // Changes the name of this entity and moves it to the right list in the world's name index
+    void Entity::setName(NameID newName){
+        if(newName == name) return;
+        world->unindexEntity(world->entitiesByName, name, this);
+        name = newName;
+        world->indexEntity(world->entitiesByName, name, this);
+        ++world->nameVersion;
+    }
+
+    bool Entity::hasTag(NameID tag) const {
+        return std::find(tags.begin(), tags.end(), tag) != tags.end();
+    }
+
+    // Adds the tag and adds this entity to the world's tag index
+    void Entity::addTag(NameID tag){
+        if(tag == EMPTY_NAME || hasTag(tag)) return;
+        tags.push_back(tag);
+        world->indexEntity(world->entitiesByTag, tag, this);
+    }
+
+    // Removes the tag and removes this entity from the world's tag index
+    void Entity::removeTag(NameID tag){
+        auto it = std::find(tags.begin(), tags.end(), tag);
+        if(it == tags.end()) return;
+        tags.erase(it);
+        world->unindexEntity(world->entitiesByTag, tag, this);
+    }
+
+    // Notifies the world that a component of the given type was added to or removed from this entity,
+    // so that the cached views are kept up to date
+    void Entity::componentsChanged(ComponentTypeID typeID){
+        world->refreshQueries(this, typeID);
+    }
+
+    // Notifies the observers of the world that the given component is about to be removed
+    void Entity::componentRemoving(Component* component){
+        world->notify(component, ComponentEvent::REMOVED);
     }
 
     // Deserializes the entity data and components from a json object
     void Entity::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
-        name = data.value("name", name);
+        if(data.contains("name")) setName(data["name"].get<std::string>());
+        if(const auto it = data.find("tags"); it != data.end() && it->is_array()){
+            for(const auto& tag : *it) addTag(internName(tag.get<std::string>()));
+        }
         localTransform.deserialize(data);
         if(data.contains("components")){
             if(const auto& components = data["components"]; components.is_array()){
@@ -1,55 +1,185 @@
 #pragma once
 
 #include "component.hpp"
+#include "component-storage.hpp"
+#include "entity-handle.hpp"
+#include "name.hpp"
 #include "transform.hpp"
-#include <list>
-#include <iterator>
+#include <vector>
+#include <array>
 #include <string>
 #include <glm/glm.hpp>
 
 namespace our {
 
     class World; // A forward declaration of the World Class
+    class EntityPool; // A forward declaration of the EntityPool Class
+    class TransformHierarchy; // A forward declaration of the TransformHierarchy Class
 
     class Entity{
         World *world; // This defines what world own this entity
-        std::list<Component*> components; // A list of components that are owned by this entity
+        EntityHandle handle; // The handle that refers to this entity (it is set by the entity pool)
+        size_t denseIndex = 0; // The index of this entity in the world's list of entities
+        bool markedForRemoval = false; // True if the entity is in the world's "markedForRemoval" list
+        Entity* parent = nullptr; // The parent of the entity. The transform of the entity is relative to its parent.
+                                  // If parent is null, the entity is a root entity (has no parent).
+        std::vector<Entity*> children; // The entities whose parent is this entity
+        NameID name = EMPTY_NAME; // The interned name of the entity. It could be useful to refer to an entity by its name
+        std::vector<NameID> tags; // The interned tags of the entity. Unlike the name, an entity can have many tags
+        std::vector<Component*> components; // The components that are owned by this entity in the order they were added
+                                            // The memory of each component lives in the component storage of its type inside the world
+        ComponentMask componentMask; // Bit "i" is set if this entity owns a component whose type ID is "i"
+        std::array<Component*, MAX_COMPONENT_TYPES> componentsByType{}; // For each component type ID, the first component of that type (or null)
+
+        // The local to world matrix is cached since it is requested many times per frame (by the renderer, the lights, the camera and the systems).
+        // "TransformHierarchy::update" fills the cache of every entity once per update, so reading the matrix is a plain read of "cachedWorldMatrix".
+        // The cache is only invalid for the entities that were created, reset or moved to another parent since the last update
+        // (the change clears "worldMatrixValid" on the whole subtree), and these entities compute their matrix on their first request.
+        // A change to "localTransform" doesn't invalidate the cache: the matrix keeps its value till the next update picks the change up.
+        mutable glm::mat4 cachedLocalMatrix = glm::mat4(1); // The matrix of "cachedLocalTransform"
+        mutable glm::mat4 cachedWorldMatrix = glm::mat4(1); // The local to world matrix computed from "cachedLocalMatrix" and the parent's matrix
+        mutable Transform cachedLocalTransform; // The local transform from which the cached matrices were computed
+        mutable std::uint32_t worldMatrixVersion = 0; // Incremented every time "cachedWorldMatrix" is recomputed so that a system can detect it
+        mutable bool worldMatrixValid = false; // False if the cache must be computed before it is read (see above)
+
+        // The renderer blends the world matrix from the start of the last fixed update with the current one (see "World::beginFixedStep")
+        glm::mat4 previousWorldMatrix = glm::mat4(1); // The local to world matrix at the start of the last fixed update
+        std::uint32_t previousWorldVersion = 0; // The version of "previousWorldMatrix" (if it is still the current version, the entity didn't move)
+        bool interpolates = false; // False if the entity is drawn with its current matrix (it is new or it called "skipInterpolation")
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
+        friend EntityPool; // The pool is a friend since it allocates the memory of the entities on behalf of the world
+        friend TransformHierarchy; // The hierarchy is a friend since it fills the cached world matrices in its batched update
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
+
+        // Destroys the given component by returning it to the storage it was created in
+        static void releaseComponent(Component* component){
+            component->storage->destroy(component);
+        }
+
+        // Removes the component at the given position in "components", updates the type lookup and notifies the world
+        void removeComponentAt(std::vector<Component*>::iterator it){
+            Component* component = *it;
+            ComponentTypeID typeID = component->typeID;
+            componentRemoving(component);
+            components.erase(it);
+            releaseComponent(component);
+            // If another component of the same type exists, it becomes the one returned by "getComponent"
+            componentsByType[typeID] = nullptr;
+            for(Component* other : components)
+                if(other->typeID == typeID) { componentsByType[typeID] = other; break; }
+            componentMask.set(typeID, componentsByType[typeID] != nullptr);
+            componentsChanged(typeID);
+        }
+
+        // Marks the cached world matrices of this entity and its descendants as invalid (their chain of parents changed)
+        void invalidateWorldMatrices(){
+            forEachInSubtree([](Entity* entity){ entity->worldMatrixValid = false; });
+        }
+
+        // Puts the entity back in the state of a new entity so that the pool can reuse it.
+        // The containers are emptied but keep their memory, so a reused entity doesn't allocate till it outgrows the previous one.
+        // If "releaseComponents" is false, the components are forgotten without being returned to their storages (the storages must be cleared instead).
+        void reset(bool releaseComponents);
+
+        // Adds a component that was just created in its storage to this entity and notifies the world.
+        // It is defined in "world.hpp" since it needs the complete World type.
+        void attachComponent(Component* component);
+
+        // Notifies the world that a component of the given type was added to or removed from this entity,
+        // so that the cached views are kept up to date
+        void componentsChanged(ComponentTypeID typeID);
+        // Notifies the observers of the world that the given component is about to be removed
+        void componentRemoving(Component* component);
     public:
-        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
-        Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
-                          // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
 
+        // Makes the next renders show the current matrix instead of blending it with the one from the start of the fixed update.
+        // It should be called after teleporting the entity (e.g. when a car wraps around the road) so that it doesn't slide across the screen.
+        void skipInterpolation() { interpolates = false; }
+
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
+        EntityHandle getHandle() const { return handle; } // Returns a handle that can be stored to refer to this entity later (see "World::get")
+
+        // The name and the tags are indexed by the world (see "World::findByName" and "World::findAllByTag"),
+        // so they can only be changed through these functions to keep the index up to date
+        const std::string& getName() const { return getNameString(name); } // Returns the name of this entity
+        NameID getNameID() const { return name; } // Returns the interned name of this entity (comparing it is cheaper than comparing strings)
+        void setName(NameID newName); // Changes the name of this entity
+        void setName(std::string_view newName) { setName(internName(newName)); }
+        const std::vector<NameID>& getTags() const { return tags; } // Returns the interned tags of this entity
+        bool hasTag(NameID tag) const; // Returns true if this entity has the given tag
+        void addTag(NameID tag); // Adds the given tag to this entity (if it doesn't have it already)
+        void removeTag(NameID tag); // Removes the given tag from this entity (if it has it)
+
+        Entity* getParent() const { return parent; } // Returns the parent of this entity (or null if it is a root entity)
+        const std::vector<Entity*>& getChildren() const { return children; } // Returns the entities whose parent is this entity
+        // Changes the parent of this entity (null makes it a root entity) and updates the children lists of the old and the new parent.
+        // The parent must belong to the same world and must not be this entity or one of its descendants.
+        void setParent(Entity* newParent);
+        // Calls "function(entity)" for this entity and all of its descendants (parents are visited before their children)
+        template<typename Function>
+        void forEachInSubtree(Function function){
+            function(this);
+            for(Entity* child : children)
+                child->forEachInSubtree(function);
+        }
 
-        glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
+        // Returns the transformation from the entities local space to the world space as of the last "World::updateTransforms".
+        // It only computes the matrix if the entity was created or reparented since then, otherwise it doesn't write anything,
+        // so many threads can read the matrices at once between two updates.
+        const glm::mat4& getLocalToWorldMatrix() const;
+        // Returns the local to world matrix to draw: the blend of the matrices from the start and the end of the last fixed update,
+        // weighted by the world's interpolation factor (see "World::setInterpolationFactor"). It doesn't change the entity or its cache.
+        glm::mat4 getInterpolatedLocalToWorldMatrix() const;
+        // Returns true if "getInterpolatedLocalToWorldMatrix" blends two different matrices (so it changes from a frame to the next)
+        bool isInterpolated() const { return interpolates && previousWorldVersion != getLocalToWorldVersion(); }
+        // Returns a number that changes whenever the local to world matrix changes, so a system can cache data computed from the matrix
+        std::uint32_t getLocalToWorldVersion() const { getLocalToWorldMatrix(); return worldMatrixVersion; }
+        // Returns the box around the local bounds of all the components of this entity (see "Component::getLocalBounds").
+        // It returns false if none of the components has bounds.
+        bool getLocalBounds(AABB& bounds) const;
+        // Returns the local bounds transformed to the world space (false if the entity has no bounds)
+        bool getWorldBounds(AABB& bounds) const;
+        // Calls "function(mesh)" for the collision mesh of every component that has one (see "Component::getCollisionMesh")
+        template<typename Function>
+        void forEachCollisionMesh(Function function) const {
+            for(const Component* component : components)
+                if(const Mesh* mesh = component->getCollisionMesh()) function(mesh);
+        }
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
         
         // This template method create a component of type T,
-        // adds it to the components map and returns a pointer to it 
+        // adds it to the components map and returns a pointer to it
+        // The component is allocated from the world's storage for type T, so it is defined in "world.hpp"
         template<typename T>
-        T* addComponent(){
-            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
-            //DONE: (Req 8) Create an component of type T, set its "owner" to be this entity, then push it into the component's list
-            // Don't forget to return a pointer to the new component
-            T* comp = new T();
-            comp->owner = this;
-            components.push_back(comp);
-            return comp;
+        T* addComponent();
+
+        // Returns a mask of the component types owned by this entity
+        const ComponentMask& getComponentMask() const { return componentMask; }
+
+        // Returns true if this entity owns a component of type T (it is a single bit test)
+        template<typename T>
+        bool hasComponent() const {
+            return componentMask.test(getComponentTypeID<T>());
         }
 
         // This template method searhes for a component of type T and returns a pointer to it
-        // If no component of type T was found, it returns a nullptr 
+        // If no component of type T was found, it returns a nullptr
+        // T must be the exact (most derived) type of the component: the component is found directly by indexing with the ID of its type
+        // (no search or dynamic_cast is needed), so asking for a base class (e.g. "getComponent<Component>()") returns a nullptr.
+        // Use "findComponent" to look for a component through one of its base classes.
         template<typename T>
         T* getComponent(){
-            //DONE: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
-            // Return the component you found, or return null of nothing was found.
-            for (Component* comp : components)
-                if (T* ptr = dynamic_cast<T*>(comp))
-                    return ptr;
+            return static_cast<T*>(componentsByType[getComponentTypeID<T>()]);
+        }
+
+        // This template method searches for the first component that is a T or derives from T and returns a pointer to it
+        // If none was found, it returns a nullptr. It tries every component with a dynamic_cast, so it is slower than "getComponent".
+        template<typename T>
+        T* findComponent(){
+            for(Component* component : components)
+                if(T* found = dynamic_cast<T*>(component); found) return found;
             return nullptr;
         }
 
@@ -57,45 +187,48 @@ namespace our {
         // If no component of type T was found, it returns a nullptr 
         template<typename T>
         T* getComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end())
-                return dynamic_cast<T*>(*it);
+            if(index < components.size())
+                return dynamic_cast<T*>(components[index]);
             return nullptr;
         }
 
+        // Calls "function(component)" for every component of type T owned by this entity (in the order they were added)
+        template<typename T, typename Function>
+        void forEachComponent(Function function){
+            ComponentTypeID typeID = getComponentTypeID<T>();
+            if(!componentMask.test(typeID)) return;
+            for(Component* component : components)
+                if(component->getTypeID() == typeID) function(static_cast<T*>(component));
+        }
+
         // This template method searhes for a component of type T and deletes it
         template<typename T>
         void deleteComponent(){
-            //DONE: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
-            // If found, delete the found component and remove it from the components list
-            components.remove_if([](T& comp) { return dynamic_cast<T*>(comp); });
+            if(T* component = getComponent<T>(); component)
+                deleteComponent(component);
         }
 
         // This template method searhes for a component of type T and deletes it
         void deleteComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end()) {
-                delete *it;
-                components.erase(it);
-            }
+            if(index < components.size())
+                removeComponentAt(components.begin() + index);
         }
 
         // This template method searhes for the given component and deletes it
         template<typename T>
         void deleteComponent(T const* component){
-            //DONE: (Req 8) Go through the components list and find the given component "component".
-            // If found, delete the found component and remove it from the components list
-            components.remove_if([&component](Component* comp) { return (Component*)component == comp; });
-            delete component;
+            for (auto it = components.begin(); it != components.end(); ++it) {
+                if (*it == (Component*)component) {
+                    removeComponentAt(it);
+                    return;
+                }
+            }
         }
 
         // Since the entity owns its components, they should be deleted alongside the entity
         ~Entity(){
-            //DONE: (Req 8) Delete all the components in "components".
             for (Component* comp : components)
-                delete comp;
+                releaseComponent(comp);
         }
 
         // Entities should not be copyable
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace our {
+
+    // Entity names and tags are interned: every distinct string is stored once and is referred to by a small integer ID.
+    // So comparing two names is an integer comparison and the world can index its entities by name using the ID as a key.
+    typedef std::uint32_t NameID;
+
+    // The ID of the empty string (it is the name of an entity that was not given a name)
+    constexpr NameID EMPTY_NAME = 0;
+
+    namespace detail {
+        // The table holding the interned strings. It is guarded by a mutex since names could be interned from different threads.
+        struct NameTable {
+            std::mutex mutex;
+            std::deque<std::string> strings{std::string()}; // A deque never moves its elements, so the returned references stay valid
+            std::unordered_map<std::string_view, NameID> ids{{std::string_view(), EMPTY_NAME}}; // The views point into "strings"
+        };
+
+        inline NameTable& getNameTable() {
+            static NameTable table;
+            return table;
+        }
+    }
+
+    // Returns the ID of the given string. The first time a string is seen, it is added to the table and given a new ID.
+    // Systems should intern the names they look for once (e.g. in a member) instead of every frame.
+    inline NameID internName(std::string_view name) {
+        auto& table = detail::getNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        if(auto it = table.ids.find(name); it != table.ids.end()) return it->second;
+        NameID id = (NameID)table.strings.size();
+        const std::string& stored = table.strings.emplace_back(name);
+        table.ids.emplace(std::string_view(stored), id);
+        return id;
+    }
+
+    // Returns the string whose ID is given
+    inline const std::string& getNameString(NameID id) {
+        auto& table = detail::getNameTable();
+        std::lock_guard<std::mutex> lock(table.mutex);
+        return table.strings.at(id);
+    }
+
+}
@@ -0,0 +1,220 @@
+#include "transform-hierarchy.hpp"
+#include "entity.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_TRANSFORM_HIERARCHY_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+    // The hierarchy is stored breadth-first: we start with the roots, then we append the children of every entity in the list as we walk over it.
+    // So each depth level comes after the previous one and a parent's index is always smaller than its children's indices.
+    void TransformHierarchy::rebuildOrder(const std::vector<Entity*>& entities){
+        order.clear();
+        depths.clear();
+        parents.clear();
+        for(Entity* entity : entities){
+            if(entity->parent) continue;
+            order.push_back(entity);
+            depths.push_back(0);
+            parents.push_back(-1);
+        }
+        for(size_t index = 0; index < order.size(); ++index){
+            for(Entity* child : order[index]->children){
+                order.push_back(child);
+                depths.push_back(depths[index] + 1);
+                parents.push_back((std::int32_t)index);
+            }
+        }
+        localSlots.resize(order.size());
+        updated.resize(order.size());
+        orderDirty = false;
+    }
+
+    // The systems change "localTransform" directly, so we compare it with the cached one to find the entities that moved
+    void TransformHierarchy::gatherLocalTransforms(){
+        changedCount = 0;
+        for(auto* array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &scaleX, &scaleY, &scaleZ})
+            array->clear();
+        for(size_t index = 0; index < order.size(); ++index){
+            const Entity* entity = order[index];
+            const Transform& transform = entity->localTransform;
+            if(entity->worldMatrixValid && transform == entity->cachedLocalTransform){
+                localSlots[index] = -1;
+                continue;
+            }
+            localSlots[index] = (std::int32_t)changedCount++;
+            positionX.push_back(transform.position.x); positionY.push_back(transform.position.y); positionZ.push_back(transform.position.z);
+            rotationX.push_back(transform.rotation.x); rotationY.push_back(transform.rotation.y); rotationZ.push_back(transform.rotation.z);
+            scaleX.push_back(transform.scale.x); scaleY.push_back(transform.scale.y); scaleZ.push_back(transform.scale.z);
+        }
+        // The SoA arrays are padded to a multiple of 4 so that the SIMD loop never needs a scalar tail.
+        // The padding is an identity transform (scale 1) and its matrices are never read.
+        size_t padded = (changedCount + 3) & ~size_t(3);
+        for(auto* array : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ})
+            array->resize(padded, 0.0f);
+        for(auto* array : {&scaleX, &scaleY, &scaleZ})
+            array->resize(padded, 1.0f);
+        if(localMatrices.size() < padded) localMatrices.resize(padded);
+    }
+
+#if OUR_TRANSFORM_HIERARCHY_SSE
+    // Computes the sine and the cosine of 4 angles at once.
+    // The angle is reduced to [-pi/4, pi/4] by subtracting the nearest multiple of pi/2, then both functions are approximated by polynomials
+    // on the reduced angle and the quadrant decides which of them is the sine, which is the cosine and what their signs are.
+    // The error is around 1e-7 for the angles used by the game (a few turns at most).
+    static inline void sinCos4(__m128 angle, __m128& sine, __m128& cosine){
+        const __m128 twoOverPi = _mm_set1_ps(0.636619772f);
+        // pi/2 is split into two parts so that subtracting "quadrant * pi/2" does not lose the low bits of the angle
+        const __m128 halfPiHigh = _mm_set1_ps(1.5707962513f);
+        const __m128 halfPiLow = _mm_set1_ps(7.5497894159e-8f);
+
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, twoOverPi)); // Rounded to the nearest integer
+        __m128 quadrantF = _mm_cvtepi32_ps(quadrant);
+        __m128 x = _mm_sub_ps(_mm_sub_ps(angle, _mm_mul_ps(quadrantF, halfPiHigh)), _mm_mul_ps(quadrantF, halfPiLow));
+        __m128 x2 = _mm_mul_ps(x, x);
+
+        // sin(x) = x + x^3 * (S1 + x^2 * (S2 + x^2 * S3))
+        __m128 s = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(-1.6666654611e-1f));
+        s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+        // cos(x) = 1 - x^2 / 2 + x^4 * (C1 + x^2 * (C2 + x^2 * C3))
+        __m128 c = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(4.166664568298827e-2f));
+        c = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(c, x2), x2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, _mm_set1_ps(0.5f))));
+
+        // In the odd quadrants, the sine and the cosine are swapped
+        const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        __m128 sineValue = _mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s));
+        __m128 cosineValue = _mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c));
+        // The sine is negated in quadrants 2 & 3 and the cosine is negated in quadrants 1 & 2 (we flip the sign bit)
+        __m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+        __m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+        sine = _mm_xor_ps(sineValue, sineSign);
+        cosine = _mm_xor_ps(cosineValue, cosineSign);
+    }
+#endif
+
+    // This computes "translate(position) * yawPitchRoll(rotation.y, rotation.x, rotation.z) * scale(scale)" (the same as "Transform::toMat4")
+    void TransformHierarchy::computeLocalMatrices(size_t begin, size_t end){
+#if OUR_TRANSFORM_HIERARCHY_SSE
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for(size_t index = begin; index < end; index += 4){
+            __m128 sh, ch, sp, cp, sb, cb; // The sines and cosines of the yaw (heading), the pitch and the roll (bank)
+            sinCos4(_mm_loadu_ps(&rotationY[index]), sh, ch);
+            sinCos4(_mm_loadu_ps(&rotationX[index]), sp, cp);
+            sinCos4(_mm_loadu_ps(&rotationZ[index]), sb, cb);
+            __m128 sx = _mm_loadu_ps(&scaleX[index]), sy = _mm_loadu_ps(&scaleY[index]), sz = _mm_loadu_ps(&scaleZ[index]);
+            __m128 shsp = _mm_mul_ps(sh, sp), chsp = _mm_mul_ps(ch, sp);
+
+            // Each column of the rotation is multiplied by the scale along the same axis
+            __m128 column0[4] = {
+                _mm_mul_ps(_mm_add_ps(_mm_mul_ps(ch, cb), _mm_mul_ps(shsp, sb)), sx),
+                _mm_mul_ps(_mm_mul_ps(sb, cp), sx),
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(chsp, sb), _mm_mul_ps(sh, cb)), sx),
+                zero
+            };
+            __m128 column1[4] = {
+                _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(shsp, cb), _mm_mul_ps(ch, sb)), sy),
+                _mm_mul_ps(_mm_mul_ps(cb, cp), sy),
+                _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sb, sh), _mm_mul_ps(chsp, cb)), sy),
+                zero
+            };
+            __m128 column2[4] = {
+                _mm_mul_ps(_mm_mul_ps(sh, cp), sz),
+                _mm_mul_ps(_mm_sub_ps(zero, sp), sz),
+                _mm_mul_ps(_mm_mul_ps(ch, cp), sz),
+                zero
+            };
+            __m128 column3[4] = { _mm_loadu_ps(&positionX[index]), _mm_loadu_ps(&positionY[index]), _mm_loadu_ps(&positionZ[index]), one };
+
+            // Each register holds one row of a column for the 4 entities, so we transpose them to get a whole column per entity
+            _MM_TRANSPOSE4_PS(column0[0], column0[1], column0[2], column0[3]);
+            _MM_TRANSPOSE4_PS(column1[0], column1[1], column1[2], column1[3]);
+            _MM_TRANSPOSE4_PS(column2[0], column2[1], column2[2], column2[3]);
+            _MM_TRANSPOSE4_PS(column3[0], column3[1], column3[2], column3[3]);
+            for(int lane = 0; lane < 4; ++lane){
+                float* matrix = &localMatrices[index + lane][0][0];
+                _mm_storeu_ps(matrix, column0[lane]);
+                _mm_storeu_ps(matrix + 4, column1[lane]);
+                _mm_storeu_ps(matrix + 8, column2[lane]);
+                _mm_storeu_ps(matrix + 12, column3[lane]);
+            }
+        }
+#else
+        for(size_t index = begin; index < end; ++index){
+            float sh = std::sin(rotationY[index]), ch = std::cos(rotationY[index]);
+            float sp = std::sin(rotationX[index]), cp = std::cos(rotationX[index]);
+            float sb = std::sin(rotationZ[index]), cb = std::cos(rotationZ[index]);
+            glm::mat4& matrix = localMatrices[index];
+            matrix[0] = glm::vec4(ch * cb + sh * sp * sb, sb * cp, -sh * cb + ch * sp * sb, 0) * scaleX[index];
+            matrix[1] = glm::vec4(-ch * sb + sh * sp * cb, cb * cp, sb * sh + ch * sp * cb, 0) * scaleY[index];
+            matrix[2] = glm::vec4(sh * cp, -sp, ch * cp, 0) * scaleZ[index];
+            matrix[3] = glm::vec4(positionX[index], positionY[index], positionZ[index], 1);
+        }
+#endif
+    }
+
+    // Since the parents come first, the world matrix of a parent is always up to date when its children are reached.
+    // An entity needs a new world matrix if its local transform changed, if its cache was invalidated (it was created or reparented)
+    // or if its parent got a new world matrix in this update.
+    void TransformHierarchy::computeWorldMatrices(){
+        for(size_t index = 0; index < order.size(); ++index){
+            Entity* entity = order[index];
+            const Entity* parent = entity->parent;
+            std::int32_t slot = localSlots[index];
+            bool parentUpdated = parents[index] >= 0 && updated[parents[index]];
+            updated[index] = slot >= 0 || parentUpdated || !entity->worldMatrixValid;
+            if(!updated[index]) continue;
+            if(slot >= 0){
+                entity->cachedLocalTransform = entity->localTransform;
+                entity->cachedLocalMatrix = localMatrices[slot];
+            }
+            if(!parent){
+                entity->cachedWorldMatrix = entity->cachedLocalMatrix;
+            } else {
+#if OUR_TRANSFORM_HIERARCHY_SSE
+                // Each column of the result is a combination of the parent's columns weighted by the same column of the local matrix
+                const float* parentMatrix = &parent->cachedWorldMatrix[0][0];
+                const float* local = &entity->cachedLocalMatrix[0][0];
+                float* result = &entity->cachedWorldMatrix[0][0];
+                __m128 p0 = _mm_loadu_ps(parentMatrix), p1 = _mm_loadu_ps(parentMatrix + 4);
+                __m128 p2 = _mm_loadu_ps(parentMatrix + 8), p3 = _mm_loadu_ps(parentMatrix + 12);
+                for(int column = 0; column < 4; ++column){
+                    const float* l = local + 4 * column;
+                    __m128 r = _mm_mul_ps(p0, _mm_set1_ps(l[0]));
+                    r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_set1_ps(l[1])));
+                    r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_set1_ps(l[2])));
+                    r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_set1_ps(l[3])));
+                    _mm_storeu_ps(result + 4 * column, r);
+                }
+#else
+                entity->cachedWorldMatrix = parent->cachedWorldMatrix * entity->cachedLocalMatrix;
+#endif
+            }
+            // We fill the entity's cache as if "getLocalToWorldMatrix" computed it, so the cache stays valid till the next update
+            entity->worldMatrixValid = true;
+            ++entity->worldMatrixVersion;
+        }
+    }
+
+    void TransformHierarchy::update(const std::vector<Entity*>& entities, JobSystem* jobs){
+        if(orderDirty) rebuildOrder(entities);
+        gatherLocalTransforms();
+        // The local matrices don't depend on each other, so they can be split between the workers.
+        // Each range is a multiple of 4 long so that no SIMD batch is split (and it is big enough to be worth a job).
+        const size_t grain = 1024;
+        if(jobs && changedCount > grain)
+            jobs->parallelFor(0, changedCount, grain, [this](size_t begin, size_t end){ computeLocalMatrices(begin, end); });
+        else
+            computeLocalMatrices(0, changedCount);
+        // The world matrices depend on their parents', so they are computed in order on this thread
+        computeWorldMatrices();
+    }
+
+}
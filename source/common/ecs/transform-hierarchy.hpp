@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+namespace our {
+
+    class Entity; // A forward declaration of the Entity Class
+    class JobSystem; // A forward declaration of the JobSystem Class
+
+    // This class keeps a flattened copy of the transform hierarchy of a world so that all the world matrices can be computed in one pass.
+    // The entities are stored in breadth-first order, so they are sorted by their depth in the hierarchy and every parent comes before its children.
+    // The local transforms that changed since the last update are gathered into separate arrays (structure of arrays) so that their matrices
+    // can be built 4 entities at a time using SSE, then a single linear pass multiplies each local matrix with the (already computed) world matrix
+    // of its parent. Entities whose transform and ancestors didn't change are skipped, so a mostly static scene costs one comparison per entity.
+    // A recomputed world matrix flags its entity as updated, and the flag is pushed down to the children (which come later in the order).
+    // The order is only rebuilt when the hierarchy changes (an entity is added, deleted or reparented), not every frame.
+    class TransformHierarchy {
+        std::vector<Entity*> order; // The entities sorted by depth (parents before children)
+        std::vector<std::uint32_t> depths; // For each entity in "order", its depth in the hierarchy (0 for a root)
+        std::vector<std::int32_t> parents; // For each entity in "order", the index of its parent in "order" (or -1 for a root)
+        std::vector<std::uint8_t> updated; // For each entity in "order", 1 if its world matrix was recomputed by the current update
+        std::vector<std::int32_t> localSlots; // For each entity in "order", its index in the SoA arrays if its local transform changed (or -1)
+        // The changed local transforms split into one array per component
+        std::vector<float> positionX, positionY, positionZ;
+        std::vector<float> rotationX, rotationY, rotationZ;
+        std::vector<float> scaleX, scaleY, scaleZ;
+        size_t changedCount = 0; // The number of used elements in the SoA arrays
+        std::vector<glm::mat4> localMatrices; // The local matrices computed from the SoA arrays
+        bool orderDirty = true; // True if the hierarchy changed since the order was built
+
+        // Sorts the given entities by depth
+        void rebuildOrder(const std::vector<Entity*>& entities);
+        // Copies the local transforms that changed since they were cached into the SoA arrays
+        void gatherLocalTransforms();
+        // Computes the local matrices of the elements [begin, end) of the SoA arrays (4 at a time if SSE is available)
+        // "begin" must be a multiple of 4
+        void computeLocalMatrices(size_t begin, size_t end);
+        // Computes the world matrices that changed in order and stores them in the entities' caches
+        void computeWorldMatrices();
+    public:
+        // Marks the order as outdated so that it is rebuilt on the next update
+        void markDirty() { orderDirty = true; }
+        // Returns true if the hierarchy changed since the last update. Every entity created, reset or reparented marks the order as dirty,
+        // so if it returns false, the cache of every entity holds the matrix computed by the last update.
+        bool isDirty() const { return orderDirty; }
+
+        // Computes the local to world matrix of every given entity and stores it in the entity's cache,
+        // so that the following calls to "Entity::getLocalToWorldMatrix" return it without recomputing anything.
+        // If a job system is given, the local matrices are computed in parallel.
+        void update(const std::vector<Entity*>& entities, JobSystem* jobs = nullptr);
+
+        // Returns the entities sorted by depth as of the last update
+        const std::vector<Entity*>& getOrder() const { return order; }
+        // Returns the depth of each entity in "getOrder()" as of the last update
+        const std::vector<std::uint32_t>& getDepths() const { return depths; }
+    };
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <vector>
+#include <cstdint>
+
+namespace our {
+
+    // A query cache holds the list of entities that own every component type required by a certain view.
+    // The world keeps one cache per distinct view and updates it whenever an entity gains or loses a component,
+    // so a system using the view only ever touches the entities that matter to it.
+    class QueryCache {
+        ComponentMask required; // The component types that an entity must own to match the view
+        std::vector<Entity*> entities; // The entities that currently match the view
+        // For each entity handle index, the index of the entity inside "entities" (or NOT_CACHED).
+        // A plain vector is used instead of a hash map so that adding and removing entities doesn't allocate once it is big enough.
+        std::vector<std::uint32_t> indices;
+        static constexpr std::uint32_t NOT_CACHED = 0xFFFFFFFFu;
+
+        // Returns a reference to the index of the entity inside "entities" (the vector grows if the entity is new)
+        std::uint32_t& indexOf(const Entity* entity){
+            std::uint32_t handleIndex = entity->getHandle().getIndex();
+            if(handleIndex >= indices.size()) indices.resize(handleIndex + 1, NOT_CACHED);
+            return indices[handleIndex];
+        }
+
+        // Adds the entity to the match list (the caller must make sure it is not already there)
+        void insert(Entity* entity){
+            indexOf(entity) = (std::uint32_t)entities.size();
+            entities.push_back(entity);
+        }
+    public:
+        explicit QueryCache(const ComponentMask& required) : required(required) {}
+
+        // Returns the component types required by the view
+        const ComponentMask& getRequired() const { return required; }
+
+        // Re-evaluates whether the given entity matches the view and updates the match list accordingly
+        void refresh(Entity* entity){
+            bool match = (entity->getComponentMask() & required) == required;
+            bool cached = indexOf(entity) != NOT_CACHED;
+            if(match && !cached) insert(entity);
+            else if(!match && cached) remove(entity);
+        }
+
+        // Removes the entity from the match list (if it is there)
+        // We swap the entity with the last one in the list so that the removal is O(1)
+        void remove(Entity* entity){
+            std::uint32_t& slot = indexOf(entity);
+            if(slot == NOT_CACHED) return;
+            std::uint32_t index = slot;
+            slot = NOT_CACHED;
+            Entity* last = entities.back();
+            entities.pop_back();
+            if(last != entity){
+                entities[index] = last;
+                indexOf(last) = index;
+            }
+        }
+
+        // Removes every entity from the match list (the memory is kept for the next entities)
+        void clear(){
+            for(Entity* entity : entities) indexOf(entity) = NOT_CACHED;
+            entities.clear();
+        }
+
+        const std::vector<Entity*>& getEntities() const { return entities; }
+    };
+
+    // A view is a lightweight handle to the entities that own all of the components "Components...".
+    // It can be used in a range-based for loop to get the matching entities,
+    // or "each" can be used to get the requested components directly.
+    // WARNING: Don't add or remove components of the viewed types while iterating over a view. Use "World::markForRemoval" to delete entities.
+    template<typename... Components>
+    class View {
+        const QueryCache* cache;
+    public:
+        explicit View(const QueryCache* cache) : cache(cache) {}
+
+        std::vector<Entity*>::const_iterator begin() const { return cache->getEntities().begin(); }
+        std::vector<Entity*>::const_iterator end() const { return cache->getEntities().end(); }
+        size_t size() const { return cache->getEntities().size(); }
+        bool empty() const { return cache->getEntities().empty(); }
+
+        // Calls "function(entity, components...)" for every matching entity
+        template<typename Function>
+        void each(Function function) const {
+            for(Entity* entity : cache->getEntities())
+                function(entity, entity->getComponent<Components>()...);
+        }
+    };
+
+}
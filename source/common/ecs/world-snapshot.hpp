@@ -0,0 +1,78 @@
+#pragma once
+
+#include "component-storage.hpp"
+#include "entity-handle.hpp"
+#include "name.hpp"
+#include "transform.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+
+    // A snapshot holds a copy of every entity of a world (its name, tags, parent and local transform) and of all the data of its components.
+    // Everything lives in a few flat arrays: the component copies are constructed next to each other in one contiguous buffer,
+    // so taking or restoring a snapshot is a linear pass of plain copies instead of a json parse.
+    // A snapshot is taken by "World::snapshot" and applied by "World::restore" (see "world.hpp").
+    // Taking a snapshot again into the same object reuses its memory.
+    class WorldSnapshot {
+        // The saved state of an entity. The records are stored in the order of the world's entity list.
+        struct EntityRecord {
+            EntityHandle handle; // The handle of the entity when the snapshot was taken
+            NameID name;
+            std::int32_t parent; // The index of the parent's record (or -1 if the entity is a root entity)
+            Transform localTransform;
+            std::uint32_t firstTag, tagCount; // The range of the entity's tags in "tags"
+            std::uint32_t firstComponent, componentCount; // The range of the entity's components in "components"
+        };
+
+        // The saved state of a component
+        struct ComponentRecord {
+            ComponentTypeID typeID;
+            const ComponentCopyFunctions* functions; // The functions used to copy the component (they come from its storage)
+            size_t offset; // The offset of the component's copy in "data" (in bytes)
+        };
+
+        const World* world = nullptr; // The world from which the snapshot was taken
+        std::vector<EntityRecord> entities;
+        std::vector<NameID> tags;
+        std::vector<ComponentRecord> components;
+        std::vector<std::max_align_t> data; // The raw memory holding the copies of the components
+
+        friend World; // The world is a friend since it fills and applies the snapshot
+
+        unsigned char* at(size_t offset) { return reinterpret_cast<unsigned char*>(data.data()) + offset; }
+        const unsigned char* at(size_t offset) const { return reinterpret_cast<const unsigned char*>(data.data()) + offset; }
+
+        // Destroys the component copies and empties the arrays (their memory is kept)
+        void reset(){
+            for(auto& component : components)
+                component.functions->destroy(at(component.offset));
+            entities.clear();
+            tags.clear();
+            components.clear();
+            world = nullptr;
+        }
+
+    public:
+        WorldSnapshot() = default;
+
+        // Returns true if no snapshot was taken yet
+        bool empty() const { return world == nullptr; }
+
+        // Returns the number of saved entities
+        size_t size() const { return entities.size(); }
+
+        ~WorldSnapshot(){
+            reset();
+        }
+
+        // A snapshot should not be copyable since it owns the component copies (it could be copied through the copy functions if needed)
+        WorldSnapshot(const WorldSnapshot&) = delete;
+        WorldSnapshot &operator=(WorldSnapshot const &) = delete;
+    };
+
+}
@@ -1,4 +1,10 @@
 #include "world.hpp"
+#include "../json-stream.hpp"
+#include "../deserialize-utils.hpp"
+#include "../mesh/mesh.hpp"
+#include "../spatial/intersection.hpp"
+
+#include <cassert>
 
 namespace our {
 
@@ -7,18 +13,418 @@ namespace our {
     // If any of the entities has children, this function will be called recursively for these children
     void World::deserialize(const nlohmann::json& data, Entity* parent){
         if(!data.is_array()) return;
-        for(const auto& entityData : data){
-            //DONE: (Req 8) Create an entity, make its parent "parent" and call its deserialize with "entityData".
+        for(const auto& entityData : data)
+            deserializeEntity(entityData, parent);
+    }
+
+    // This deserializes a single entity (and its children) from a json object and adds it to the world
+    Entity* World::deserializeEntity(const nlohmann::json& entityData, Entity* parent){
+        if(entityData.is_object() && entityData.contains("prefab")) return deserializeInstances(entityData, parent);
+        //DONE: (Req 8) Create an entity, make its parent "parent" and call its deserialize with "entityData".
+        Entity* entity = add();
+        entity->setParent(parent);
+        entity->deserialize(entityData);
+
+        if(entityData.contains("children")){
+            //DONE: (Req 8) Recursively call this world's "deserialize" using the children data
+            // and the current entity as the parent
+            deserialize(entityData["children"], entity);
+        }
+        return entity;
+    }
+
+    // This builds the template entity of every prefab in the json object
+    void World::deserializePrefabs(const nlohmann::json& data){
+        if(!data.is_object()) return;
+        if(!prefabWorld) prefabWorld = std::make_unique<World>();
+        for(const auto& [name, entityData] : data.items()){
+            NameID id = internName(name);
+            // The template of a replaced prefab is deleted with its children
+            if(auto it = prefabs.find(id); it != prefabs.end()){
+                it->second->forEachInSubtree([this](Entity* entity){ prefabWorld->markForRemoval(entity); });
+                prefabWorld->deleteMarkedEntities();
+                prefabs.erase(it);
+            }
+            if(Entity* entity = prefabWorld->deserializeEntity(entityData)) prefabs[id] = entity;
+        }
+    }
+
+    // This adds an instance of the prefab to the world
+    Entity* World::instantiate(NameID prefab, Entity* parent){
+        auto it = prefabs.find(prefab);
+        return it == prefabs.end() ? nullptr : cloneEntity(it->second, parent);
+    }
+
+    // This copies the entity, its components and its children into this world
+    Entity* World::cloneEntity(const Entity* source, Entity* parent){
+        Entity* entity = add();
+        entity->setParent(parent);
+        entity->setName(source->name);
+        for(NameID tag : source->tags) entity->addTag(tag);
+        entity->localTransform = source->localTransform;
+        for(const Component* component : source->components){
+            // The data is copied before attaching the component, so the observers of ADDED events see the data of the template
+            Component* copy = getStorage(component->typeID, *component->storage).create();
+            component->storage->getCopyFunctions().assign(copy, component);
+            entity->attachComponent(copy);
+        }
+        for(const Entity* child : source->children)
+            cloneEntity(child, entity);
+        return entity;
+    }
+
+    // This adds the instances of a prefab. The transforms come from the arrays in the json object (see "deserializePrefabs").
+    Entity* World::deserializeInstances(const nlohmann::json& data, Entity* parent){
+        auto it = prefabs.find(internName(data["prefab"].get<std::string>()));
+        if(it == prefabs.end()) return nullptr;
+        const Entity* prefab = it->second;
+        // The singular keys override the prefab's transform for all the instances
+        Transform shared = prefab->localTransform;
+        shared.deserialize(data);
+        NameID name = data.contains("name") ? internName(data["name"].get<std::string>()) : prefab->name;
+
+        const nlohmann::json* positions = nullptr, *rotations = nullptr, *scales = nullptr;
+        size_t count = 1;
+        bool hasArray = false;
+        for(auto [key, array] : {std::make_pair("positions", &positions), std::make_pair("rotations", &rotations), std::make_pair("scales", &scales)}){
+            auto found = data.find(key);
+            if(found == data.end() || !found->is_array()) continue;
+            *array = &*found;
+            count = hasArray ? std::max(count, found->size()) : found->size();
+            hasArray = true;
+        }
+        // Returns the element of the array that belongs to the given instance (the last element is repeated by the extra instances)
+        auto element = [](const nlohmann::json* array, size_t index) -> const nlohmann::json* {
+            if(!array || array->empty()) return nullptr;
+            return &(*array)[std::min(index, array->size() - 1)];
+        };
+
+        Entity* first = nullptr;
+        for(size_t index = 0; index < count; ++index){
+            Entity* entity = cloneEntity(prefab, parent);
+            entity->setName(name);
+            entity->localTransform = shared;
+            if(auto position = element(positions, index)) entity->localTransform.position = position->get<glm::vec3>();
+            if(auto rotation = element(rotations, index)) entity->localTransform.rotation = glm::radians(rotation->get<glm::vec3>());
+            if(auto scale = element(scales, index)) entity->localTransform.scale = scale->get<glm::vec3>();
+            if(data.contains("children")) deserialize(data["children"], entity);
+            if(!first) first = entity;
+        }
+        return first;
+    }
+
+    // This streams the entities of the array at the given JSON pointer into the world
+    void World::deserializeStreamed(std::istream& input, const std::string& pointer){
+        // Nothing but the entity array is built, and each root entity is dropped as soon as it is added to the world
+        parseJsonStreaming(input, {{pointer, [this](const std::string&, nlohmann::json& entityData){
+            if(entityData.is_object()) deserializeEntity(entityData);
+        }}}, false);
+    }
+
+    // This saves all the entities and the data of their components into the snapshot
+    void World::snapshot(WorldSnapshot& snapshot){
+        snapshot.reset();
+        snapshot.world = this;
+        // First, we save the entities and compute where the copy of each component goes in the buffer
+        size_t bytes = 0;
+        for(Entity* entity : entities){
+            WorldSnapshot::EntityRecord record;
+            record.handle = entity->handle;
+            record.name = entity->name;
+            // The records follow the order of "entities", so the index of the parent's record is the parent's dense index
+            record.parent = entity->parent ? (std::int32_t)entity->parent->denseIndex : -1;
+            record.localTransform = entity->localTransform;
+            record.firstTag = (std::uint32_t)snapshot.tags.size();
+            record.tagCount = (std::uint32_t)entity->tags.size();
+            snapshot.tags.insert(snapshot.tags.end(), entity->tags.begin(), entity->tags.end());
+            record.firstComponent = (std::uint32_t)snapshot.components.size();
+            record.componentCount = (std::uint32_t)entity->components.size();
+            for(Component* component : entity->components){
+                const ComponentCopyFunctions& functions = component->storage->getCopyFunctions();
+                assert(functions.alignment <= alignof(std::max_align_t) && "The component type is over-aligned for the snapshot buffer");
+                bytes = (bytes + functions.alignment - 1) / functions.alignment * functions.alignment;
+                snapshot.components.push_back({component->typeID, &functions, bytes});
+                bytes += functions.size;
+            }
+            snapshot.entities.push_back(record);
+        }
+        // Then, the buffer is sized once (the old copies were already destroyed, so it can move) and the components are copied into it
+        snapshot.data.resize((bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t));
+        size_t index = 0;
+        for(Entity* entity : entities)
+            for(Component* component : entity->components){
+                const auto& saved = snapshot.components[index++];
+                saved.functions->construct(snapshot.at(saved.offset), component);
+            }
+    }
+
+    // The matrices of the last "updateTransforms" are the ones the entities had at the end of the previous fixed update
+    void World::beginFixedStep(){
+        for(Entity* entity : entities){
+            entity->previousWorldMatrix = entity->getLocalToWorldMatrix();
+            entity->previousWorldVersion = entity->worldMatrixVersion;
+            entity->interpolates = true;
+        }
+        // The hash remembers the positions of the last two updates, so it is only updated here (the drawn frames don't move it)
+        spatialHash.update(this);
+    }
+
+    // This puts the world back in the state saved in the snapshot
+    void World::restore(const WorldSnapshot& snapshot){
+        assert(snapshot.world == this && "A snapshot can only be restored into the world it was taken from");
+        if(snapshot.world != this) return;
+        ++restoreCount;
+        const auto& records = snapshot.entities;
+
+        // If every saved entity is still alive and owns the same component types in the same order, we can copy the data in place
+        bool matches = records.size() == entities.size();
+        for(size_t index = 0; matches && index < records.size(); ++index){
+            const auto& record = records[index];
+            Entity* entity = pool.get(record.handle);
+            if(!entity || entity->components.size() != record.componentCount) { matches = false; break; }
+            for(std::uint32_t component = 0; component < record.componentCount; ++component)
+                if(entity->components[component]->typeID != snapshot.components[record.firstComponent + component].typeID) { matches = false; break; }
+        }
+
+        if(matches){
+            // The entities that were marked for removal after the snapshot was taken are kept since they exist in the snapshot
+            for(Entity* entity : markedForRemoval) entity->markedForRemoval = false;
+            markedForRemoval.clear();
+            // The entities whose parent changed are detached first, so that reattaching them in any order can't form a cycle for a moment
+            for(const auto& record : records){
+                Entity* entity = pool.get(record.handle);
+                Entity* parent = record.parent < 0 ? nullptr : pool.get(records[record.parent].handle);
+                if(entity->parent != parent) entity->setParent(nullptr);
+            }
+            for(const auto& record : records){
+                Entity* entity = pool.get(record.handle);
+                entity->setName(record.name);
+                const NameID* savedTags = snapshot.tags.data() + record.firstTag;
+                if(!std::equal(entity->tags.begin(), entity->tags.end(), savedTags, savedTags + record.tagCount)){
+                    while(!entity->tags.empty()) entity->removeTag(entity->tags.back());
+                    for(std::uint32_t tag = 0; tag < record.tagCount; ++tag) entity->addTag(savedTags[tag]);
+                }
+                entity->setParent(record.parent < 0 ? nullptr : pool.get(records[record.parent].handle));
+                entity->localTransform = record.localTransform;
+                // The restored entities jump to their saved place, so they are not blended with where they were
+                entity->skipInterpolation();
+                for(std::uint32_t index = 0; index < record.componentCount; ++index){
+                    const auto& saved = snapshot.components[record.firstComponent + index];
+                    Component* component = entity->components[index];
+                    saved.functions->assign(component, snapshot.at(saved.offset));
+                    notify(component, ComponentEvent::MODIFIED);
+                }
+            }
+            return;
+        }
+
+        // Otherwise, we rebuild the world. Since "clear" keeps all the memory, rebuilding a world of the same size doesn't allocate.
+        clear();
+        for(const auto& record : records){
             Entity* entity = add();
-            entity->parent = parent;
-            entity->deserialize(entityData);
-            
-            if(entityData.contains("children")){
-                //DONE: (Req 8) Recursively call this world's "deserialize" using the children data
-                // and the current entity as the parent
-                deserialize(entityData["children"], entity);
+            entity->setName(record.name);
+            for(std::uint32_t tag = 0; tag < record.tagCount; ++tag) entity->addTag(snapshot.tags[record.firstTag + tag]);
+            entity->localTransform = record.localTransform;
+            for(std::uint32_t index = 0; index < record.componentCount; ++index){
+                const auto& saved = snapshot.components[record.firstComponent + index];
+                // The storage exists since the component was saved from it. The data is copied before attaching the component,
+                // so the observers of ADDED events see the restored data.
+                Component* component = storages[saved.typeID]->create();
+                saved.functions->assign(component, snapshot.at(saved.offset));
+                entity->attachComponent(component);
+            }
+        }
+        // The parents are set once all the entities exist since a parent could come after its children in the entity list
+        for(size_t index = 0; index < records.size(); ++index)
+            if(records[index].parent >= 0) entities[index]->setParent(entities[records[index].parent]);
+    }
+
+    namespace {
+
+        // Intersects a ray with the surface of an entity. The ray is moved to the local space of the entity instead of moving the triangles.
+        // Since the transformation is affine, a distance along the local ray is the same as along the world ray.
+        bool raycastEntity(const Entity* entity, const glm::vec3& origin, const glm::vec3& direction, float maxDistance, QueryHit& hit){
+            const glm::mat4& localToWorld = entity->getLocalToWorldMatrix();
+            glm::mat4 worldToLocal(1.0f);
+            glm::vec3 localOrigin(0.0f), localDirection(0.0f), localNormal(0.0f);
+            bool hasTriangles = false, found = false;
+            entity->forEachCollisionMesh([&](const Mesh* mesh){
+                const auto& positions = mesh->getPositions();
+                const auto& triangles = mesh->getTriangles();
+                if(triangles.empty()) return;
+                if(!hasTriangles){
+                    worldToLocal = glm::inverse(localToWorld);
+                    localOrigin = worldToLocal * glm::vec4(origin, 1.0f);
+                    localDirection = worldToLocal * glm::vec4(direction, 0.0f);
+                    hasTriangles = true;
+                }
+                // Most of the rays that enter the entity's world bounds still miss the (tighter) local box of the mesh
+                float distance;
+                if(!mesh->getBounds().intersectRay(localOrigin, 1.0f / localDirection, maxDistance, distance)) return;
+                for(size_t index = 0; index + 2 < triangles.size(); index += 3){
+                    const glm::vec3& a = positions[triangles[index]];
+                    const glm::vec3& b = positions[triangles[index + 1]];
+                    const glm::vec3& c = positions[triangles[index + 2]];
+                    if(intersectRayTriangle(localOrigin, localDirection, a, b, c, maxDistance, distance)){
+                        maxDistance = distance;
+                        localNormal = glm::cross(b - a, c - a);
+                        found = true;
+                    }
+                }
+            });
+
+            glm::vec3 normal;
+            if(hasTriangles){
+                if(!found) return false;
+                // The normals are transformed by the inverse transpose, so they stay perpendicular to the surface after a non uniform scale
+                normal = glm::transpose(glm::mat3(worldToLocal)) * localNormal;
+            } else {
+                AABB bounds;
+                if(!entity->getWorldBounds(bounds)) return false;
+                glm::vec3 inverseDirection = 1.0f / direction;
+                if(!bounds.intersectRay(origin, inverseDirection, maxDistance, maxDistance)) return false;
+                // The ray enters the box through the face of the slab that it enters last
+                glm::vec3 enter = glm::min((bounds.min - origin) * inverseDirection, (bounds.max - origin) * inverseDirection);
+                int axis = enter.x > enter.y ? (enter.x > enter.z ? 0 : 2) : (enter.y > enter.z ? 1 : 2);
+                normal = glm::vec3(0.0f);
+                normal[axis] = 1.0f;
+            }
+            normal = glm::normalize(normal);
+            hit.entity = const_cast<Entity*>(entity);
+            hit.distance = maxDistance;
+            hit.point = origin + direction * maxDistance;
+            hit.normal = glm::dot(normal, direction) > 0.0f ? -normal : normal;
+            return true;
+        }
+
+        // Tests the surface of an entity with a shape. "overlapsTriangle(a, b, c)" tests a world space triangle with the shape,
+        // "overlapsBox(box)" tests the world bounds of an entity that has no triangles and "shapeBounds" is the box around the shape.
+        // The triangles are moved to the world space (unlike the rays, the shapes would not keep their form in the local space after a non uniform scale).
+        template<typename TriangleTest, typename BoxTest>
+        bool overlapEntity(const Entity* entity, const glm::vec3& center, const AABB& shapeBounds, TriangleTest overlapsTriangle, BoxTest overlapsBox,
+            std::vector<glm::vec3>& worldPositions, QueryHit& hit){
+            const glm::mat4& localToWorld = entity->getLocalToWorldMatrix();
+            bool hasTriangles = false, found = false;
+            float closestDistance2 = std::numeric_limits<float>::max();
+            entity->forEachCollisionMesh([&](const Mesh* mesh){
+                const auto& positions = mesh->getPositions();
+                const auto& triangles = mesh->getTriangles();
+                if(triangles.empty()) return;
+                hasTriangles = true;
+                if(!mesh->getBounds().transformed(localToWorld).overlaps(shapeBounds)) return;
+                worldPositions.resize(positions.size());
+                for(size_t index = 0; index < positions.size(); ++index)
+                    worldPositions[index] = localToWorld * glm::vec4(positions[index], 1.0f);
+                for(size_t index = 0; index + 2 < triangles.size(); index += 3){
+                    const glm::vec3& a = worldPositions[triangles[index]];
+                    const glm::vec3& b = worldPositions[triangles[index + 1]];
+                    const glm::vec3& c = worldPositions[triangles[index + 2]];
+                    AABB triangleBounds(glm::min(glm::min(a, b), c), glm::max(glm::max(a, b), c));
+                    if(!triangleBounds.overlaps(shapeBounds) || !overlapsTriangle(a, b, c)) continue;
+                    glm::vec3 point = closestPointOnTriangle(center, a, b, c);
+                    float distance2 = glm::dot(point - center, point - center);
+                    if(distance2 >= closestDistance2) continue;
+                    closestDistance2 = distance2;
+                    glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+                    hit.point = point;
+                    hit.normal = glm::dot(normal, center - point) < 0.0f ? -normal : normal;
+                    found = true;
+                }
+            });
+
+            if(!hasTriangles){
+                AABB bounds;
+                if(!entity->getWorldBounds(bounds) || !overlapsBox(bounds)) return false;
+                hit.point = glm::clamp(center, bounds.min, bounds.max);
+                closestDistance2 = glm::dot(hit.point - center, hit.point - center);
+                if(closestDistance2 > 0.0f){
+                    hit.normal = (center - hit.point) / std::sqrt(closestDistance2);
+                } else {
+                    // The center is inside the box, so the normal is the one of the nearest face
+                    glm::vec3 toMin = center - bounds.min, toMax = bounds.max - center;
+                    glm::vec3 nearest = glm::min(toMin, toMax);
+                    int axis = nearest.x < nearest.y ? (nearest.x < nearest.z ? 0 : 2) : (nearest.y < nearest.z ? 1 : 2);
+                    hit.normal = glm::vec3(0.0f);
+                    hit.normal[axis] = toMin[axis] < toMax[axis] ? -1.0f : 1.0f;
+                }
+                found = true;
             }
+            if(!found) return false;
+            hit.entity = const_cast<Entity*>(entity);
+            hit.distance = std::sqrt(closestDistance2);
+            return true;
+        }
+
+        void sortHits(std::vector<QueryHit>& hits){
+            std::sort(hits.begin(), hits.end(), [](const QueryHit& first, const QueryHit& second){ return first.distance < second.distance; });
         }
+
+    }
+
+    bool World::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<QueryHit>& hits, const QueryFilter& filter) const {
+        hits.clear();
+        float length = glm::length(direction);
+        if(length <= 0.0f) return false;
+        glm::vec3 unitDirection = direction / length;
+        bvh.queryRay(origin, unitDirection, maxDistance, [&](Entity* entity, float){
+            QueryHit hit;
+            if((!filter || filter(entity)) && raycastEntity(entity, origin, unitDirection, maxDistance, hit)) hits.push_back(hit);
+            return maxDistance;
+        });
+        sortHits(hits);
+        return !hits.empty();
+    }
+
+    bool World::raycastClosest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, QueryHit& hit, const QueryFilter& filter) const {
+        float length = glm::length(direction);
+        if(length <= 0.0f) return false;
+        glm::vec3 unitDirection = direction / length;
+        bool found = false;
+        bvh.queryRay(origin, unitDirection, maxDistance, [&](Entity* entity, float){
+            // Only a hit closer than the best one so far is accepted, so the bounds behind it are skipped from now on
+            if((!filter || filter(entity)) && raycastEntity(entity, origin, unitDirection, maxDistance, hit)){
+                maxDistance = hit.distance;
+                found = true;
+            }
+            return maxDistance;
+        });
+        return found;
+    }
+
+    bool World::overlapBox(const AABB& box, std::vector<QueryHit>& hits, const QueryFilter& filter) const {
+        hits.clear();
+        std::vector<glm::vec3> worldPositions;
+        auto overlapsTriangle = [&box](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){ return triangleOverlapsBox(a, b, c, box); };
+        auto overlapsBox = [&box](const AABB& bounds){ return box.overlaps(bounds); };
+        bvh.queryOverlap(box, [&](Entity* entity){
+            QueryHit hit;
+            if((!filter || filter(entity)) && overlapEntity(entity, box.getCenter(), box, overlapsTriangle, overlapsBox, worldPositions, hit))
+                hits.push_back(hit);
+        });
+        sortHits(hits);
+        return !hits.empty();
+    }
+
+    bool World::overlapSphere(const glm::vec3& center, float radius, std::vector<QueryHit>& hits, const QueryFilter& filter) const {
+        hits.clear();
+        std::vector<glm::vec3> worldPositions;
+        float radius2 = radius * radius;
+        AABB sphereBounds(center - radius, center + radius);
+        auto overlapsTriangle = [&](const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){
+            glm::vec3 offset = closestPointOnTriangle(center, a, b, c) - center;
+            return glm::dot(offset, offset) <= radius2;
+        };
+        auto overlapsBox = [&](const AABB& bounds){
+            glm::vec3 offset = glm::clamp(center, bounds.min, bounds.max) - center;
+            return glm::dot(offset, offset) <= radius2;
+        };
+        bvh.queryOverlap(sphereBounds, [&](Entity* entity){
+            QueryHit hit;
+            if((!filter || filter(entity)) && overlapEntity(entity, center, sphereBounds, overlapsTriangle, overlapsBox, worldPositions, hit))
+                hits.push_back(hit);
+        });
+        sortHits(hits);
+        return !hits.empty();
     }
 
-}
\ No newline at end of file
+}
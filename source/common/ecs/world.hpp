@@ -1,15 +1,128 @@
 #pragma once
 
-#include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <istream>
 #include "entity.hpp"
+#include "entity-pool.hpp"
+#include "view.hpp"
+#include "transform-hierarchy.hpp"
+#include "command-buffer.hpp"
+#include "world-snapshot.hpp"
+#include "../spatial/bvh.hpp"
+#include "../spatial/spatial-hash.hpp"
 
 namespace our {
 
+    // A result of the ray and shape queries of the world (see "World::raycast", "World::overlapBox" and "World::overlapSphere")
+    struct QueryHit {
+        Entity* entity;
+        // For a ray, the distance along the ray to the hit. For a shape, the distance from the shape's center to the closest point of the entity.
+        float distance;
+        glm::vec3 point; // The hit point (or the closest point of the entity to the shape's center) in the world space
+        glm::vec3 normal; // The normal of the entity's surface at "point" in the world space, facing the ray's origin (or the shape's center)
+    };
+
     // This class holds a set of entities
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
-        std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
+        EntityPool pool; // The pool from which the entities of this world are allocated
+        std::vector<Entity*> entities; // These are the entities held by this world (stored densely for fast iteration)
+        std::vector<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
                                                       // when deleteMarkedEntities is called
+        std::vector<std::unique_ptr<ComponentStorageBase>> storages; // For each component type ID, a storage holding all the components of that type
+        std::unordered_map<ComponentMask, std::unique_ptr<QueryCache>> queries; // For each set of component types that was viewed, the cached list of matching entities
+        TransformHierarchy transforms; // The depth-sorted copy of the hierarchy used to compute all the world matrices in one pass
+        // For each interned name (or tag), the entities having it in the order they got it. Unnamed entities are not indexed.
+        typedef std::unordered_map<NameID, std::vector<Entity*>> NameIndex;
+        NameIndex entitiesByName;
+        NameIndex entitiesByTag;
+        CommandBuffer commands; // The structural changes recorded by the systems and waiting to be applied by "playbackCommands"
+        std::uint32_t entityListVersion = 0; // Incremented whenever entities are added or deleted (see "getEntityListVersion")
+        std::uint32_t componentListVersion = 0; // Incremented whenever a component is added or removed
+        std::uint32_t restoreCount = 0; // Incremented whenever a snapshot is restored (see "getRestoreCount")
+        std::uint32_t nameVersion = 0; // Incremented whenever an entity changes its name (see "getNameVersion")
+        BVH bvh; // The bounding volume hierarchy over the bounds of the entities (see "getBVH")
+        SpatialHash spatialHash{2.0f}; // The uniform grid over the positions of the entities (see "getSpatialHash")
+        float interpolationFactor = 1.0f; // The weight of the current world matrices in the drawn ones (see "setInterpolationFactor")
+        // The template entity of each prefab (see "deserializePrefabs"). The templates live in a separate world,
+        // so they are not visible to the systems and the renderer, and instancing one copies its already deserialized components.
+        std::unique_ptr<World> prefabWorld;
+        std::unordered_map<NameID, Entity*> prefabs;
+
+    public:
+        typedef std::uint32_t ObserverID; // Identifies an observer so that it can be removed by "unobserve"
+    private:
+        // An observer is a callback that is called when a component event of a certain type happens
+        struct Observer {
+            ObserverID id;
+            ComponentEvent event;
+            std::function<void(Component*)> callback;
+        };
+        std::array<std::vector<Observer>, MAX_COMPONENT_TYPES> observers; // For each component type ID, the observers of its events
+        ObserverID nextObserverID = 1; // The ID of the next observer
+        Tick currentTick = 1; // Incremented once per frame by "advanceTick"
+        std::array<Tick, MAX_COMPONENT_TYPES> structureTicks{}; // For each component type ID, the tick at which a component was last added or removed
+        std::array<Tick, MAX_COMPONENT_TYPES> changeTicks{}; // For each component type ID, the tick at which a component was last added, removed or modified
+
+        // Calls the observers of the given event for the given component
+        void emit(Component* component, ComponentEvent event){
+            for(auto& observer : observers[component->typeID])
+                if(observer.event == event) observer.callback(component);
+        }
+
+        // Updates the ticks of the component and of its type, then calls the observers of the event
+        void notify(Component* component, ComponentEvent event){
+            ComponentTypeID typeID = component->typeID;
+            if(event == ComponentEvent::ADDED) component->addedTick = currentTick;
+            if(event != ComponentEvent::MODIFIED){
+                structureTicks[typeID] = currentTick;
+                ++componentListVersion;
+            }
+            component->changedTick = currentTick;
+            changeTicks[typeID] = currentTick;
+            emit(component, event);
+        }
+
+        // Adds the entity to the list of the given name (or tag) in the index
+        static void indexEntity(NameIndex& index, NameID id, Entity* entity){
+            if(id != EMPTY_NAME) index[id].push_back(entity);
+        }
+        // Removes the entity from the list of the given name (or tag) in the index
+        static void unindexEntity(NameIndex& index, NameID id, Entity* entity){
+            auto it = index.find(id);
+            if(it == index.end()) return;
+            auto& list = it->second;
+            if(auto position = std::find(list.begin(), list.end(), entity); position != list.end()) list.erase(position);
+        }
+
+        friend Entity; // The entity is a friend since it has to notify the world whenever its components change
+        friend Component; // The component is a friend since it notifies the world when it is marked as changed
+
+        // Returns the storage of the given component type in this world. If it doesn't exist yet, it is created like the given storage
+        // (which holds the same component type in another world).
+        ComponentStorageBase& getStorage(ComponentTypeID typeID, const ComponentStorageBase& like){
+            if(typeID >= storages.size()) storages.resize(typeID + 1);
+            auto& storage = storages[typeID];
+            if(!storage) storage = like.createEmpty();
+            return *storage;
+        }
+
+        // Adds a copy of the given entity (which may belong to another world), its components and its children to this world and returns it
+        Entity* cloneEntity(const Entity* source, Entity* parent);
+
+        // Adds the instances of a prefab described by a json object to the world and returns the first one (see "deserializePrefabs")
+        Entity* deserializeInstances(const nlohmann::json& data, Entity* parent);
+
+        // Re-evaluates the given entity against the cached queries that require the given component type.
+        // This is called whenever the entity gains or loses a component of that type.
+        void refreshQueries(Entity* entity, ComponentTypeID typeID){
+            for(auto& [mask, query] : queries)
+                if(mask.test(typeID)) query->refresh(entity);
+        }
     public:
 
         World() = default;
@@ -19,6 +132,45 @@ namespace our {
         // If any of the entities has children, this function will be called recursively for these children
         void deserialize(const nlohmann::json& data, Entity* parent = nullptr);
 
+        // This deserializes a single entity (and its children) from a json object, adds it to the world and returns it.
+        // If the object refers to a prefab, the instances of the prefab are added instead and the first one is returned (or null if there is none).
+        Entity* deserializeEntity(const nlohmann::json& entityData, Entity* parent = nullptr);
+
+        // This builds the prefabs found in a json object whose keys are the prefab names and whose values are entities (in the format of "deserialize").
+        // Each prefab is deserialized once into a template entity (so its assets are looked up once), then every instance copies the template's components.
+        // An entity in the world array becomes a list of instances if it has a "prefab" key, e.g.:
+        //      { "prefab": "fence", "positions": [[0, 0, 6], [2, 0, 6]], "rotations": [[0, 90, 0]] }
+        // There is one instance per element of the longest of "positions", "rotations" (in degrees) and "scales".
+        // A shorter array repeats its last element, so a single element is shared by all the instances.
+        // A missing array (or the singular "position", "rotation" or "scale" if given) keeps the prefab's value.
+        // "name" replaces the prefab's name and "children" are added under every instance. A prefab with the name of an existing one replaces it.
+        void deserializePrefabs(const nlohmann::json& data);
+
+        // This adds an instance of the given prefab (with its children) to the world and returns it (or null if there is no such prefab)
+        Entity* instantiate(NameID prefab, Entity* parent = nullptr);
+        Entity* instantiate(std::string_view prefab, Entity* parent = nullptr) { return instantiate(internName(prefab), parent); }
+
+        // This deletes all the prefabs (the instances in the world are not affected).
+        // It should be called before the assets are cleared since the templates refer to them.
+        void clearPrefabs(){
+            if(prefabWorld) prefabWorld->clear();
+            prefabs.clear();
+        }
+
+        // This parses the json in "input" and adds the entities of the array found at the given JSON pointer (e.g. "/scene/world") to the world.
+        // The entities are created as the parser reaches them, so only one root entity is held as json at a time (see "json-stream.hpp").
+        void deserializeStreamed(std::istream& input, const std::string& pointer);
+
+        // This writes all the entities of the world and the data of their components into a cooked scene file (see "cooked-scene.hpp").
+        // "sourceSize" and "sourceHash" describe the config file the entities came from, they are stored in the header of the file.
+        // It returns false if the file couldn't be written.
+        bool cook(const std::string& path, std::uint64_t sourceSize = 0, std::uint64_t sourceHash = 0);
+
+        // This adds the entities of a cooked scene file to the world (like "deserialize" does for a json array).
+        // It returns false without changing the world if the file is missing or malformed, was cooked by another version, uses an unknown component type
+        // or was cooked from another config file (its source size or hash differ from the given ones).
+        bool deserializeCooked(const std::string& path, std::uint64_t sourceSize = 0, std::uint64_t sourceHash = 0);
+
         // This adds an entity to the entities set and returns a pointer to that entity
         // WARNING The entity is owned by this world so don't use "delete" to delete it, instead, call "markForRemoval"
         // to put it in the "markedForRemoval" set. The elements in the "markedForRemoval" set will be removed and
@@ -26,42 +178,324 @@ namespace our {
         Entity* add() {
             //DONE: (Req 8) Create a new entity, set its world member variable to this,
             // and don't forget to insert it in the suitable container.
-            Entity* entity = new Entity();
+            Entity* entity = pool.create();
             entity->world = this;
-            entities.insert(entity);
+            entity->denseIndex = entities.size();
+            entities.push_back(entity);
+            transforms.markDirty();
+            ++entityListVersion;
             return entity;
         }
 
-        // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
+        // This returns and immutable reference to the list of all entites in the world.
+        const std::vector<Entity*>& getEntities() {
             return entities;
         }
 
+        // This returns a number that changes whenever an entity is added to or deleted from the world,
+        // so a structure built from the entity list (e.g. a spatial hash) only needs to visit the whole list again when it changed
+        std::uint32_t getEntityListVersion() const {
+            return entityListVersion;
+        }
+
+        // This returns a number that changes whenever an entity gets a new name, so together with "getEntityListVersion",
+        // a list found with "findAllByName" only needs to be searched again when one of them changed
+        std::uint32_t getNameVersion() const {
+            return nameVersion;
+        }
+
+        // This returns the entity referred to by the given handle.
+        // If the entity was deleted (or the handle is null), it returns a nullptr, so it is safe to keep handles across frames.
+        Entity* get(EntityHandle handle) {
+            return pool.get(handle);
+        }
+
+        // This returns the first entity that was given the name (or null if no entity has this name).
+        // It is a hash lookup, so systems should use it instead of looping over the entities and comparing their names.
+        Entity* findByName(NameID name) {
+            auto it = entitiesByName.find(name);
+            return it == entitiesByName.end() || it->second.empty() ? nullptr : it->second.front();
+        }
+        Entity* findByName(std::string_view name) { return findByName(internName(name)); }
+
+        // This returns all the entities that have the given name (since names don't have to be unique)
+        const std::vector<Entity*>& findAllByName(NameID name) {
+            static const std::vector<Entity*> none;
+            auto it = entitiesByName.find(name);
+            return it == entitiesByName.end() ? none : it->second;
+        }
+        const std::vector<Entity*>& findAllByName(std::string_view name) { return findAllByName(internName(name)); }
+
+        // This returns all the entities that have the given tag
+        const std::vector<Entity*>& findAllByTag(NameID tag) {
+            static const std::vector<Entity*> none;
+            auto it = entitiesByTag.find(tag);
+            return it == entitiesByTag.end() ? none : it->second;
+        }
+        const std::vector<Entity*>& findAllByTag(std::string_view tag) { return findAllByTag(internName(tag)); }
+
+        // This returns the storage that holds all the components of type T in this world (the storage is created if it doesn't exist yet).
+        // Iterating over the storage visits every component of type T in memory order, so systems that only need one component type
+        // should loop over it instead of looking for the component in every entity.
+        template<typename T>
+        ComponentStorage<T>& getComponents() {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            ComponentTypeID typeID = getComponentTypeID<T>();
+            if(typeID >= storages.size()) storages.resize(typeID + 1);
+            auto& storage = storages[typeID];
+            if(!storage) storage = std::make_unique<ComponentStorage<T>>();
+            return *static_cast<ComponentStorage<T>*>(storage.get());
+        }
+
+        // This returns a view over the entities that own all the components "Components...".
+        // The first time a view is requested, the world scans its entities to fill the view's match list.
+        // After that, the match list is updated incrementally whenever a component is added or removed,
+        // so iterating over a view costs nothing for the entities that don't match it.
+        template<typename... Components>
+        View<Components...> view() {
+            static_assert(sizeof...(Components) > 0, "A view must require at least one component type");
+            ComponentMask mask = makeComponentMask<Components...>();
+            auto& query = queries[mask];
+            if(!query){
+                query = std::make_unique<QueryCache>(mask);
+                for(Entity* entity : entities)
+                    query->refresh(entity);
+            }
+            return View<Components...>(query.get());
+        }
+
+        // This saves all the entities, their transforms and the data of their components into the given snapshot (reusing its memory).
+        // The snapshot can later be restored into this world (e.g. to restart a level) without parsing the scene again.
+        void snapshot(WorldSnapshot& snapshot);
+
+        // This puts the world back in the state saved in the snapshot, which must have been taken from this world.
+        // If the world still holds the same entities with the same component types (e.g. nothing was spawned or deleted since the snapshot),
+        // the saved data is copied over the live entities and components in place, so every handle stays valid
+        // and the observers receive MODIFIED events. Otherwise, the world is cleared and rebuilt from the snapshot, so the old handles become stale.
+        void restore(const WorldSnapshot& snapshot);
+
+        // This returns a number that changes whenever a snapshot is restored, so a system that keeps its own copy of entity data
+        // (e.g. the car positions of the traffic simulation) knows that it must read it again from the entities
+        std::uint32_t getRestoreCount() const {
+            return restoreCount;
+        }
+
+        // This computes the local to world matrix of every entity in one batched pass and stores it in the entity's cache.
+        // It should be called once per frame after the systems moved the entities and before rendering.
+        // "Entity::getLocalToWorldMatrix" returns the matrices computed here till the next call, so the changes made to "localTransform"
+        // in between are only seen after it.
+        // If a job system is given, part of the work is split between its workers.
+        // The bounding volume hierarchy is brought up to date with the new matrices too (see "getBVH").
+        void updateTransforms(JobSystem* jobs = nullptr) {
+            transforms.update(entities, jobs);
+            bvh.update(entities, (std::uint64_t(entityListVersion) << 32) | componentListVersion);
+        }
+
+        // This returns true if no entity was created or reparented since the last "updateTransforms", so "Entity::getLocalToWorldMatrix"
+        // is a plain read for every entity (and many threads can call it at once)
+        bool areTransformsUpToDate() const {
+            return !transforms.isDirty();
+        }
+
+        // The simulation runs in fixed updates while the frames are drawn at their own rate (see "State::onFixedUpdate"),
+        // so a frame usually falls between two fixed updates. To draw it, the world matrix of each entity at the start of the last fixed update
+        // is blended with its current world matrix:
+        //  - "beginFixedStep" should be called at the start of every fixed update (before the systems run) to save the world matrices.
+        //  - "setInterpolationFactor" should be called before rendering with the fraction of a fixed update that passed since the last one
+        //    (see "Application::getInterpolationFactor"), then the renderer draws "Entity::getInterpolatedLocalToWorldMatrix".
+        // Drawing only reads the saved and the current matrices, so the simulated transforms, the BVH and the spatial hash are left alone.
+        // The entities added since the start of the last fixed update and the ones that called "Entity::skipInterpolation" aren't blended.
+        void beginFixedStep();
+        void setInterpolationFactor(float factor) { interpolationFactor = factor; }
+        float getInterpolationFactor() const { return interpolationFactor; }
+
+        // This returns the bounding volume hierarchy over the world space bounds of the entities that have bounds (e.g. a mesh renderer).
+        // It can be used for frustum, overlap and ray queries (see "bvh.hpp") and it is as up to date as the last "updateTransforms".
+        // It is emptied when entities are deleted and filled again by the next "updateTransforms", so it never returns a deleted entity.
+        const BVH& getBVH() const {
+            return bvh;
+        }
+
+        // This returns the spatial hash over the world positions of all the entities. It is the broadphase of the swept collision checks
+        // (see "SpatialHash::querySwept"), so it is updated once per fixed update by "beginFixedStep": its positions are the ones
+        // at the start of the current fixed update and its previous positions are the ones at the start of the previous fixed update.
+        // The queries take a filter to choose the entities they care about. They only read the hash, so many systems can query at once.
+        // The entities deleted during a fixed update stay in it till the next "beginFixedStep", so it should only be queried by the systems
+        // (which record their deletions in the command buffer).
+        const SpatialHash& getSpatialHash() const {
+            return spatialHash;
+        }
+
+        // The ray and shape queries find the candidates with the bounding volume hierarchy, then test the triangles of their collision meshes
+        // (see "Component::getCollisionMesh"). An entity that has bounds but no triangles is tested with its world bounds instead.
+        // Like the hierarchy, they see the entities as of the last "updateTransforms". They only read the world, so many systems can query at once.
+        // Each entity is reported once (with its closest hit) and the hits are sorted from the closest to the farthest.
+        // If a filter is given, only the entities for which it returns true are tested. They return false if nothing was hit.
+        typedef std::function<bool(const Entity*)> QueryFilter;
+
+        // Finds the entities hit by the ray before "maxDistance" ("direction" doesn't need to be normalized, the distances are in world units)
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<QueryHit>& hits, const QueryFilter& filter = nullptr) const;
+        // Finds the first entity hit by the ray. It is faster than "raycast" since everything behind the closest hit so far is skipped.
+        bool raycastClosest(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, QueryHit& hit, const QueryFilter& filter = nullptr) const;
+        // Finds the entities whose surface overlaps the box (a box that is completely inside a closed mesh doesn't touch its surface)
+        bool overlapBox(const AABB& box, std::vector<QueryHit>& hits, const QueryFilter& filter = nullptr) const;
+        // Finds the entities whose surface overlaps the sphere
+        bool overlapSphere(const glm::vec3& center, float radius, std::vector<QueryHit>& hits, const QueryFilter& filter = nullptr) const;
+
+        // This increments the world tick. It should be called once at the start of every frame,
+        // so that the changes made during the frame can be told apart from the ones made in the previous frames.
+        void advanceTick() {
+            ++currentTick;
+        }
+
+        // This returns the current world tick
+        Tick getTick() const {
+            return currentTick;
+        }
+
+        // This returns the tick at which a component of type T was last added or removed.
+        // A system that caches the components of a type only needs to search for them again if this tick changed since it cached them.
+        template<typename T>
+        Tick getStructureTick() const {
+            return structureTicks[getComponentTypeID<T>()];
+        }
+
+        // This returns true if a component of type T was added or removed since "seenTick", then sets "seenTick" to the current structure tick.
+        // A system that caches the components of a type keeps one tick per type and only searches for them again when this returns true.
+        template<typename T>
+        bool hasStructureChanged(Tick& seenTick) const {
+            Tick tick = getStructureTick<T>();
+            if(tick == seenTick) return false;
+            seenTick = tick;
+            return true;
+        }
+
+        // This returns the first component of type T in its storage (or null if there is none), e.g. to find the camera of the scene.
+        // "cached" holds the entity found by the last call: it is returned while it still owns a component of type T.
+        // Otherwise the storage is only searched again if a component of type T was added or removed since the last search
+        // (see "hasStructureChanged"), so calling this every frame is usually a handle lookup.
+        template<typename T>
+        T* findFirst(EntityHandle& cached, Tick& searchedTick) {
+            if(Entity* entity = get(cached); entity)
+                if(T* component = entity->getComponent<T>(); component) return component;
+            if(!hasStructureChanged<T>(searchedTick)) return nullptr;
+            for(auto component : getComponents<T>()){
+                cached = component->getOwner()->getHandle();
+                return component;
+            }
+            return nullptr;
+        }
+
+        // This returns the tick at which a component of type T was last added, removed or marked as changed
+        template<typename T>
+        Tick getChangeTick() const {
+            return changeTicks[getComponentTypeID<T>()];
+        }
+
+        // This registers a callback that is called whenever the given event happens to a component of type T and returns the ID of the observer.
+        // The callback is called on the thread that caused the event (the thread of a system calling "markChanged" for MODIFIED events).
+        // WARNING: The callbacks must not register or remove observers.
+        template<typename T>
+        ObserverID observe(ComponentEvent event, std::function<void(T*)> callback) {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            ObserverID id = nextObserverID++;
+            observers[getComponentTypeID<T>()].push_back({id, event, [callback = std::move(callback)](Component* component){
+                callback(static_cast<T*>(component));
+            }});
+            return id;
+        }
+
+        // This removes the observer with the given ID
+        void unobserve(ObserverID id) {
+            for(auto& list : observers)
+                list.erase(std::remove_if(list.begin(), list.end(), [id](const Observer& observer){ return observer.id == id; }), list.end());
+        }
+
+        // This returns the command buffer of this world. Systems (including ones running on worker threads) should record
+        // the entities and components they want to create or destroy into it instead of changing the world while it is being iterated.
+        CommandBuffer& getCommandBuffer() {
+            return commands;
+        }
+
+        // This applies the commands recorded in the command buffer then deletes the entities that were marked for removal.
+        // It should be called once per frame at a point where no system is running (e.g. after all the systems are updated).
+        void playbackCommands() {
+            commands.playback(this);
+            deleteMarkedEntities();
+        }
+
         // This marks an entity for removal by adding it to the "markedForRemoval" set.
         // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
         void markForRemoval(Entity* entity){
             //DONE: (Req 8) If the entity is in this world, add it to the "markedForRemoval" set.
-            markedForRemoval.insert(entity);
+            // The flag in the entity makes sure that it is only added once (a vector doesn't allocate per entity unlike a set)
+            if(entity && entity->world == this && !entity->markedForRemoval){
+                entity->markedForRemoval = true;
+                markedForRemoval.push_back(entity);
+            }
         }
 
         // This removes the elements in "markedForRemoval" from the "entities" set.
         // Then each of these elements are deleted.
         void deleteMarkedEntities(){
             //DONE: (Req 8) Remove and delete all the entities that have been marked for removal
+            if (markedForRemoval.empty()) return;
+            // First, we detach the marked entities from the hierarchy so that no entity keeps a pointer to a deleted parent or child.
+            // The children of a deleted entity are not deleted with it, they become root entities instead.
             for (Entity* entity : markedForRemoval){
-                entities.erase(entity);
-                delete entity;
+                entity->setParent(nullptr);
+                for (Entity* child : entity->children){
+                    child->parent = nullptr;
+                    child->invalidateWorldMatrices();
+                }
+                entity->children.clear();
+            }
+            for (Entity* entity : markedForRemoval){
+                // We swap the entity with the last one in the list so that the removal is O(1)
+                Entity* last = entities.back();
+                entities[entity->denseIndex] = last;
+                last->denseIndex = entity->denseIndex;
+                entities.pop_back();
+                for(auto& [mask, query] : queries)
+                    query->remove(entity);
+                unindexEntity(entitiesByName, entity->name, entity);
+                for(NameID tag : entity->tags)
+                    unindexEntity(entitiesByTag, tag, entity);
+                pool.destroy(entity);
             }
             markedForRemoval.clear();
+            transforms.markDirty();
+            bvh.clear();
+            ++entityListVersion;
         }
 
-        //This deletes all entities in the world
+        //This deletes all entities in the world (the prefabs are kept, see "clearPrefabs")
         void clear(){
             //DONE: (Req 8) Delete all the entites and make sure that the containers are empty
+            // The components are destroyed storage by storage and the entities are reset by the pool in one pass,
+            // so nothing is freed one at a time and all the memory (chunks, slabs, lists) is kept to rebuild the world without allocating
+            // The observers are told about the removed components before they are destroyed (if there are any observers)
             for (Entity* entity : entities)
-                delete entity;
+                for (Component* component : entity->components)
+                    if (!observers[component->typeID].empty()) emit(component, ComponentEvent::REMOVED);
+            for (ComponentTypeID typeID = 0; typeID < storages.size(); ++typeID){
+                if (!storages[typeID] || storages[typeID]->size() == 0) continue;
+                structureTicks[typeID] = changeTicks[typeID] = currentTick;
+                storages[typeID]->clear();
+            }
+            pool.clear();
             entities.clear();
             markedForRemoval.clear();
+            commands.clear();
+            transforms.markDirty();
+            bvh.clear();
+            spatialHash.clear();
+            ++entityListVersion;
+            // The index lists are emptied but kept (with their memory) in case the same names are used again
+            for (auto& [name, list] : entitiesByName) list.clear();
+            for (auto& [tag, list] : entitiesByTag) list.clear();
+            for(auto& [mask, query] : queries)
+                query->clear();
         }
 
         //Since the world owns all of its entities, they should be deleted alongside it.
@@ -74,4 +508,63 @@ namespace our {
         World &operator=(World const &) = delete;
     };
 
+    // This is defined here (instead of "entity.hpp") since it needs the complete World type to reach the component storages
+    template<typename T>
+    T* Entity::addComponent(){
+        static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+        //DONE: (Req 8) Create an component of type T, set its "owner" to be this entity, then push it into the component's list
+        // Don't forget to return a pointer to the new component
+        T* comp = world->getComponents<T>().create();
+        attachComponent(comp);
+        return comp;
+    }
+
+    inline void Entity::attachComponent(Component* component){
+        component->owner = this;
+        components.push_back(component);
+        // If the entity already has a component of this type, the older one stays the one returned by "getComponent"
+        ComponentTypeID typeID = component->getTypeID();
+        if(!componentsByType[typeID]) componentsByType[typeID] = component;
+        componentMask.set(typeID);
+        world->refreshQueries(this, typeID);
+        world->notify(component, ComponentEvent::ADDED);
+    }
+
+    // The command buffer functions are defined here since they need the complete World and Entity types
+    inline void CommandBuffer::create(std::function<void(Entity*)> setup){
+        record([setup = std::move(setup)](World* world){
+            Entity* entity = world->add();
+            if(setup) setup(entity);
+        });
+    }
+
+    inline void CommandBuffer::destroy(EntityHandle entity){
+        record([entity](World* world){
+            world->markForRemoval(world->get(entity));
+        });
+    }
+
+    template<typename T>
+    void CommandBuffer::addComponent(EntityHandle entity, std::function<void(T*)> setup){
+        record([entity, setup = std::move(setup)](World* world){
+            if(Entity* target = world->get(entity); target){
+                T* component = target->addComponent<T>();
+                if(setup) setup(component);
+            }
+        });
+    }
+
+    template<typename T>
+    void CommandBuffer::removeComponent(EntityHandle entity){
+        record([entity](World* world){
+            if(Entity* target = world->get(entity); target)
+                target->deleteComponent<T>();
+        });
+    }
+
+    // This is defined here since it needs the complete World type
+    inline void Component::markChanged(){
+        owner->getWorld()->notify(this, ComponentEvent::MODIFIED);
+    }
+
 }
\ No newline at end of file
@@ -11,20 +11,21 @@ namespace our {
         bool enabled; // Is this class enabled (allowed to read user input)
         bool currentKeyStates[GLFW_KEY_LAST + 1];
         bool previousKeyStates[GLFW_KEY_LAST + 1];
+        bool fixedUpdateKeyStates[GLFW_KEY_LAST + 1]; // The state of the keys at the end of the last fixed update
 
     public:
         // Enable this object and capture current keyboard state from window
         void enable(GLFWwindow* window){
             enabled = true;
             for(int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++){
-                currentKeyStates[key] = previousKeyStates[key] = glfwGetKey(window, key);
+                currentKeyStates[key] = previousKeyStates[key] = fixedUpdateKeyStates[key] = glfwGetKey(window, key);
             }
         }
 
         // Disable this object and clear the state
         void disable(){
             for(int key = GLFW_KEY_SPACE; key <= GLFW_KEY_LAST; key++){
-                currentKeyStates[key] = previousKeyStates[key] = false;
+                currentKeyStates[key] = previousKeyStates[key] = fixedUpdateKeyStates[key] = false;
             }
         }
 
@@ -34,6 +35,12 @@ namespace our {
             std::memcpy(previousKeyStates, currentKeyStates, sizeof(previousKeyStates));
         }
 
+        // update the keyboard state at the end of a fixed update (see "justPressedSinceFixedUpdate")
+        void fixedUpdate(){
+            if(!enabled) return;
+            std::memcpy(fixedUpdateKeyStates, currentKeyStates, sizeof(fixedUpdateKeyStates));
+        }
+
         // Event functions called from GLFW callbacks in "application.cpp"
         void keyEvent(int key, int, int action, int){
             if(!enabled) return;
@@ -48,6 +55,9 @@ namespace our {
         [[nodiscard]] bool isPressed(int key) const {return currentKeyStates[key]; }
         // Was the key unpressed in the previous frame but became pressed in the current frame
         [[nodiscard]] bool justPressed(int key) const {return currentKeyStates[key] && !previousKeyStates[key];}
+        // Was the key unpressed at the end of the last fixed update but became pressed since then.
+        // A frame can run any number of fixed updates (even none), so this should be used instead of "justPressed" in "State::onFixedUpdate"
+        [[nodiscard]] bool justPressedSinceFixedUpdate(int key) const {return currentKeyStates[key] && !fixedUpdateKeyStates[key];}
         // Was the key pressed in the previous frame but became unpressed in the current frame
         [[nodiscard]] bool justReleased(int key) const {return !currentKeyStates[key] && previousKeyStates[key];}
 
@@ -0,0 +1,130 @@
+#include "job-system.hpp"
+
+namespace our {
+
+    // Each thread remembers the job system it works for and the index of its worker in it
+    static thread_local const JobSystem* currentSystem = nullptr;
+    static thread_local size_t currentIndex = 0;
+
+    JobSystem::JobSystem(size_t workerCount){
+        if(workerCount == 0) workerCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        for(size_t index = 0; index < workerCount; ++index)
+            workers.push_back(std::make_unique<Worker>());
+        // The calling thread is worker 0, so it runs jobs whenever it waits for a counter
+        currentSystem = this;
+        currentIndex = 0;
+        for(size_t index = 1; index < workerCount; ++index)
+            threads.emplace_back(&JobSystem::workerLoop, this, index);
+    }
+
+    JobSystem::~JobSystem(){
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running = false;
+        }
+        wakeUp.notify_all();
+        for(auto& thread : threads) thread.join();
+        if(currentSystem == this) currentSystem = nullptr;
+    }
+
+    size_t JobSystem::currentWorker() const {
+        return currentSystem == this ? currentIndex : workers.size();
+    }
+
+    void JobSystem::push(Job job){
+        size_t self = currentWorker();
+        Worker& worker = *workers[self < workers.size() ? self : 0];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.jobs.push_back(std::move(job));
+        }
+        {
+            // The counter is changed under the sleep mutex so that a worker can't miss the notification between checking it and sleeping
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            ++queued;
+        }
+        wakeUp.notify_one();
+    }
+
+    bool JobSystem::runOne(size_t self){
+        Job job;
+        bool found = false;
+        // First, we look in our own deque (newest job first)
+        if(self < workers.size()){
+            Worker& worker = *workers[self];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if(!worker.jobs.empty()){
+                job = std::move(worker.jobs.back());
+                worker.jobs.pop_back();
+                found = true;
+            }
+        }
+        // Then, we try to steal the oldest job of another worker, starting from the next worker so that the thieves spread out
+        for(size_t offset = 1; !found && offset <= workers.size(); ++offset){
+            size_t victim = (self + offset) % workers.size();
+            if(victim == self) continue;
+            Worker& worker = *workers[victim];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if(!worker.jobs.empty()){
+                job = std::move(worker.jobs.front());
+                worker.jobs.pop_front();
+                found = true;
+            }
+        }
+        if(!found) return false;
+        --queued;
+        job.function();
+        finish(job.counter);
+        return true;
+    }
+
+    void JobSystem::finish(JobCounter* counter){
+        if(!counter) return;
+        // The continuations are taken under the counter's mutex so that "schedule" either sees the counter at zero or adds to the list before we take it
+        std::vector<Job> released;
+        {
+            std::lock_guard<std::mutex> lock(counter->mutex);
+            if(counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                released.swap(counter->continuations);
+        }
+        // WARNING: The counter could be destroyed by a waiting thread from this point, so we don't touch it anymore
+        for(auto& job : released) push(std::move(job));
+    }
+
+    void JobSystem::schedule(std::function<void()> function, JobCounter* counter, JobCounter* dependency){
+        if(counter) counter->value.fetch_add(1, std::memory_order_relaxed);
+        Job job{std::move(function), counter};
+        if(dependency){
+            std::lock_guard<std::mutex> lock(dependency->mutex);
+            if(!dependency->isDone()){
+                dependency->continuations.push_back(std::move(job));
+                return;
+            }
+        }
+        push(std::move(job));
+    }
+
+    void JobSystem::wait(JobCounter& counter){
+        size_t self = currentWorker();
+        while(!counter.isDone()){
+            // Instead of blocking, we help running the jobs (which may be the ones we are waiting for)
+            if(!runOne(self)) std::this_thread::yield();
+        }
+        // The last job decrements the counter while holding its mutex, so we lock it once to make sure that the job
+        // released it before we return (the caller usually destroys the counter right after waiting)
+        std::lock_guard<std::mutex> lock(counter.mutex);
+    }
+
+    void JobSystem::workerLoop(size_t index){
+        currentSystem = this;
+        currentIndex = index;
+        while(true){
+            if(runOne(index)) continue;
+            // If there is nothing to run, we sleep till a job is pushed or the job system is destroyed
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this](){ return queued.load() > 0 || !running; });
+            if(!running) return;
+        }
+    }
+
+}
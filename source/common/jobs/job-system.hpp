@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    class JobCounter; // A forward declaration of the JobCounter Class
+
+    // A job is a function to run on one of the job system's threads.
+    // When it is done, its counter (if any) is decremented.
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter = nullptr;
+    };
+
+    // A job counter counts the jobs that were scheduled with it and didn't finish yet.
+    // It can be waited for (see "JobSystem::wait") and it can be used as the dependency of other jobs,
+    // in which case these jobs are held back till the counter reaches zero.
+    // WARNING: The counter must outlive the jobs that use it, so it is usually a local variable that is waited for before it goes out of scope.
+    class JobCounter {
+        std::atomic<int> value{0}; // The number of unfinished jobs
+        std::mutex mutex; // Guards "continuations"
+        std::vector<Job> continuations; // The jobs waiting for this counter to reach zero
+        friend class JobSystem;
+    public:
+        JobCounter() = default;
+        // Returns true if all the jobs counted by this counter are done
+        bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+
+        JobCounter(const JobCounter&) = delete;
+        JobCounter &operator=(JobCounter const &) = delete;
+    };
+
+    // The job system runs jobs on a fixed set of worker threads.
+    // Each worker (including the thread that created the job system) has its own deque of jobs:
+    // a worker pushes and pops the jobs it creates at the back of its own deque (so the most recent and cache-hot job runs first)
+    // and when its deque is empty, it steals the oldest job from the front of another worker's deque.
+    // A thread waiting for a counter keeps running jobs instead of blocking, so jobs can schedule and wait for other jobs without deadlocking.
+    class JobSystem {
+        // The deque of a worker. It is guarded by a mutex, which is cheap since a worker's deque is rarely touched by other threads.
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers; // Worker 0 belongs to the thread that created the job system
+        std::vector<std::thread> threads; // The threads of workers 1 to N-1
+        std::atomic<bool> running{true}; // Set to false to stop the threads
+        std::atomic<int> queued{0}; // The number of jobs waiting in the deques (used to put idle threads to sleep)
+        std::mutex sleepMutex; // Used with "wakeUp" to put idle threads to sleep
+        std::condition_variable wakeUp; // Notified when a job is pushed or when the job system is destroyed
+
+        // Returns the index of the worker running on the calling thread (or the number of workers if the thread isn't a worker of this system)
+        size_t currentWorker() const;
+        // Pushes a job into the deque of the calling thread's worker (or worker 0 if the thread isn't a worker)
+        void push(Job job);
+        // Pops a job from the given worker's deque or steals one from another worker, then runs it. Returns false if no job was found.
+        bool runOne(size_t self);
+        // Decrements the job's counter and releases the jobs that were waiting for it to reach zero
+        void finish(JobCounter* counter);
+        // The function run by each worker thread
+        void workerLoop(size_t index);
+
+    public:
+        // Creates a job system with the given number of workers including the calling thread.
+        // If the count is 0, one worker is created for each hardware thread.
+        explicit JobSystem(size_t workerCount = 0);
+        // Stops and joins the worker threads. The jobs that didn't start yet are dropped.
+        ~JobSystem();
+
+        // Returns the number of workers (including the thread that created the job system)
+        size_t getWorkerCount() const { return workers.size(); }
+
+        // Schedules a job. If "counter" is given, it is incremented now and decremented when the job is done.
+        // If "dependency" is given, the job doesn't start till the dependency counter reaches zero.
+        void schedule(std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+        // Returns when the counter reaches zero. Meanwhile, the calling thread runs the pending jobs.
+        void wait(JobCounter& counter);
+
+        // Calls "function(rangeBegin, rangeEnd)" for consecutive ranges of at most "grain" indices covering [begin, end)
+        // and returns when all of them are done. The ranges run concurrently, so the function must only touch its own range.
+        template<typename Function>
+        void parallelFor(size_t begin, size_t end, size_t grain, Function function){
+            if(begin >= end) return;
+            grain = std::max<size_t>(grain, 1);
+            JobCounter counter;
+            for(size_t start = begin; start < end; start += grain){
+                size_t stop = std::min(end, start + std::min(grain, end - start));
+                // The last range is run by the calling thread instead of being scheduled
+                if(stop == end){
+                    function(start, stop);
+                    break;
+                }
+                schedule([&function, start, stop](){ function(start, stop); }, &counter);
+            }
+            wait(counter);
+        }
+
+        // The job system should not be copyable since it owns threads
+        JobSystem(const JobSystem&) = delete;
+        JobSystem &operator=(JobSystem const &) = delete;
+    };
+
+}
@@ -0,0 +1,131 @@
+#include "json-stream.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace our {
+
+    // Escapes a key so that it can be used as a token of a JSON pointer ("~" becomes "~0" and "/" becomes "~1")
+    static std::string escapePointerToken(const std::string& key){
+        std::string token;
+        for(char c : key){
+            if(c == '~') token += "~0";
+            else if(c == '/') token += "~1";
+            else token += c;
+        }
+        return token;
+    }
+
+    std::string JsonStreamer::nextKey() const {
+        const Frame& frame = frames.back();
+        return frame.isArray ? std::to_string(frame.index) : frame.key;
+    }
+
+    nlohmann::json* JsonStreamer::place(nlohmann::json&& value){
+        if(frames.empty()){
+            // This is the root of the document
+            if(!buildDocument) return nullptr;
+            document = std::move(value);
+            return &document;
+        }
+        Frame& frame = frames.back();
+        switch(frame.mode){
+        case Mode::BUILD:
+        case Mode::CHILD:
+            if(frame.isArray){
+                frame.value->push_back(std::move(value));
+                return &frame.value->back();
+            }
+            return &((*frame.value)[frame.key] = std::move(value));
+        case Mode::STREAMED:
+            // A scalar child is given to the callback right away, while a container child is built in "child" till it ends
+            if(value.is_structured()){
+                child = std::move(value);
+                return &child;
+            }
+            if(frame.callback && *frame.callback) (*frame.callback)(frame.isArray ? std::string() : frame.key, value);
+            return nullptr;
+        case Mode::SKIP:
+        case Mode::DROP:
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    void JsonStreamer::finishValue(){
+        if(!frames.empty() && frames.back().isArray) ++frames.back().index;
+    }
+
+    bool JsonStreamer::startContainer(bool isArray){
+        nlohmann::json empty = isArray ? nlohmann::json::array() : nlohmann::json::object();
+        Frame frame{Mode::SKIP, nullptr, std::string(), nullptr, std::string(), 0, isArray};
+        if(frames.empty()){
+            // This is the root of the document
+            if(buildDocument){
+                frame.mode = Mode::BUILD;
+                frame.value = place(std::move(empty));
+            }
+        } else {
+            const Frame& parent = frames.back();
+            switch(parent.mode){
+            case Mode::CHILD:
+                frame.mode = Mode::CHILD;
+                frame.value = place(std::move(empty));
+                break;
+            case Mode::DROP:
+                frame.mode = Mode::DROP;
+                break;
+            case Mode::STREAMED:
+                // The container is a child of a streamed container, so it is only built if there is a callback to receive it
+                if(parent.callback && *parent.callback){
+                    frame.mode = Mode::CHILD;
+                    frame.value = place(std::move(empty));
+                } else {
+                    frame.mode = Mode::DROP;
+                }
+                break;
+            case Mode::BUILD:
+            case Mode::SKIP: {
+                // We check whether the container is one of the streamed ones
+                frame.pointer = parent.pointer + "/" + escapePointerToken(nextKey());
+                auto match = std::find_if(streamed.begin(), streamed.end(), [&](const auto& entry){ return entry.first == frame.pointer; });
+                if(match != streamed.end()){
+                    frame.mode = Mode::STREAMED;
+                    frame.callback = &match->second;
+                    place(nullptr); // The container is replaced by null in the DOM
+                } else if(parent.mode == Mode::BUILD){
+                    frame.mode = Mode::BUILD;
+                    frame.value = place(std::move(empty));
+                }
+                break;
+            }
+            }
+        }
+        frames.push_back(std::move(frame));
+        return true;
+    }
+
+    bool JsonStreamer::end_object(){
+        Frame frame = std::move(frames.back());
+        frames.pop_back();
+        // If a child of a streamed container is complete, it is given to the callback then destroyed
+        if(frame.mode == Mode::CHILD && !frames.empty() && frames.back().mode == Mode::STREAMED){
+            Frame& parent = frames.back();
+            (*parent.callback)(parent.isArray ? std::string() : parent.key, child);
+            child = nullptr;
+        }
+        finishValue();
+        return true;
+    }
+
+    bool JsonStreamer::parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception){
+        throw std::runtime_error(exception.what());
+    }
+
+    nlohmann::json parseJsonStreaming(std::istream& input, std::vector<std::pair<std::string, JsonStreamer::Callback>> streamed, bool buildDocument){
+        JsonStreamer streamer(std::move(streamed), buildDocument);
+        nlohmann::json::sax_parse(input, &streamer, nlohmann::json::input_format_t::json, true, true);
+        return std::move(streamer.getDocument());
+    }
+
+}
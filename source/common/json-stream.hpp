@@ -0,0 +1,85 @@
+#pragma once
+
+#include <json/json.hpp>
+#include <functional>
+#include <istream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace our {
+
+    // This SAX handler builds a json DOM like "nlohmann::json::parse" does, except for the containers found at the "streamed" JSON pointers
+    // (e.g. "/scene/world"). Each child of a streamed container (an array element or an object member) is built alone, passed to the
+    // container's callback then destroyed, so the DOM of the whole container never exists. In the DOM, a streamed container is replaced by null
+    // (so "contains" still finds it). If a streamed container has no callback, its children are parsed and dropped without being built.
+    // If "buildDocument" is false, only the children of the streamed containers are built and the rest of the document is dropped.
+    class JsonStreamer : public nlohmann::json_sax<nlohmann::json> {
+    public:
+        // The callback receives the key of the child (or an empty string for array elements) and the child itself (which it can move from)
+        typedef std::function<void(const std::string& key, nlohmann::json& value)> Callback;
+
+    private:
+        enum class Mode {
+            BUILD,    // The container is part of the DOM
+            SKIP,     // The container is dropped, but the pointers of its children are still checked
+            STREAMED, // The container is streamed, so each child is built alone and given to the callback
+            CHILD,    // The container is (part of) a child of a streamed container
+            DROP      // The container is (part of) a child of a streamed container that has no callback
+        };
+
+        struct Frame {
+            Mode mode;
+            nlohmann::json* value; // The container being built (in BUILD and CHILD modes)
+            std::string pointer; // The JSON pointer of the container (it is not tracked inside the children of a streamed container)
+            const Callback* callback; // The callback of a streamed container (null to drop its children)
+            std::string key; // The key of the next member (for objects)
+            size_t index = 0; // The index of the next element (for arrays)
+            bool isArray;
+        };
+
+        std::vector<std::pair<std::string, Callback>> streamed; // The streamed JSON pointers and their callbacks
+        bool buildDocument;
+        nlohmann::json document; // The DOM of the document without the streamed containers
+        nlohmann::json child; // The child of a streamed container that is being built
+        std::vector<Frame> frames; // The containers that were started and not ended yet
+
+        // Returns the key of the next value in the current container (or its index for arrays)
+        std::string nextKey() const;
+        // Adds a scalar or an empty container to the current container and returns a pointer to it (or null if nothing is built)
+        nlohmann::json* place(nlohmann::json&& value);
+        // Called when a value that belongs to the current container is complete
+        void finishValue();
+        // Starts an object or an array
+        bool startContainer(bool isArray);
+        // Adds a scalar
+        bool scalar(nlohmann::json&& value) { place(std::move(value)); finishValue(); return true; }
+
+    public:
+        JsonStreamer(std::vector<std::pair<std::string, Callback>> streamed, bool buildDocument = true)
+            : streamed(std::move(streamed)), buildDocument(buildDocument) {}
+
+        // Returns the DOM of the parsed document (without the streamed containers)
+        nlohmann::json& getDocument() { return document; }
+
+        bool null() override { return scalar(nullptr); }
+        bool boolean(bool value) override { return scalar(value); }
+        bool number_integer(number_integer_t value) override { return scalar(value); }
+        bool number_unsigned(number_unsigned_t value) override { return scalar(value); }
+        bool number_float(number_float_t value, const string_t&) override { return scalar(value); }
+        bool string(string_t& value) override { return scalar(std::move(value)); }
+        bool binary(binary_t& value) override { return scalar(nlohmann::json::binary(std::move(value))); }
+        bool start_object(std::size_t) override { return startContainer(false); }
+        bool key(string_t& value) override { frames.back().key = std::move(value); return true; }
+        bool end_object() override;
+        bool start_array(std::size_t) override { return startContainer(true); }
+        bool end_array() override { return end_object(); }
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception) override;
+    };
+
+    // Parses the json in "input" (comments are allowed) and returns its DOM without the containers at the given JSON pointers.
+    // The children of each of these containers are passed one by one to its callback while the input is parsed (see "JsonStreamer").
+    // It throws an std::runtime_error if the input is not valid json.
+    nlohmann::json parseJsonStreaming(std::istream& input, std::vector<std::pair<std::string, JsonStreamer::Callback>> streamed, bool buildDocument = true);
+
+}
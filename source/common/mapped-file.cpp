@@ -0,0 +1,82 @@
+#include "mapped-file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace our {
+
+#ifdef _WIN32
+
+    bool MappedFile::open(const std::string& path){
+        close();
+        HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(fileHandle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0){
+            CloseHandle(fileHandle);
+            return false;
+        }
+        HANDLE mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!mappingHandle){
+            CloseHandle(fileHandle);
+            return false;
+        }
+        const void* view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if(!view){
+            CloseHandle(mappingHandle);
+            CloseHandle(fileHandle);
+            return false;
+        }
+        file = fileHandle;
+        mapping = mappingHandle;
+        bytes = static_cast<const unsigned char*>(view);
+        length = (size_t)fileSize.QuadPart;
+        return true;
+    }
+
+    void MappedFile::close(){
+        if(bytes) UnmapViewOfFile(bytes);
+        if(mapping) CloseHandle(mapping);
+        if(file) CloseHandle(file);
+        bytes = nullptr;
+        mapping = file = nullptr;
+        length = 0;
+    }
+
+#else
+
+    bool MappedFile::open(const std::string& path){
+        close();
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if(descriptor < 0) return false;
+        struct stat status;
+        if(fstat(descriptor, &status) != 0 || status.st_size <= 0){
+            ::close(descriptor);
+            return false;
+        }
+        void* view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // The mapping keeps the file alive, so the descriptor is not needed anymore
+        ::close(descriptor);
+        if(view == MAP_FAILED) return false;
+        bytes = static_cast<const unsigned char*>(view);
+        length = (size_t)status.st_size;
+        return true;
+    }
+
+    void MappedFile::close(){
+        if(bytes) munmap(const_cast<unsigned char*>(bytes), length);
+        bytes = nullptr;
+        length = 0;
+    }
+
+#endif
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace our {
+
+    // This class maps a whole file into memory (read only), so the file can be read in place without copying it into a buffer first.
+    // The pages are loaded lazily by the OS and they are shared with the OS file cache.
+    class MappedFile {
+        const unsigned char* bytes = nullptr; // The start of the mapped memory (or null if no file is mapped)
+        size_t length = 0; // The size of the file in bytes
+#ifdef _WIN32
+        void* file = nullptr; // The handle of the opened file
+        void* mapping = nullptr; // The handle of the file mapping
+#endif
+
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& path) { open(path); }
+
+        // Maps the file at the given path (after unmapping the current one if any). Returns false if the file couldn't be mapped or is empty.
+        bool open(const std::string& path);
+        // Unmaps the file. Any pointer into the mapped memory becomes invalid.
+        void close();
+
+        bool isOpen() const { return bytes != nullptr; }
+        const unsigned char* data() const { return bytes; }
+        size_t size() const { return length; }
+
+        ~MappedFile() { close(); }
+
+        // A mapped file should not be copyable since it owns the mapping
+        MappedFile(const MappedFile&) = delete;
+        MappedFile &operator=(MappedFile const &) = delete;
+    };
+
+}
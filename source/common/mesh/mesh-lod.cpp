@@ -0,0 +1,301 @@
+#include "mesh-utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    // A quadric is the sum of the squared distances to a set of planes, stored as the upper half of a symmetric 4x4 matrix.
+    // The error of moving a vertex to a point is the quadric evaluated at that point, so summing the quadrics of two vertices
+    // gives the error of merging them (the planes of both are kept).
+    struct Quadric {
+        double a[10] = {};
+
+        // Adds the squared distance to the plane "dot(normal, p) + d = 0" (the normal is normalized)
+        void addPlane(const glm::dvec3& n, double d){
+            a[0] += n.x * n.x; a[1] += n.x * n.y; a[2] += n.x * n.z; a[3] += n.x * d;
+            a[4] += n.y * n.y; a[5] += n.y * n.z; a[6] += n.y * d;
+            a[7] += n.z * n.z; a[8] += n.z * d;
+            a[9] += d * d;
+        }
+        void add(const Quadric& other){
+            for(int i = 0; i < 10; ++i) a[i] += other.a[i];
+        }
+        double evaluate(const glm::dvec3& p) const {
+            double value = a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+                         + a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+                         + a[7] * p.z * p.z + 2 * a[8] * p.z
+                         + a[9];
+            return std::max(value, 0.0);
+        }
+    };
+
+    // A collapse of the vertex "from" into the vertex "to". It is out of date if one of them changed since it was pushed.
+    struct Collapse {
+        float cost;
+        std::uint32_t from, to;
+        std::uint32_t fromVersion, toVersion;
+        bool operator<(const Collapse& other) const { return cost > other.cost; } // The priority queue pops the cheapest collapse first
+    };
+
+    // The simplification works on the positions: the vertices of the OBJ are split wherever the normals or the texture coordinates change
+    // (at every corner of a flat shaded model), so the vertices that share a position are welded to find the connectivity.
+    // Each triangle still refers to the original vertices, so the LODs can share the vertex buffer of the full mesh.
+    class Simplifier {
+        const std::vector<our::Vertex>& vertices;
+        std::vector<glm::vec3> points; // The welded positions
+        std::vector<std::uint32_t> pointOf; // The welded position of each vertex
+        std::vector<std::vector<std::uint32_t>> verticesAt; // The vertices at each welded position
+        std::vector<std::vector<std::uint32_t>> trianglesAt; // The triangles around each welded position (it can hold removed ones)
+        std::vector<std::array<std::uint32_t, 3>> triangles; // The vertices of each triangle
+        std::vector<glm::vec3> originalNormals; // The normal of each triangle in the full mesh (see "isValid")
+        std::vector<bool> triangleRemoved, pointRemoved;
+        std::vector<Quadric> quadrics;
+        std::vector<std::uint32_t> versions;
+        std::priority_queue<Collapse> queue;
+        size_t aliveTriangles = 0;
+        float maxError = 0.0f;
+        float attributeScale = 0.0f; // The distance that counts as much as a unit of difference in the attributes (see "push")
+
+        std::uint32_t point(std::uint32_t triangle, int corner) const { return pointOf[triangles[triangle][corner]]; }
+
+        bool contains(std::uint32_t triangle, std::uint32_t p) const {
+            return point(triangle, 0) == p || point(triangle, 1) == p || point(triangle, 2) == p;
+        }
+
+        // The cost of a collapse is the squared error of the surface plus the squared error of the attributes: a vertex that moves to a vertex
+        // with other texture coordinates, normals or colors (e.g. across a seam of the texture) shows on the screen even on a flat surface.
+        // The attributes are compared with a distance that grows with the size of the mesh, so they only change where the mesh looks small.
+        void push(std::uint32_t from, std::uint32_t to){
+            Quadric sum = quadrics[from];
+            sum.add(quadrics[to]);
+            float attributeError = 0.0f;
+            for(std::uint32_t vertex : verticesAt[from])
+                attributeError = std::max(attributeError, attributeDifference(vertex, vertices[closestVertexAt(to, vertex)]));
+            attributeError *= attributeScale;
+            float cost = (float)sum.evaluate(glm::dvec3(points[to])) + attributeError * attributeError;
+            queue.push(Collapse{cost, from, to, versions[from], versions[to]});
+        }
+
+        // Pushes the collapses of every edge around the given position in both directions
+        void pushEdges(std::uint32_t p){
+            for(std::uint32_t triangle : trianglesAt[p]){
+                if(triangleRemoved[triangle]) continue;
+                for(int corner = 0; corner < 3; ++corner){
+                    std::uint32_t other = point(triangle, corner);
+                    if(other == p) continue;
+                    push(p, other);
+                    push(other, p);
+                }
+            }
+        }
+
+        // A collapse is refused if it folds a triangle over: its normal turns by more than 90 degrees, or by more than about 75 degrees
+        // from its normal in the full mesh (a triangle that turns a bit at every collapse would otherwise end up edge-on or folded)
+        // or if it pinches the surface (the two positions share more neighbors than the triangles on their edge, so merging them would
+        // glue two sheets of the surface together)
+        bool isValid(std::uint32_t from, std::uint32_t to){
+            std::vector<std::uint32_t> fromNeighbors, toNeighbors;
+            int edgeTriangles = 0;
+            for(std::uint32_t triangle : trianglesAt[from]){
+                if(triangleRemoved[triangle]) continue;
+                if(contains(triangle, to)) { ++edgeTriangles; continue; }
+                glm::vec3 corners[3], moved[3];
+                for(int corner = 0; corner < 3; ++corner){
+                    std::uint32_t p = point(triangle, corner);
+                    corners[corner] = points[p];
+                    moved[corner] = p == from ? points[to] : points[p];
+                    if(p != from) fromNeighbors.push_back(p);
+                }
+                glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if(glm::dot(before, after) <= 0.0f || glm::dot(originalNormals[triangle], after) <= 0.25f * glm::length(after)) return false;
+            }
+            for(std::uint32_t triangle : trianglesAt[to]){
+                if(triangleRemoved[triangle]) continue;
+                for(int corner = 0; corner < 3; ++corner){
+                    std::uint32_t p = point(triangle, corner);
+                    if(p != to && p != from) toNeighbors.push_back(p);
+                }
+            }
+            std::sort(fromNeighbors.begin(), fromNeighbors.end());
+            fromNeighbors.erase(std::unique(fromNeighbors.begin(), fromNeighbors.end()), fromNeighbors.end());
+            std::sort(toNeighbors.begin(), toNeighbors.end());
+            toNeighbors.erase(std::unique(toNeighbors.begin(), toNeighbors.end()), toNeighbors.end());
+            std::vector<std::uint32_t> shared;
+            std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(), toNeighbors.end(), std::back_inserter(shared));
+            return edgeTriangles > 0 && (int)shared.size() <= edgeTriangles;
+        }
+
+        // Returns how different the normal, the texture coordinates and the color of a vertex are from another vertex
+        float attributeDifference(std::uint32_t vertex, const our::Vertex& target) const {
+            const our::Vertex& source = vertices[vertex];
+            glm::vec3 normal = target.normal - source.normal;
+            glm::vec2 texCoord = target.tex_coord - source.tex_coord;
+            glm::vec4 color = (glm::vec4(target.color) - glm::vec4(source.color)) / 255.0f;
+            return std::sqrt(glm::dot(normal, normal) + glm::dot(texCoord, texCoord) + glm::dot(color, color));
+        }
+
+        // Returns the vertex at "p" whose normal, texture coordinates and color are the closest to the given vertex
+        std::uint32_t closestVertexAt(std::uint32_t p, std::uint32_t vertex) const {
+            std::uint32_t best = verticesAt[p][0];
+            float bestDifference = std::numeric_limits<float>::max();
+            for(std::uint32_t candidate : verticesAt[p]){
+                float difference = attributeDifference(vertex, vertices[candidate]);
+                if(difference < bestDifference){
+                    bestDifference = difference;
+                    best = candidate;
+                }
+            }
+            return best;
+        }
+
+        void collapse(const Collapse& edge){
+            std::uint32_t from = edge.from, to = edge.to;
+            for(std::uint32_t triangle : trianglesAt[from]){
+                if(triangleRemoved[triangle]) continue;
+                if(contains(triangle, to)){
+                    // The triangles on the edge become degenerate
+                    triangleRemoved[triangle] = true;
+                    --aliveTriangles;
+                    continue;
+                }
+                for(auto& vertex : triangles[triangle])
+                    if(pointOf[vertex] == from) vertex = closestVertexAt(to, vertex);
+                trianglesAt[to].push_back(triangle);
+            }
+            // The list of the kept position is cleaned, so it doesn't keep growing with removed and repeated triangles
+            auto& list = trianglesAt[to];
+            list.erase(std::remove_if(list.begin(), list.end(), [this](std::uint32_t triangle){ return triangleRemoved[triangle]; }), list.end());
+            std::sort(list.begin(), list.end());
+            list.erase(std::unique(list.begin(), list.end()), list.end());
+            trianglesAt[from].clear();
+
+            quadrics[to].add(quadrics[from]);
+            pointRemoved[from] = true;
+            ++versions[from];
+            ++versions[to];
+            maxError = std::max(maxError, edge.cost);
+            pushEdges(to);
+        }
+
+    public:
+        Simplifier(const std::vector<our::Vertex>& vertices, const std::vector<unsigned int>& elements) : vertices(vertices) {
+            std::unordered_map<glm::vec3, std::uint32_t> pointIndices;
+            pointOf.resize(vertices.size());
+            for(size_t vertex = 0; vertex < vertices.size(); ++vertex){
+                auto result = pointIndices.emplace(vertices[vertex].position, (std::uint32_t)points.size());
+                if(result.second){
+                    points.push_back(vertices[vertex].position);
+                    verticesAt.emplace_back();
+                }
+                pointOf[vertex] = result.first->second;
+                verticesAt[pointOf[vertex]].push_back((std::uint32_t)vertex);
+            }
+            trianglesAt.resize(points.size());
+            our::AABB bounds;
+            for(const auto& point : points) bounds.expand(point);
+            if(!bounds.isEmpty()) attributeScale = 0.01f * glm::length(bounds.max - bounds.min);
+            quadrics.resize(points.size());
+            versions.resize(points.size(), 0);
+            pointRemoved.resize(points.size(), false);
+
+            // Each position gets the planes of its triangles. The triangles that are degenerate from the start are dropped.
+            std::unordered_map<std::uint64_t, std::uint32_t> edgeCounts;
+            auto edgeKey = [](std::uint32_t a, std::uint32_t b){ return (std::uint64_t(std::min(a, b)) << 32) | std::max(a, b); };
+            for(size_t index = 0; index + 2 < elements.size(); index += 3){
+                std::array<std::uint32_t, 3> triangle = {elements[index], elements[index + 1], elements[index + 2]};
+                std::uint32_t a = pointOf[triangle[0]], b = pointOf[triangle[1]], c = pointOf[triangle[2]];
+                if(a == b || b == c || c == a) continue;
+                glm::dvec3 normal = glm::cross(glm::dvec3(points[b] - points[a]), glm::dvec3(points[c] - points[a]));
+                double length = glm::length(normal);
+                if(length <= 0.0) continue;
+                normal /= length;
+                double d = -glm::dot(normal, glm::dvec3(points[a]));
+                for(std::uint32_t p : {a, b, c}){
+                    quadrics[p].addPlane(normal, d);
+                    trianglesAt[p].push_back((std::uint32_t)triangles.size());
+                }
+                edgeCounts[edgeKey(a, b)]++;
+                edgeCounts[edgeKey(b, c)]++;
+                edgeCounts[edgeKey(c, a)]++;
+                triangles.push_back(triangle);
+                originalNormals.push_back(glm::vec3(normal));
+            }
+            triangleRemoved.resize(triangles.size(), false);
+            aliveTriangles = triangles.size();
+
+            // The open borders get a plane that is perpendicular to their triangle, so they keep their outline while the surface is simplified
+            for(size_t triangle = 0; triangle < triangles.size(); ++triangle){
+                for(int corner = 0; corner < 3; ++corner){
+                    std::uint32_t a = point((std::uint32_t)triangle, corner), b = point((std::uint32_t)triangle, (corner + 1) % 3);
+                    if(edgeCounts[edgeKey(a, b)] != 1) continue;
+                    std::uint32_t c = point((std::uint32_t)triangle, (corner + 2) % 3);
+                    glm::dvec3 edge = glm::dvec3(points[b] - points[a]);
+                    glm::dvec3 face = glm::cross(edge, glm::dvec3(points[c] - points[a]));
+                    glm::dvec3 normal = glm::cross(edge, face);
+                    double length = glm::length(normal);
+                    if(length <= 0.0) continue;
+                    normal /= length;
+                    double d = -glm::dot(normal, glm::dvec3(points[a]));
+                    quadrics[a].addPlane(normal, d);
+                    quadrics[b].addPlane(normal, d);
+                }
+            }
+
+            for(std::uint32_t p = 0; p < points.size(); ++p) pushEdges(p);
+        }
+
+        size_t getTriangleCount() const { return aliveTriangles; }
+        // The largest error of the collapses done so far as a distance in the local space of the mesh
+        float getError() const { return std::sqrt(maxError); }
+
+        // Collapses the cheapest edges till at most "target" triangles are left (or no valid collapse is left)
+        void simplify(size_t target){
+            while(aliveTriangles > target && !queue.empty()){
+                Collapse edge = queue.top();
+                queue.pop();
+                if(pointRemoved[edge.from] || pointRemoved[edge.to]) continue;
+                if(edge.fromVersion != versions[edge.from] || edge.toVersion != versions[edge.to]) continue;
+                if(!isValid(edge.from, edge.to)) continue;
+                collapse(edge);
+            }
+        }
+
+        // Returns the vertex indices of the triangles that are left
+        std::vector<unsigned int> getElements() const {
+            std::vector<unsigned int> elements;
+            elements.reserve(aliveTriangles * 3);
+            for(size_t triangle = 0; triangle < triangles.size(); ++triangle)
+                if(!triangleRemoved[triangle])
+                    elements.insert(elements.end(), triangles[triangle].begin(), triangles[triangle].end());
+            return elements;
+        }
+    };
+
+}
+
+// Every level keeps "reduction" of the triangles of the previous one. The chain stops early when a level can't be simplified much
+// more without breaking the surface (less than 10% fewer triangles) or when it becomes too small to be worth another level.
+std::vector<our::MeshLOD> our::mesh_utils::generateLODs(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements,
+    int maxLevels, float reduction) {
+    std::vector<MeshLOD> lods;
+    const size_t minTriangles = 16;
+    Simplifier simplifier(vertices, elements);
+    size_t previous = simplifier.getTriangleCount();
+    for(int level = 0; level < maxLevels && previous > minTriangles; ++level){
+        simplifier.simplify((size_t)(previous * reduction));
+        size_t count = simplifier.getTriangleCount();
+        if(count == 0 || count > previous * 0.9f) break;
+        lods.push_back(MeshLOD{simplifier.getElements(), simplifier.getError()});
+        previous = count;
+    }
+    return lods;
+}
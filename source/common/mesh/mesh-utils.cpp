@@ -8,7 +8,7 @@
 #include <vector>
 #include <unordered_map>
 
-our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
+our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename, bool withLODs) {
 
     // The data that we will use to initialize our mesh
     std::vector<our::Vertex> vertices;
@@ -81,6 +81,8 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
         }
     }
 
+    // The simplified levels are generated while we still have the vertices on the RAM
+    if (withLODs) return new our::Mesh(vertices, elements, generateLODs(vertices, elements));
     return new our::Mesh(vertices, elements);
 }
 
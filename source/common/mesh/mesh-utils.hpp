@@ -5,7 +5,13 @@
 
 namespace our::mesh_utils {
     // Load an ".obj" file into the mesh
-    Mesh* loadOBJ(const std::string& filename);
+    // If "withLODs" is true, the simplified levels of detail of the mesh are generated too (see "generateLODs")
+    Mesh* loadOBJ(const std::string& filename, bool withLODs = false);
+    // Generates a chain of simplified versions of a mesh by quadric error edge collapses (Garland & Heckbert):
+    // every vertex sums the planes of its triangles, so the squared distance of a point to these planes measures how far the surface moves
+    // if the vertex goes there. The cheapest edges are collapsed first (one end moves to the other) till each level has "reduction"
+    // of the triangles of the previous one. At most "maxLevels" levels are returned, from the most to the least detailed.
+    std::vector<MeshLOD> generateLODs(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements, int maxLevels = 4, float reduction = 0.5f);
     // Create a sphere (the vertex order in the triangles are CCW from the outside)
     // Segments define the number of divisions on the both the latitude and the longitude
     Mesh* sphere(const glm::ivec2& segments);
@@ -2,6 +2,12 @@
 
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "../spatial/aabb.hpp"
+#include "../spatial/bounding-sphere.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace our {
 
@@ -10,6 +16,13 @@ namespace our {
     #define ATTRIB_LOC_TEXCOORD 2
     #define ATTRIB_LOC_NORMAL   3
 
+    // A simplified version of a mesh (a level of detail) made by "mesh_utils::generateLODs".
+    // It only removes triangles and reuses the vertices of the full mesh, so it only needs its own element list.
+    struct MeshLOD {
+        std::vector<unsigned int> elements;
+        float error; // The farthest that the simplified surface can be from the full one (in the local space of the mesh)
+    };
+
     class Mesh {
         // Here, we store the object names of the 3 main components of a mesh:
         // A vertex array object, A vertex buffer and an element buffer
@@ -17,16 +30,32 @@ namespace our {
         unsigned int VAO;
         // We need to remember the number of elements that will be draw by glDrawElements 
         GLsizei elementCount;
+        // The levels of detail share the vertex buffer and their elements follow each other in the element buffer.
+        // The level 0 is the full mesh and each next level has fewer triangles.
+        struct LODRange {
+            GLsizei first, count; // The range of the level's elements in the element buffer
+            float error; // See "MeshLOD::error"
+        };
+        std::vector<LODRange> lods;
+        // The box around the vertices in the local space of the mesh (it is used for culling and spatial queries)
+        AABB bounds;
+        // The sphere around the vertices in the local space of the mesh (it is used by the frustum culling of the renderer)
+        BoundingSphere sphere;
+        // A copy of the vertex positions and of the triangles' indices on the RAM.
+        // Only the positions are kept since the CPU side work (like the occlusion culling of the renderer) only needs the shape of the mesh.
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> triangles;
     public:
 
         // The constructor takes two vectors:
         // - vertices which contain the vertex data.
         // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
-        // The mesh class does not keep a these data on the RAM. Instead, it should create
+        // The mesh class does not keep a these data on the RAM (except for the positions and the triangles, see "getPositions"). Instead, it should create
         // a vertex buffer to store the vertex data on the VRAM,
         // an element buffer to store the element data on the VRAM,
         // a vertex array object to define how to read the vertex & element buffer during rendering 
-        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements)
+        // The simplified levels of detail (if any) are given in "simplified" from the most to the least detailed (see "mesh_utils::generateLODs")
+        Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& elements, const std::vector<MeshLOD>& simplified = {})
         {
             //DONE: (Req 2) Write this function
             // remember to store the number of elements in "elementCount" since you will need it for drawing
@@ -36,7 +65,14 @@ namespace our {
 
             glGenBuffers(1, &EBO);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * elements.size(), elements.data(), GL_STATIC_DRAW);
+            // All the levels are uploaded in one buffer, starting with the full mesh
+            lods.push_back(LODRange{0, (GLsizei)elements.size(), 0.0f});
+            std::vector<unsigned int> allElements = elements;
+            for(const auto& lod : simplified){
+                lods.push_back(LODRange{(GLsizei)allElements.size(), (GLsizei)lod.elements.size(), lod.error});
+                allElements.insert(allElements.end(), lod.elements.begin(), lod.elements.end());
+            }
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * allElements.size(), allElements.data(), GL_STATIC_DRAW);
 
             glGenBuffers(1, &VBO);
             glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -53,14 +89,55 @@ namespace our {
 
             glBindVertexArray(0);
             elementCount = (GLsizei)elements.size();
+
+            // The vertex data doesn't stay on the RAM, so the bounds are computed while we still have it
+            positions.reserve(vertices.size());
+            for(const auto& vertex : vertices){
+                bounds.expand(vertex.position);
+                positions.push_back(vertex.position);
+            }
+            triangles = elements;
+            // The sphere is centered on the box, and its radius reaches the farthest vertex (which is usually tighter than the box's corners)
+            if(!bounds.isEmpty()){
+                float radiusSquared = 0.0f;
+                sphere.center = bounds.getCenter();
+                for(const auto& vertex : vertices){
+                    glm::vec3 offset = vertex.position - sphere.center;
+                    radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+                }
+                sphere.radius = std::sqrt(radiusSquared);
+            }
+        }
+
+        // Returns the box around the vertices of the mesh in its local space
+        const AABB& getBounds() const { return bounds; }
+        // Returns the sphere around the vertices of the mesh in its local space
+        const BoundingSphere& getBoundingSphere() const { return sphere; }
+        // Returns the positions of the vertices in the local space of the mesh
+        const std::vector<glm::vec3>& getPositions() const { return positions; }
+        // Returns the indices of the triangles' vertices (3 per triangle) in the positions
+        const std::vector<unsigned int>& getTriangles() const { return triangles; }
+
+        // Returns the number of levels of detail (1 if the mesh has no simplified levels)
+        size_t getLODCount() const { return lods.size(); }
+        // Returns the number of elements drawn by the given level of detail
+        GLsizei getLODElementCount(size_t lod) const { return lods[lod].count; }
+        // Returns the least detailed level whose error covers at most "maxError" units of the local space.
+        // The errors grow with the levels, so we stop at the first level that is too coarse.
+        size_t selectLOD(float maxError) const {
+            size_t lod = 0;
+            while(lod + 1 < lods.size() && lods[lod + 1].error <= maxError) ++lod;
+            return lod;
         }
 
         // this function should render the mesh
-        void draw() 
+        // "lod" picks the level of detail to draw (0 is the full mesh)
+        void draw(size_t lod = 0) 
         {
             //DONE: (Req 2) Write this function
+            const LODRange& range = lods[std::min(lod, lods.size() - 1)];
             glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
+            glDrawElements(GL_TRIANGLES, range.count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * range.first));
             glBindVertexArray(0);
         }
 
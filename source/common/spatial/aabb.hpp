@@ -0,0 +1,81 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace our {
+
+    // An axis aligned bounding box defined by its minimum and maximum corners.
+    // A default constructed box is empty (its minimum is greater than its maximum), so expanding it by a point gives a box around that point.
+    struct AABB {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+        AABB() = default;
+        AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+        // Returns true if the box doesn't contain any point
+        bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+        // Grows the box to contain the given point
+        void expand(const glm::vec3& point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+        // Grows the box to contain the given box
+        void expand(const AABB& other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+        glm::vec3 getExtents() const { return (max - min) * 0.5f; } // Half the size along each axis
+
+        // Returns the surface area of the box (the cost of a node in the surface area heuristic is proportional to it)
+        float getSurfaceArea() const {
+            if(isEmpty()) return 0.0f;
+            glm::vec3 size = max - min;
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        // Returns true if the two boxes share at least one point
+        bool overlaps(const AABB& other) const {
+            return min.x <= other.max.x && max.x >= other.min.x &&
+                   min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+
+        bool contains(const glm::vec3& point) const {
+            return glm::all(glm::greaterThanEqual(point, min)) && glm::all(glm::lessThanEqual(point, max));
+        }
+
+        // Returns the box around this box after it is transformed by the given (affine) matrix.
+        // Instead of transforming the 8 corners, the extents are transformed by the absolute values of the matrix.
+        AABB transformed(const glm::mat4& matrix) const {
+            if(isEmpty()) return AABB();
+            glm::vec3 center = matrix * glm::vec4(getCenter(), 1.0f);
+            glm::vec3 extents = getExtents();
+            glm::vec3 newExtents =
+                glm::abs(glm::vec3(matrix[0])) * extents.x +
+                glm::abs(glm::vec3(matrix[1])) * extents.y +
+                glm::abs(glm::vec3(matrix[2])) * extents.z;
+            return AABB(center - newExtents, center + newExtents);
+        }
+
+        // Intersects the box with a ray ("inverseDirection" is 1 / direction for each axis) using the slab method.
+        // If the ray enters the box before "maxDistance", it returns true and the distance at which it enters the box (0 if the origin is inside).
+        bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& distance) const {
+            glm::vec3 t0 = (min - origin) * inverseDirection;
+            glm::vec3 t1 = (max - origin) * inverseDirection;
+            glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+            float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+            if(enter > exit) return false;
+            distance = enter;
+            return true;
+        }
+    };
+
+}
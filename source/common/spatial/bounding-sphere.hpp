@@ -0,0 +1,26 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+namespace our {
+
+    // A sphere around an object. It is looser than a box for most objects but it is cheaper to test against a plane
+    // (a single dot product) and it doesn't change its shape when it is rotated.
+    struct BoundingSphere {
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+
+        BoundingSphere() = default;
+        BoundingSphere(const glm::vec3& center, float radius) : center(center), radius(radius) {}
+
+        // Returns the sphere around this sphere after it is transformed by the given (affine) matrix.
+        // A non-uniform scale stretches the sphere into an ellipsoid, so the radius is scaled by the largest scale of the matrix.
+        BoundingSphere transformed(const glm::mat4& matrix) const {
+            float scale = std::max(std::max(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1]))), glm::length(glm::vec3(matrix[2])));
+            return BoundingSphere(glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale);
+        }
+    };
+
+}
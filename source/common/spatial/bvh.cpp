@@ -0,0 +1,177 @@
+#include "bvh.hpp"
+#include "../ecs/entity.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    void BVH::Tree::build(){
+        nodes.clear();
+        if(leaves.empty()) { builtCost = 0.0f; return; }
+        // A binary tree with N leaves has less than 2N nodes, so reserving them keeps the node references valid while subdividing
+        nodes.reserve(2 * leaves.size());
+        nodes.push_back(Node{AABB(), -1, 0, 0});
+        subdivide(0, 0, (std::uint32_t)leaves.size());
+        builtCost = computeCost();
+    }
+
+    // The node is split where the surface area heuristic is the lowest: the cost of a split is the number of leaves on each side
+    // weighted by the area of the side's box, since the chance that a query hits a box grows with its area.
+    // The centers are sorted into bins along each axis, so only the boundaries between the bins are evaluated.
+    void BVH::Tree::subdivide(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count){
+        AABB bounds, centers;
+        for(std::uint32_t index = first; index < first + count; ++index){
+            bounds.expand(leaves[index].bounds);
+            centers.expand(leaves[index].bounds.getCenter());
+        }
+        nodes[nodeIndex].bounds = bounds;
+        if(count <= MAX_LEAF_SIZE){
+            nodes[nodeIndex].first = first;
+            nodes[nodeIndex].count = count;
+            return;
+        }
+
+        struct Bin { AABB bounds; std::uint32_t count = 0; };
+        float bestCost = std::numeric_limits<float>::max();
+        int bestAxis = -1;
+        std::uint32_t bestSplit = 0; // The bins before this one go to the left child
+        for(int axis = 0; axis < 3; ++axis){
+            float low = centers.min[axis], high = centers.max[axis];
+            if(high <= low) continue;
+            Bin bins[BIN_COUNT];
+            float scale = BIN_COUNT / (high - low);
+            for(std::uint32_t index = first; index < first + count; ++index){
+                std::uint32_t bin = std::min(BIN_COUNT - 1, (std::uint32_t)((leaves[index].bounds.getCenter()[axis] - low) * scale));
+                bins[bin].count++;
+                bins[bin].bounds.expand(leaves[index].bounds);
+            }
+            // We sweep from the right to get the cost of the right side of every split, then from the left to combine it with the left side
+            float rightCost[BIN_COUNT];
+            AABB rightBounds;
+            std::uint32_t rightCount = 0;
+            for(std::uint32_t bin = BIN_COUNT - 1; bin > 0; --bin){
+                rightBounds.expand(bins[bin].bounds);
+                rightCount += bins[bin].count;
+                rightCost[bin] = rightCount * rightBounds.getSurfaceArea();
+            }
+            AABB leftBounds;
+            std::uint32_t leftCount = 0;
+            for(std::uint32_t split = 1; split < BIN_COUNT; ++split){
+                leftBounds.expand(bins[split - 1].bounds);
+                leftCount += bins[split - 1].count;
+                if(leftCount == 0 || leftCount == count) continue;
+                float cost = leftCount * leftBounds.getSurfaceArea() + rightCost[split];
+                if(cost < bestCost){
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+
+        std::uint32_t middle;
+        if(bestAxis >= 0){
+            float low = centers.min[bestAxis];
+            float scale = BIN_COUNT / (centers.max[bestAxis] - low);
+            auto split = std::partition(leaves.begin() + first, leaves.begin() + first + count, [&](const Leaf& leaf){
+                return std::min(BIN_COUNT - 1, (std::uint32_t)((leaf.bounds.getCenter()[bestAxis] - low) * scale)) < bestSplit;
+            });
+            middle = (std::uint32_t)(split - leaves.begin());
+        } else {
+            // All the centers are at the same point, so any split is as good as the others and we cut the list in half
+            middle = first + count / 2;
+        }
+
+        std::uint32_t left = (std::uint32_t)nodes.size();
+        nodes.push_back(Node{AABB(), (std::int32_t)nodeIndex, 0, 0});
+        nodes.push_back(Node{AABB(), (std::int32_t)nodeIndex, 0, 0});
+        nodes[nodeIndex].first = left;
+        nodes[nodeIndex].count = 0;
+        subdivide(left, first, middle - first);
+        subdivide(left + 1, middle, first + count - middle);
+    }
+
+    bool BVH::Tree::refit(){
+        bool moved = false;
+        for(auto& leaf : leaves){
+            std::uint32_t version = leaf.entity->getLocalToWorldVersion();
+            if(version == leaf.version) continue;
+            leaf.version = version;
+            leaf.entity->getWorldBounds(leaf.bounds);
+            moved = true;
+        }
+        if(!moved) return false;
+        // The children come after their parents, so walking the nodes backwards refits the children before their parents
+        for(size_t index = nodes.size(); index-- > 0;){
+            Node& node = nodes[index];
+            AABB bounds;
+            if(node.count > 0){
+                for(std::uint32_t leaf = node.first; leaf < node.first + node.count; ++leaf)
+                    bounds.expand(leaves[leaf].bounds);
+            } else {
+                bounds = nodes[node.first].bounds;
+                bounds.expand(nodes[node.first + 1].bounds);
+            }
+            node.bounds = bounds;
+        }
+        return true;
+    }
+
+    float BVH::Tree::computeCost() const {
+        if(nodes.empty()) return 0.0f;
+        float rootArea = nodes[0].bounds.getSurfaceArea();
+        if(rootArea <= 0.0f) return 0.0f;
+        float cost = 0.0f;
+        for(const auto& node : nodes)
+            cost += node.bounds.getSurfaceArea() * (node.count > 0 ? node.count : 1);
+        return cost / rootArea;
+    }
+
+    void BVH::rebuild(const std::vector<Entity*>& entities){
+        staticTree.leaves.clear();
+        dynamicTree.leaves.clear();
+        std::unordered_set<EntityHandle> stillMoved;
+        for(Entity* entity : entities){
+            Leaf leaf;
+            if(!entity->getWorldBounds(leaf.bounds)) continue;
+            leaf.entity = entity;
+            leaf.version = entity->getLocalToWorldVersion();
+            if(movedEntities.count(entity->getHandle())){
+                stillMoved.insert(entity->getHandle());
+                dynamicTree.leaves.push_back(leaf);
+            } else {
+                staticTree.leaves.push_back(leaf);
+            }
+        }
+        // The deleted entities are forgotten
+        movedEntities.swap(stillMoved);
+        staticTree.build();
+        dynamicTree.build();
+    }
+
+    void BVH::update(const std::vector<Entity*>& entities, std::uint64_t structureVersion){
+        if(structureVersion != this->structureVersion){
+            this->structureVersion = structureVersion;
+            rebuild(entities);
+            return;
+        }
+        // An entity of the static tree that moves is moved to the dynamic tree (which needs a rebuild of both trees).
+        // This only happens once per entity, usually in the first frames of a level.
+        bool staticMoved = false;
+        for(const auto& leaf : staticTree.leaves){
+            if(leaf.entity->getLocalToWorldVersion() != leaf.version){
+                movedEntities.insert(leaf.entity->getHandle());
+                staticMoved = true;
+            }
+        }
+        if(staticMoved){
+            rebuild(entities);
+            return;
+        }
+        // The refit keeps the structure of the tree, so the boxes get bigger as the entities drift apart.
+        // Once the tree is twice as costly to query as a new one, we rebuild it.
+        if(dynamicTree.refit() && dynamicTree.computeCost() > 2.0f * dynamicTree.builtCost)
+            dynamicTree.build();
+    }
+
+}
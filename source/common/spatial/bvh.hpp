@@ -0,0 +1,162 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "frustum.hpp"
+#include "../ecs/entity-handle.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+namespace our {
+
+    class Entity; // A forward declaration of the Entity Class
+
+    // A bounding volume hierarchy over the world space bounds of the entities (see "Entity::getLocalBounds").
+    // It is a binary tree of boxes where every node's box contains the boxes of its children, so a query skips a whole subtree
+    // as soon as the query shape misses the subtree's box. The trees are built top-down using the surface area heuristic (SAH).
+    // The entities are split in two trees:
+    //  - The static tree holds the entities that never moved. It is only rebuilt when entities are added or deleted
+    //    (or when one of its entities moves for the first time, which moves the entity to the dynamic tree).
+    //  - The dynamic tree holds the entities that moved at least once. It is refit every update (the boxes are recomputed bottom-up
+    //    without changing the tree) and only rebuilt when the refit boxes became much worse than the ones of a fresh build.
+    // The world owns one and updates it with its transforms (see "World::updateTransforms" and "World::getBVH").
+    class BVH {
+        struct Leaf {
+            Entity* entity;
+            AABB bounds; // The world space bounds of the entity
+            std::uint32_t version; // The version of the entity's world matrix when the bounds were computed
+        };
+
+        struct Node {
+            AABB bounds;
+            std::int32_t parent; // The index of the parent node (or -1 for the root)
+            std::uint32_t first; // For a leaf node, the index of its first leaf. Otherwise, the index of its left child (the right one follows it).
+            std::uint32_t count; // The number of leaves in a leaf node (or 0 for an inner node)
+        };
+
+        // A tree over its own list of leaves. The build reorders the leaves so that each leaf node refers to a contiguous range.
+        struct Tree {
+            std::vector<Leaf> leaves;
+            std::vector<Node> nodes; // The root is the first node and the children of a node always come after it
+            float builtCost = 0.0f; // The SAH cost of the tree right after it was built
+
+            void build();
+            // Recomputes the bounds of the leaves whose entity moved and then the bounds of the nodes.
+            // It returns true if any entity of the tree moved.
+            bool refit();
+            // Returns the SAH cost of the tree (the surface area of the inner nodes relative to the root, plus the leaves' cost)
+            float computeCost() const;
+        private:
+            void subdivide(std::uint32_t nodeIndex, std::uint32_t first, std::uint32_t count);
+        };
+
+        Tree staticTree, dynamicTree;
+        std::unordered_set<EntityHandle> movedEntities; // The entities that moved at least once (they go to the dynamic tree when the trees are rebuilt)
+        std::uint64_t structureVersion = ~std::uint64_t(0); // The version of the world's entities and components when the trees were built
+
+        // Calls "visitLeaf(leaf)" for every leaf whose node boxes all pass "testNode(box)".
+        // The stack of nodes to visit never holds more than one node per level (plus one), so it fits in a small array for the usual trees.
+        // The SAH doesn't bound the depth though (e.g. entities in a row can be split one at a time), so the stack moves to the heap
+        // and keeps growing if a tree is deeper than that. A subtree is never skipped.
+        template<typename NodeTest, typename LeafVisit>
+        static void traverse(const Tree& tree, NodeTest testNode, LeafVisit visitLeaf) {
+            if(tree.nodes.empty()) return;
+            std::uint32_t fixedStack[64];
+            std::vector<std::uint32_t> grownStack;
+            std::uint32_t* stack = fixedStack;
+            size_t capacity = 64, top = 0;
+            stack[top++] = 0;
+            while(top > 0){
+                const Node& node = tree.nodes[stack[--top]];
+                if(!testNode(node.bounds)) continue;
+                if(node.count > 0){
+                    for(std::uint32_t index = node.first; index < node.first + node.count; ++index)
+                        visitLeaf(tree.leaves[index]);
+                } else {
+                    if(top + 2 > capacity){
+                        if(grownStack.empty()) grownStack.assign(fixedStack, fixedStack + top);
+                        grownStack.resize(capacity * 2);
+                        stack = grownStack.data();
+                        capacity = grownStack.size();
+                    }
+                    stack[top++] = node.first + 1;
+                    stack[top++] = node.first;
+                }
+            }
+        }
+
+        // Puts every entity that has bounds in one of the trees and builds them
+        void rebuild(const std::vector<Entity*>& entities);
+
+    public:
+        // The maximum number of entities in a leaf node
+        static constexpr std::uint32_t MAX_LEAF_SIZE = 2;
+        // The number of bins in which the centers are sorted when the best split of a node is searched for
+        static constexpr std::uint32_t BIN_COUNT = 12;
+
+        // Brings the trees up to date with the given entities, whose world matrices must be up to date.
+        // "structureVersion" must change whenever entities or components are added or removed, in which case the trees are rebuilt.
+        void update(const std::vector<Entity*>& entities, std::uint64_t structureVersion);
+
+        // Forgets all the entities (the next update rebuilds the trees)
+        void clear() {
+            staticTree.leaves.clear(); staticTree.nodes.clear();
+            dynamicTree.leaves.clear(); dynamicTree.nodes.clear();
+            structureVersion = ~std::uint64_t(0);
+        }
+
+        // Returns the number of entities in the trees
+        size_t size() const { return staticTree.leaves.size() + dynamicTree.leaves.size(); }
+        // Returns the number of entities in the dynamic tree
+        size_t getDynamicCount() const { return dynamicTree.leaves.size(); }
+
+        // Calls "function(entity)" for every entity whose bounds intersect the frustum
+        template<typename Function>
+        void queryFrustum(const Frustum& frustum, Function function) const {
+            auto test = [&frustum](const AABB& box){ return frustum.intersects(box); };
+            auto visit = [&](const Leaf& leaf){ if(frustum.intersects(leaf.bounds)) function(leaf.entity); };
+            traverse(staticTree, test, visit);
+            traverse(dynamicTree, test, visit);
+        }
+
+        // Calls "function(entity)" for every entity in the leaf nodes that intersect the frustum, without testing the entity's own bounds.
+        // It is meant for callers that test the entities themselves in batches (see "ForwardRenderer::render").
+        template<typename Function>
+        void queryFrustumNodes(const Frustum& frustum, Function function) const {
+            auto test = [&frustum](const AABB& box){ return frustum.intersects(box); };
+            auto visit = [&](const Leaf& leaf){ function(leaf.entity); };
+            traverse(staticTree, test, visit);
+            traverse(dynamicTree, test, visit);
+        }
+
+        // Calls "function(entity)" for every entity whose bounds overlap the box
+        template<typename Function>
+        void queryOverlap(const AABB& box, Function function) const {
+            auto test = [&box](const AABB& other){ return box.overlaps(other); };
+            auto visit = [&](const Leaf& leaf){ if(box.overlaps(leaf.bounds)) function(leaf.entity); };
+            traverse(staticTree, test, visit);
+            traverse(dynamicTree, test, visit);
+        }
+
+        // Calls "function(entity, distance)" for every entity whose bounds are entered by the ray before "maxDistance"
+        // ("distance" is where the ray enters the bounds in units of "direction").
+        // The function returns the new maximum distance, so a search for the closest hit can return the distance of its best hit so far
+        // to skip everything behind it (or return "maxDistance" to visit every entity along the ray).
+        template<typename Function>
+        void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Function function) const {
+            glm::vec3 inverseDirection = 1.0f / direction;
+            float distance;
+            auto test = [&](const AABB& box){ return box.intersectRay(origin, inverseDirection, maxDistance, distance); };
+            auto visit = [&](const Leaf& leaf){
+                if(leaf.bounds.intersectRay(origin, inverseDirection, maxDistance, distance))
+                    maxDistance = function(leaf.entity, distance);
+            };
+            traverse(staticTree, test, visit);
+            traverse(dynamicTree, test, visit);
+        }
+    };
+
+}
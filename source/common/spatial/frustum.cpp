@@ -0,0 +1,63 @@
+#include "frustum.hpp"
+
+// AVX tests the 8 spheres of a batch at once. Without it, SSE2 tests them in two halves and other targets use the scalar loop.
+#if defined(__AVX__)
+#define OUR_FRUSTUM_AVX 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+#if OUR_FRUSTUM_SSE
+    // Returns the 4 bit mask of the spheres that are inside or intersect every plane
+    static inline int cullSpheres4(const glm::vec4 (&planes)[6], const float* x, const float* y, const float* z, const float* radius){
+        __m128 centerX = _mm_loadu_ps(x), centerY = _mm_loadu_ps(y), centerZ = _mm_loadu_ps(z), r = _mm_loadu_ps(radius);
+        __m128 zero = _mm_setzero_ps();
+        __m128 inside = _mm_cmpeq_ps(zero, zero); // All the bits are set
+        for(const auto& plane : planes){
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            // A sphere is outside a plane if its center is farther than its radius behind it
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+        }
+        return _mm_movemask_ps(inside);
+    }
+#endif
+
+    void Frustum::cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, std::uint8_t* visibleMasks) const {
+        for(size_t first = 0; first < count; first += SPHERE_BATCH){
+#if OUR_FRUSTUM_AVX
+            __m256 centerX = _mm256_loadu_ps(x + first), centerY = _mm256_loadu_ps(y + first), centerZ = _mm256_loadu_ps(z + first);
+            __m256 r = _mm256_loadu_ps(radius + first);
+            __m256 zero = _mm256_setzero_ps();
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for(const auto& plane : planes){
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(centerX, _mm256_set1_ps(plane.x)), _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y))),
+                    _mm256_add_ps(_mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+            }
+            visibleMasks[first / SPHERE_BATCH] = (std::uint8_t)_mm256_movemask_ps(inside);
+#elif OUR_FRUSTUM_SSE
+            int low = cullSpheres4(planes, x + first, y + first, z + first, radius + first);
+            int high = cullSpheres4(planes, x + first + 4, y + first + 4, z + first + 4, radius + first + 4);
+            visibleMasks[first / SPHERE_BATCH] = (std::uint8_t)(low | (high << 4));
+#else
+            std::uint8_t mask = 0;
+            for(size_t lane = 0; lane < SPHERE_BATCH; ++lane){
+                size_t index = first + lane;
+                bool inside = true;
+                for(const auto& plane : planes)
+                    inside = inside && plane.x * x[index] + plane.y * y[index] + plane.z * z[index] + plane.w + radius[index] >= 0.0f;
+                if(inside) mask |= (std::uint8_t)(1u << lane);
+            }
+            visibleMasks[first / SPHERE_BATCH] = mask;
+#endif
+        }
+    }
+
+}
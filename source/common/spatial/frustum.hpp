@@ -0,0 +1,69 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "bounding-sphere.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace our {
+
+    // A view frustum stored as 6 planes (left, right, bottom, top, near, far) whose normals point inside.
+    // A point "p" is inside a plane if "dot(plane.xyz, p) + plane.w >= 0".
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Extracts the planes from a view projection matrix (the Gribb & Hartmann method).
+        // Each plane is a sum or a difference of the last row of the matrix and one of the other rows.
+        static Frustum fromMatrix(const glm::mat4& viewProjection) {
+            // glm matrices are column major, so the rows are gathered from the columns
+            auto row = [&viewProjection](int index){
+                return glm::vec4(viewProjection[0][index], viewProjection[1][index], viewProjection[2][index], viewProjection[3][index]);
+            };
+            glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+            Frustum frustum;
+            frustum.planes[0] = w + x;
+            frustum.planes[1] = w - x;
+            frustum.planes[2] = w + y;
+            frustum.planes[3] = w - y;
+            frustum.planes[4] = w + z;
+            frustum.planes[5] = w - z;
+            // The planes are normalized so that the distances computed with them are in world units
+            for(auto& plane : frustum.planes)
+                plane /= glm::length(glm::vec3(plane));
+            return frustum;
+        }
+
+        // Returns false if the box is completely outside one of the planes.
+        // It can return true for a box that is outside the frustum near one of its corners, which is fine for culling.
+        bool intersects(const AABB& box) const {
+            glm::vec3 center = box.getCenter(), extents = box.getExtents();
+            for(const auto& plane : planes){
+                // The distance of the center from the plane compared with the projection of the extents on the plane's normal
+                float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+                if(distance < -radius) return false;
+            }
+            return true;
+        }
+
+        // Returns false if the sphere is completely outside one of the planes
+        bool intersects(const BoundingSphere& sphere) const {
+            for(const auto& plane : planes)
+                if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+            return true;
+        }
+
+        // The number of spheres tested together by "cullSpheres"
+        static constexpr size_t SPHERE_BATCH = 8;
+
+        // Tests many spheres stored as a structure of arrays (the centers' coordinates and the radii each in their own array),
+        // so that 8 spheres are tested against a plane with a few SIMD instructions.
+        // "count" must be a multiple of SPHERE_BATCH (the arrays are padded by the caller). For every batch of 8 spheres,
+        // a mask is written to "visibleMasks" where bit i is set if sphere i of the batch is not completely outside one of the planes.
+        void cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count, std::uint8_t* visibleMasks) const;
+    };
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "aabb.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+namespace our {
+
+    // Intersects a ray with a triangle using the Moller-Trumbore method. Both sides of the triangle are hit.
+    // If the ray hits the triangle between 0 and "maxDistance", it returns true and the distance of the hit in units of "direction".
+    inline bool intersectRayTriangle(const glm::vec3& origin, const glm::vec3& direction,
+        const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float maxDistance, float& distance) {
+        glm::vec3 edge1 = b - a, edge2 = c - a;
+        glm::vec3 p = glm::cross(direction, edge2);
+        float determinant = glm::dot(edge1, p);
+        if(std::abs(determinant) < 1e-12f) return false; // The ray is parallel to the triangle
+        float inverse = 1.0f / determinant;
+        glm::vec3 s = origin - a;
+        float u = glm::dot(s, p) * inverse;
+        if(u < 0.0f || u > 1.0f) return false;
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverse;
+        if(v < 0.0f || u + v > 1.0f) return false;
+        float t = glm::dot(edge2, q) * inverse;
+        if(t < 0.0f || t > maxDistance) return false;
+        distance = t;
+        return true;
+    }
+
+    // Returns the point of the triangle that is the closest to "point".
+    // The point is compared with the regions of the triangle's vertices and edges, and is projected on the face if it is in none of them.
+    inline glm::vec3 closestPointOnTriangle(const glm::vec3& point, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        glm::vec3 ab = b - a, ac = c - a, ap = point - a;
+        float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+        if(d1 <= 0.0f && d2 <= 0.0f) return a;
+        glm::vec3 bp = point - b;
+        float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+        if(d3 >= 0.0f && d4 <= d3) return b;
+        float vc = d1 * d4 - d3 * d2;
+        if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+        glm::vec3 cp = point - c;
+        float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+        if(d6 >= 0.0f && d5 <= d6) return c;
+        float vb = d5 * d2 - d1 * d6;
+        if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+        float va = d3 * d6 - d5 * d4;
+        if(va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        float denominator = 1.0f / (va + vb + vc);
+        return a + ab * (vb * denominator) + ac * (vc * denominator);
+    }
+
+    // Returns true if the triangle and the box share at least one point.
+    // It uses the separating axis theorem: they are apart if and only if their projections are apart on one of 13 axes
+    // (the 3 axes of the box, the normal of the triangle and the cross products of the box axes with the triangle's edges).
+    inline bool triangleOverlapsBox(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const AABB& box) {
+        // Everything is moved so that the box is centered at the origin
+        glm::vec3 center = box.getCenter(), extents = box.getExtents();
+        glm::vec3 v0 = a - center, v1 = b - center, v2 = c - center;
+        glm::vec3 edges[3] = {v1 - v0, v2 - v1, v0 - v2};
+
+        // The box axes are the same test as comparing the triangle's bounds with the box
+        if(glm::any(glm::greaterThan(glm::min(glm::min(v0, v1), v2), extents))) return false;
+        if(glm::any(glm::lessThan(glm::max(glm::max(v0, v1), v2), -extents))) return false;
+
+        auto separates = [&](const glm::vec3& axis){
+            float p0 = glm::dot(v0, axis), p1 = glm::dot(v1, axis), p2 = glm::dot(v2, axis);
+            float radius = glm::dot(extents, glm::abs(axis));
+            return std::fmin(p0, std::fmin(p1, p2)) > radius || std::fmax(p0, std::fmax(p1, p2)) < -radius;
+        };
+        for(const glm::vec3& edge : edges){
+            if(separates(glm::vec3(0, -edge.z, edge.y))) return false; // X axis x edge
+            if(separates(glm::vec3(edge.z, 0, -edge.x))) return false; // Y axis x edge
+            if(separates(glm::vec3(-edge.y, edge.x, 0))) return false; // Z axis x edge
+        }
+        return !separates(glm::cross(edges[0], edges[1]));
+    }
+
+}
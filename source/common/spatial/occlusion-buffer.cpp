@@ -0,0 +1,221 @@
+#include "occlusion-buffer.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_OCCLUSION_BUFFER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+    void OcclusionBuffer::resize(int width, int height){
+        this->width = std::max(width, 1);
+        this->height = std::max(height, 1);
+        tileColumns = (this->width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tileRows = (this->height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        stride = tileColumns * TILE_WIDTH;
+        depths.assign((size_t)stride * this->height, 1.0f);
+        tileTriangles.resize((size_t)tileColumns * tileRows);
+    }
+
+    void OcclusionBuffer::begin(const glm::mat4& viewProjection){
+        this->viewProjection = viewProjection;
+        std::fill(depths.begin(), depths.end(), 1.0f);
+        triangles.clear();
+        for(auto& list : tileTriangles) list.clear();
+    }
+
+    void OcclusionBuffer::addOccluder(const glm::mat4& localToWorld, const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices){
+        glm::mat4 matrix = viewProjection * localToWorld;
+        for(size_t index = 0; index + 2 < indices.size(); index += 3){
+            glm::vec4 corners[3] = {
+                matrix * glm::vec4(positions[indices[index]], 1.0f),
+                matrix * glm::vec4(positions[indices[index + 1]], 1.0f),
+                matrix * glm::vec4(positions[indices[index + 2]], 1.0f)
+            };
+            // In the clip space, a point is in front of the near plane if "z + w >= 0"
+            float distances[3];
+            int insideCount = 0;
+            for(int corner = 0; corner < 3; ++corner){
+                distances[corner] = corners[corner].z + corners[corner].w;
+                if(distances[corner] >= 0.0f) ++insideCount;
+            }
+            if(insideCount == 3){
+                setupTriangle(corners[0], corners[1], corners[2]);
+            } else if(insideCount > 0){
+                // The triangle crosses the near plane, so it is clipped into a polygon of 3 or 4 corners (Sutherland-Hodgman)
+                glm::vec4 polygon[4];
+                int count = 0;
+                for(int corner = 0; corner < 3; ++corner){
+                    int next = (corner + 1) % 3;
+                    if(distances[corner] >= 0.0f) polygon[count++] = corners[corner];
+                    if((distances[corner] >= 0.0f) != (distances[next] >= 0.0f)){
+                        float t = distances[corner] / (distances[corner] - distances[next]);
+                        polygon[count++] = glm::mix(corners[corner], corners[next], t);
+                    }
+                }
+                for(int corner = 2; corner < count; ++corner)
+                    setupTriangle(polygon[0], polygon[corner - 1], polygon[corner]);
+            }
+        }
+    }
+
+    void OcclusionBuffer::setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c){
+        // A point on the near plane can have "w == 0" if the near distance is 0, which can't be projected
+        if(a.w <= 0.0f || b.w <= 0.0f || c.w <= 0.0f) return;
+        // From the clip space to pixels (x & y) and to a depth from 0 to 1 (z)
+        auto project = [this](const glm::vec4& point){
+            glm::vec3 ndc = glm::vec3(point) / point.w;
+            return glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+        };
+        glm::vec3 v0 = project(a), v1 = project(b), v2 = project(c);
+        if(v0.z > 1.0f && v1.z > 1.0f && v2.z > 1.0f) return; // Behind the far plane
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if(std::abs(area) < 1e-6f) return;
+        // Both faces of a triangle hide what is behind them, so the back faces are turned into front (counter clockwise) faces
+        if(area < 0.0f){
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        Triangle triangle;
+        glm::vec2 lowest = glm::min(glm::min(glm::vec2(v0), glm::vec2(v1)), glm::vec2(v2));
+        glm::vec2 highest = glm::max(glm::max(glm::vec2(v0), glm::vec2(v1)), glm::vec2(v2));
+        // The bounds are clamped around the screen first since the corners near the near plane can be very far away
+        glm::vec2 screen((float)width, (float)height);
+        lowest = glm::clamp(lowest, glm::vec2(-1.0f), screen + 1.0f);
+        highest = glm::clamp(highest, glm::vec2(-1.0f), screen + 1.0f);
+        // The pixels whose centers (at "x + 0.5") are inside the bounds
+        triangle.min = glm::max(glm::ivec2(glm::ceil(lowest - 0.5f)), glm::ivec2(0));
+        triangle.max = glm::min(glm::ivec2(glm::floor(highest - 0.5f)), glm::ivec2(width - 1, height - 1));
+        if(triangle.min.x > triangle.max.x || triangle.min.y > triangle.max.y) return;
+
+        // The edge function of the edge from "p" to "q" is positive on its left, which is the inside of a counter clockwise triangle.
+        // Edge i is the one facing corner i, so "edge_i / area" is the weight of corner i at a point.
+        const glm::vec3* corners[3] = {&v0, &v1, &v2};
+        float depthA = 0.0f, depthB = 0.0f, depthC = 0.0f;
+        for(int edge = 0; edge < 3; ++edge){
+            const glm::vec3& p = *corners[(edge + 1) % 3];
+            const glm::vec3& q = *corners[(edge + 2) % 3];
+            float A = p.y - q.y, B = q.x - p.x, C = p.x * q.y - p.y * q.x;
+            depthA += A * corners[edge]->z;
+            depthB += B * corners[edge]->z;
+            depthC += C * corners[edge]->z;
+            triangle.edgeA[edge] = A;
+            triangle.edgeB[edge] = B;
+            triangle.edgeC[edge] = C;
+        }
+        triangle.depthA = depthA / area;
+        triangle.depthB = depthB / area;
+        // A pixel is covered if its center is inside the triangle (like on the GPU) but the depth stored in it is the farthest depth
+        // of the triangle's plane inside the pixel, so an occludee that is in front of any part of the occluder in that pixel stays visible
+        triangle.depthC = depthC / area + 0.5f * (std::abs(triangle.depthA) + std::abs(triangle.depthB));
+
+        std::uint32_t triangleIndex = (std::uint32_t)triangles.size();
+        triangles.push_back(triangle);
+        for(int row = triangle.min.y / TILE_HEIGHT; row <= triangle.max.y / TILE_HEIGHT; ++row)
+            for(int column = triangle.min.x / TILE_WIDTH; column <= triangle.max.x / TILE_WIDTH; ++column)
+                tileTriangles[row * tileColumns + column].push_back(triangleIndex);
+    }
+
+    void OcclusionBuffer::rasterizeTile(int tile){
+        int tileX = (tile % tileColumns) * TILE_WIDTH, tileY = (tile / tileColumns) * TILE_HEIGHT;
+        int tileEndX = tileX + TILE_WIDTH - 1, tileEndY = std::min(tileY + TILE_HEIGHT, height) - 1;
+        for(std::uint32_t triangleIndex : tileTriangles[tile]){
+            const Triangle& triangle = triangles[triangleIndex];
+            // The first column is aligned to 4 pixels (the extra pixels are outside the triangle so they fail the edge tests)
+            int startX = std::max(triangle.min.x & ~3, tileX), endX = std::min(triangle.max.x, tileEndX);
+            int startY = std::max(triangle.min.y, tileY), endY = std::min(triangle.max.y, tileEndY);
+            for(int y = startY; y <= endY; ++y){
+                float centerY = y + 0.5f;
+                float* row = depths.data() + (size_t)y * stride;
+#if OUR_OCCLUSION_BUFFER_SSE
+                // The edge functions and the depth of the 4 pixels starting at x are "A * (x + 0.5 + lane) + B * centerY + C"
+                __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                __m128 rowEdge[3], edgeA[3];
+                for(int edge = 0; edge < 3; ++edge){
+                    edgeA[edge] = _mm_set1_ps(triangle.edgeA[edge]);
+                    rowEdge[edge] = _mm_set1_ps(triangle.edgeB[edge] * centerY + triangle.edgeC[edge]);
+                }
+                __m128 depthA = _mm_set1_ps(triangle.depthA);
+                __m128 rowDepth = _mm_set1_ps(triangle.depthB * centerY + triangle.depthC);
+                __m128 zero = _mm_setzero_ps();
+                for(int x = startX; x <= endX; x += 4){
+                    __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+                    __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], pixelX), rowEdge[0]), zero);
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], pixelX), rowEdge[1]), zero));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], pixelX), rowEdge[2]), zero));
+                    if(_mm_movemask_ps(inside) == 0) continue;
+                    __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, pixelX), rowDepth);
+                    __m128 old = _mm_loadu_ps(row + x);
+                    __m128 nearest = _mm_min_ps(old, depth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+                }
+#else
+                for(int x = startX; x <= endX; ++x){
+                    float centerX = x + 0.5f;
+                    bool inside = true;
+                    for(int edge = 0; edge < 3; ++edge)
+                        inside = inside && triangle.edgeA[edge] * centerX + triangle.edgeB[edge] * centerY + triangle.edgeC[edge] >= 0.0f;
+                    if(!inside) continue;
+                    float depth = triangle.depthA * centerX + triangle.depthB * centerY + triangle.depthC;
+                    row[x] = std::min(row[x], depth);
+                }
+#endif
+            }
+        }
+    }
+
+    void OcclusionBuffer::rasterize(JobSystem* jobs){
+        int tileCount = tileColumns * tileRows;
+        // The tiles don't share any pixel, so they are rasterized concurrently without any synchronization
+        if(jobs){
+            jobs->parallelFor(0, tileCount, 1, [this](size_t begin, size_t end){
+                for(size_t tile = begin; tile < end; ++tile) rasterizeTile((int)tile);
+            });
+        } else {
+            for(int tile = 0; tile < tileCount; ++tile) rasterizeTile(tile);
+        }
+    }
+
+    bool OcclusionBuffer::isVisible(const AABB& worldBox) const {
+        if(worldBox.isEmpty()) return false;
+        glm::vec2 lowest(std::numeric_limits<float>::max()), highest(-std::numeric_limits<float>::max());
+        float nearestDepth = std::numeric_limits<float>::max();
+        for(int corner = 0; corner < 8; ++corner){
+            glm::vec3 point(
+                (corner & 1) ? worldBox.max.x : worldBox.min.x,
+                (corner & 2) ? worldBox.max.y : worldBox.min.y,
+                (corner & 4) ? worldBox.max.z : worldBox.min.z
+            );
+            glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+            // The box crosses the near plane (the camera may be inside it), so we can't tell where it is on the screen
+            if(clip.w <= 0.0f || clip.z + clip.w < 0.0f) return true;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            glm::vec2 pixel((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height);
+            lowest = glm::min(lowest, pixel);
+            highest = glm::max(highest, pixel);
+            nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+        }
+        // Every pixel touched by the screen rectangle of the box is checked, along with a border of one pixel around them.
+        // The occluders cover the pixels whose centers they cover, so a pixel at the edge of an occluder can be partly uncovered,
+        // but then one of its neighbors is uncovered too, which keeps the box visible.
+        glm::vec2 screen((float)width, (float)height);
+        lowest = glm::clamp(lowest, glm::vec2(-2.0f), screen + 2.0f);
+        highest = glm::clamp(highest, glm::vec2(-2.0f), screen + 2.0f);
+        if(highest.x < 0.0f || highest.y < 0.0f || lowest.x > screen.x || lowest.y > screen.y) return false; // The box is outside the screen
+        glm::ivec2 first = glm::max(glm::ivec2(glm::floor(lowest)) - 1, glm::ivec2(0));
+        glm::ivec2 last = glm::min(glm::ivec2(glm::floor(highest)) + 1, glm::ivec2(width - 1, height - 1));
+        for(int y = first.y; y <= last.y; ++y){
+            const float* row = depths.data() + (size_t)y * stride;
+            for(int x = first.x; x <= last.x; ++x)
+                if(nearestDepth <= row[x]) return true;
+        }
+        return false;
+    }
+
+}
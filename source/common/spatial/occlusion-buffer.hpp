@@ -0,0 +1,72 @@
+#pragma once
+
+#include "aabb.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    class JobSystem; // A forward declaration of the JobSystem Class
+
+    // A low resolution depth buffer that is filled on the CPU with a few big objects (the occluders), then used to skip the objects
+    // hidden behind them (the occludees) before they are sent to the GPU.
+    // The occluders are drawn like the GPU would do it: their triangles are projected to the screen and every pixel whose center
+    // is inside a triangle keeps the nearest depth. The screen is split into tiles so that the tiles can be rasterized by different threads
+    // without sharing any pixel, and the inside test of 4 pixels of a row is done at once with SIMD edge functions.
+    // Since the buffer doesn't touch the GPU, it can be used (and tested) without an OpenGL context.
+    // The usage in a frame is: "begin" -> "addOccluder" for each occluder -> "rasterize" -> "isVisible" for each occludee.
+    class OcclusionBuffer {
+        // A triangle after the projection. The edge functions are "A * x + B * y + C" in pixels and they are all positive inside the triangle.
+        // The depth is linear in screen space: "depth = depthA * x + depthB * y + depthC".
+        struct Triangle {
+            glm::vec3 edgeA, edgeB, edgeC; // One component for each edge
+            float depthA, depthB, depthC;
+            glm::ivec2 min, max; // The pixels covered by the triangle's bounds (inclusive)
+        };
+
+        int width = 0, height = 0;
+        int stride = 0; // The number of depths in a row of the buffer (the width rounded up to a whole number of tiles)
+        int tileColumns = 0, tileRows = 0;
+        std::vector<float> depths; // The depth (from 0 at the near plane to 1 at the far plane) of the nearest occluder at each pixel
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<std::uint32_t>> tileTriangles; // The indices of the triangles that overlap each tile
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+
+        // Computes the edge functions of a projected triangle and adds it to the tiles it overlaps
+        void setupTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        // Draws the triangles of a tile into the buffer
+        void rasterizeTile(int tile);
+
+    public:
+        // The size of a tile in pixels. The width is a multiple of 4 since 4 pixels are rasterized at once.
+        static constexpr int TILE_WIDTH = 32;
+        static constexpr int TILE_HEIGHT = 16;
+
+        // Changes the resolution of the buffer
+        void resize(int width, int height);
+        int getWidth() const { return width; }
+        int getHeight() const { return height; }
+
+        // Clears the buffer and the occluders, then sets the matrix that projects the world to the screen
+        void begin(const glm::mat4& viewProjection);
+        // Projects the triangles of an occluder ("triangles" holds 3 indices in "positions" for each triangle) and sorts them into the tiles.
+        // The parts of the triangles behind the near plane are clipped.
+        void addOccluder(const glm::mat4& localToWorld, const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& triangles);
+        // Draws the occluders into the buffer. If a job system is given, the tiles are split between its workers.
+        void rasterize(JobSystem* jobs = nullptr);
+
+        // Returns false if the box is completely hidden behind the occluders.
+        // The screen rectangle of the box is compared with the buffer using the nearest depth of the box, which is conservative.
+        // A box that crosses the near plane is always visible.
+        bool isVisible(const AABB& worldBox) const;
+
+        // Returns the depth stored at the given pixel (the row 0 is at the bottom of the screen like in OpenGL)
+        float getDepth(int x, int y) const { return depths[y * stride + x]; }
+        // Returns the number of occluder triangles (after clipping) that were added since "begin"
+        size_t getTriangleCount() const { return triangles.size(); }
+    };
+
+}
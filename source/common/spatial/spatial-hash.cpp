@@ -0,0 +1,88 @@
+#include "spatial-hash.hpp"
+#include "../ecs/world.hpp"
+
+#include <algorithm>
+
+namespace our {
+
+    // The entity is hashed with its current world position
+    void SpatialHash::insert(Entity* entity){
+        Entry entry;
+        entry.entity = entity;
+        entry.handle = entity->getHandle();
+        entry.center = entity->getLocalToWorldMatrix()[3];
+        entry.previousCenter = entry.center;
+        entry.cell = cellOf(entry.center);
+        entry.version = entity->getLocalToWorldVersion();
+        std::uint32_t index = (std::uint32_t)entries.size();
+        entries.push_back(entry);
+        entryIndices[entry.handle] = index;
+        cells[entry.cell].push_back(index);
+    }
+
+    // The last entry is moved into the freed slot, so its index is replaced in its cell
+    void SpatialHash::removeAt(std::uint32_t index){
+        auto removeFromCell = [this](CellKey cell, std::uint32_t entryIndex){
+            auto it = cells.find(cell);
+            auto& list = it->second;
+            list.erase(std::find(list.begin(), list.end(), entryIndex));
+            if(list.empty()) cells.erase(it);
+        };
+        removeFromCell(entries[index].cell, index);
+        entryIndices.erase(entries[index].handle);
+        std::uint32_t last = (std::uint32_t)entries.size() - 1;
+        if(index != last){
+            entries[index] = entries[last];
+            auto& list = cells[entries[index].cell];
+            *std::find(list.begin(), list.end(), last) = index;
+            entryIndices[entries[index].handle] = index;
+        }
+        entries.pop_back();
+    }
+
+    // Most entities don't move, so comparing the version of the world matrix is all the work done for them
+    void SpatialHash::rehash(std::uint32_t index){
+        Entry& entry = entries[index];
+        entry.previousCenter = entry.center;
+        std::uint32_t version = entry.entity->getLocalToWorldVersion();
+        if(version == entry.version) return;
+        entry.version = version;
+        entry.center = entry.entity->getLocalToWorldMatrix()[3];
+        maxDisplacement = std::max(maxDisplacement, glm::distance(entry.previousCenter, entry.center));
+        CellKey cell = cellOf(entry.center);
+        if(cell == entry.cell) return;
+        auto it = cells.find(entry.cell);
+        auto& list = it->second;
+        list.erase(std::find(list.begin(), list.end(), index));
+        if(list.empty()) cells.erase(it);
+        entry.cell = cell;
+        cells[cell].push_back(index);
+    }
+
+    // The deleted entities are found through their handles since their memory could already hold new entities
+    void SpatialHash::synchronize(World* world){
+        for(std::uint32_t index = 0; index < entries.size();){
+            if(world->get(entries[index].handle) != entries[index].entity) removeAt(index);
+            else ++index;
+        }
+        for(Entity* entity : world->getEntities()){
+            if(entryIndices.count(entity->getHandle())) continue;
+            if(!filter || filter(entity)) insert(entity);
+        }
+        entityListVersion = world->getEntityListVersion();
+    }
+
+    void SpatialHash::update(World* world){
+        if(world != this->world){
+            clear();
+            this->world = world;
+            synchronize(world);
+            return;
+        }
+        if(world->getEntityListVersion() != entityListVersion) synchronize(world);
+        maxDisplacement = 0.0f;
+        for(std::uint32_t index = 0; index < entries.size(); ++index)
+            rehash(index);
+    }
+
+}
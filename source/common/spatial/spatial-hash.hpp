@@ -0,0 +1,154 @@
+#pragma once
+
+#include "sweep.hpp"
+#include "../ecs/entity-handle.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+    class Entity; // A forward declaration of the Entity Class
+
+    // A spatial hash is a broadphase that divides the space into a uniform grid of cubic cells and remembers which entities are in each cell.
+    // Only the cells that are not empty are stored (in a hash map), so the grid has no bounds.
+    // An entity is put in the cell that contains its world position (the origin of its local space), so a query for the entities
+    // near a point only looks at the few cells that overlap the query sphere instead of checking every entity in the world.
+    // The grid is kept up to date incrementally by "update": an entity only moves between cells if its world matrix changed,
+    // and the entity list of the world is only visited again when entities were added or deleted.
+    class SpatialHash {
+    public:
+        // Decides which entities are tracked by the spatial hash (it is called once for every entity added to the world)
+        // or which tracked entities are reported by a query
+        typedef std::function<bool(const Entity*)> Filter;
+
+    private:
+        typedef std::uint64_t CellKey; // The 3 coordinates of a cell packed into one integer (21 bits each)
+
+        struct Entry {
+            Entity* entity;
+            EntityHandle handle; // Used to detect the entities that were deleted from the world
+            glm::vec3 center; // The world position of the entity when it was last hashed
+            glm::vec3 previousCenter; // The world position of the entity at the update before the last one (see "querySwept")
+            CellKey cell; // The cell that holds the entry
+            std::uint32_t version; // The version of the entity's world matrix when it was last hashed
+        };
+
+        // Mixes the bits of a cell key so that the neighbouring cells are spread over the buckets of the map
+        struct CellHasher {
+            size_t operator()(CellKey key) const {
+                key ^= key >> 33;
+                key *= 0xff51afd7ed558ccdull;
+                key ^= key >> 33;
+                return (size_t)key;
+            }
+        };
+
+        float cellSize;
+        Filter filter;
+        std::vector<Entry> entries; // The tracked entities (stored densely so that "update" is a linear pass)
+        std::unordered_map<EntityHandle, std::uint32_t> entryIndices; // The index of each tracked entity in "entries"
+        std::unordered_map<CellKey, std::vector<std::uint32_t>, CellHasher> cells; // For each cell, the indices of the entries in it
+        const World* world = nullptr; // The world whose entities are tracked
+        std::uint32_t entityListVersion = 0; // The version of the world's entity list when the entries were last synchronized with it
+        float maxDisplacement = 0.0f; // The longest distance moved by an entity during the last update
+
+        // Returns the integer coordinate of the cell containing the given coordinate along one axis
+        int cellCoordinate(float value) const { return (int)std::floor(value / cellSize); }
+        // Packs the coordinates of a cell into a key
+        static CellKey makeKey(int x, int y, int z){
+            const CellKey mask = (CellKey(1) << 21) - 1;
+            return (CellKey(x) & mask) | ((CellKey(y) & mask) << 21) | ((CellKey(z) & mask) << 42);
+        }
+        CellKey cellOf(const glm::vec3& point) const {
+            return makeKey(cellCoordinate(point.x), cellCoordinate(point.y), cellCoordinate(point.z));
+        }
+
+        // Adds the entity to the entries and to the cell containing it
+        void insert(Entity* entity);
+        // Removes the entry at the given index from its cell and from the entries
+        void removeAt(std::uint32_t index);
+        // Moves the entry at the given index to its new cell if its world position changed
+        void rehash(std::uint32_t index);
+        // Adds the new entities of the world and removes the deleted ones
+        void synchronize(World* world);
+
+    public:
+        // The cell size should be close to the distances that are usually queried (a query then looks at 2x2x2 to 3x3x3 cells)
+        explicit SpatialHash(float cellSize = 2.0f, Filter filter = nullptr) : cellSize(cellSize), filter(std::move(filter)) {}
+
+        // Brings the grid up to date with the given world. It should be called once per frame before the queries.
+        // The first call (and any call with another world) visits all the entities of the world.
+        void update(World* world);
+
+        // Calls "function(entity, center)" for every tracked entity whose world position ("center") is strictly closer than "radius" to "point".
+        // The positions are the ones found by the last "update". If a filter is given, the entities for which it returns false are skipped.
+        template<typename Function>
+        void query(const glm::vec3& point, float radius, Function function, const Filter& filter = nullptr) const {
+            int minX = cellCoordinate(point.x - radius), maxX = cellCoordinate(point.x + radius);
+            int minY = cellCoordinate(point.y - radius), maxY = cellCoordinate(point.y + radius);
+            int minZ = cellCoordinate(point.z - radius), maxZ = cellCoordinate(point.z + radius);
+            float radiusSquared = radius * radius;
+            for(int x = minX; x <= maxX; ++x)
+                for(int y = minY; y <= maxY; ++y)
+                    for(int z = minZ; z <= maxZ; ++z){
+                        auto it = cells.find(makeKey(x, y, z));
+                        if(it == cells.end()) continue;
+                        for(std::uint32_t index : it->second){
+                            const Entry& entry = entries[index];
+                            glm::vec3 offset = entry.center - point;
+                            if(glm::dot(offset, offset) >= radiusSquared) continue;
+                            if(!filter || filter(entry.entity)) function(entry.entity, entry.center);
+                        }
+                    }
+        }
+
+        // Calls "function(entity, previousCenter, center, time)" for every tracked entity that came strictly closer than "radius" to a point
+        // moving from "from" to "to" while the entity moved from its position at the update before the last one ("previousCenter")
+        // to its position at the last update ("center"). Both are assumed to move in straight lines during the same time,
+        // and "time" (from 0 to 1) is the first moment when they got closer than "radius".
+        // So the collisions between the updates are never missed, however far the entities move in an update.
+        // The entities that moved more than "maxMove" in the update were teleported (e.g. a car that wrapped around the road),
+        // so they are only tested at their current position. If a filter is given, the entities for which it returns false are skipped.
+        template<typename Function>
+        void querySwept(const glm::vec3& from, const glm::vec3& to, float radius, float maxMove, Function function, const Filter& filter = nullptr) const {
+            // Any entity that can be hit is in the cells around the point's path, since it never moved more than this from its center
+            float reach = radius + std::min(maxDisplacement, maxMove);
+            glm::vec3 low = glm::min(from, to) - reach, high = glm::max(from, to) + reach;
+            for(int x = cellCoordinate(low.x); x <= cellCoordinate(high.x); ++x)
+                for(int y = cellCoordinate(low.y); y <= cellCoordinate(high.y); ++y)
+                    for(int z = cellCoordinate(low.z); z <= cellCoordinate(high.z); ++z){
+                        auto it = cells.find(makeKey(x, y, z));
+                        if(it == cells.end()) continue;
+                        for(std::uint32_t index : it->second){
+                            const Entry& entry = entries[index];
+                            glm::vec3 previous = entry.previousCenter;
+                            if(glm::distance(previous, entry.center) > maxMove) previous = entry.center;
+                            // The entity is tested in the space where it stands still
+                            float time;
+                            if(!sweepPointSphere(from - previous, (to - from) - (entry.center - previous), radius, time)) continue;
+                            if(!filter || filter(entry.entity)) function(entry.entity, previous, entry.center, time);
+                        }
+                    }
+        }
+
+        // Returns the number of tracked entities
+        size_t size() const { return entries.size(); }
+
+        // Forgets all the entities (the next "update" visits the whole world again)
+        void clear(){
+            entries.clear();
+            entryIndices.clear();
+            cells.clear();
+            world = nullptr;
+        }
+    };
+
+}
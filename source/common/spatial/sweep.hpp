@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+namespace our {
+
+    // Finds the first time at which a point moving from "start" to "start + displacement" (during a time going from 0 to 1)
+    // is strictly closer than "radius" to the origin. It returns false if that never happens during the move.
+    // Two spheres moving at the same time collide if their relative motion (the motion of one as seen from the other) comes closer
+    // than the sum of their radii, so this tests them without missing the collisions that happen between the start and the end of the move.
+    inline bool sweepPointSphere(const glm::vec3& start, const glm::vec3& displacement, float radius, float& time) {
+        // We solve "|start + t * displacement|^2 = radius^2", which is "a * t^2 + b * t + c = 0"
+        float c = glm::dot(start, start) - radius * radius;
+        if(c < 0.0f) { time = 0.0f; return true; } // It starts inside
+        float a = glm::dot(displacement, displacement);
+        float b = 2.0f * glm::dot(start, displacement);
+        if(a <= 0.0f || b >= 0.0f) return false; // It doesn't move or it moves away
+        float discriminant = b * b - 4.0f * a * c;
+        if(discriminant <= 0.0f) return false; // It passes outside (or only touches the sphere)
+        float t = (-b - std::sqrt(discriminant)) / (2.0f * a);
+        if(t >= 1.0f) return false; // It only gets there after the end of the move
+        time = t;
+        return true;
+    }
+
+}
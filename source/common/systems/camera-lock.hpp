@@ -19,8 +19,10 @@ namespace our
     // For more information, see "common/components/free-camera-controller.hpp"
     class CameraLockSystem {
         Application* app; // The application in which the state runs
-        CameraComponent* camera = nullptr;
-        Entity* player = nullptr;
+        EntityHandle cameraEntity; // The entity holding the camera (we keep a handle since the entity could be deleted)
+        EntityHandle playerEntity; // The player entity
+        const NameID playerName = internName("player"); // The names are interned once so that the lookups don't hash strings every frame
+        Tick camerasTick = 0; // The camera structure tick of the world when the camera was last searched for
     public:
         // When a state enters, it should call this function and give it the pointer to the application
         void enter(Application* app){
@@ -29,17 +31,14 @@ namespace our
 
         // This should be called every frame to update all entities containing a FreeCameraControllerComponent 
         void update(World* world, float deltaTime) {
-            if (!(camera && player)){
-                for(auto entity : world->getEntities()){
-                    if (!player && entity->name == "player") player = entity;
-                    if (!camera){
-                        camera = entity->getComponent<CameraComponent>();
-                    }
-                    if(camera && player) break;
-                }
-            }
-            // If there is no entity with both a CameraComponent and a ChickenCameraControllerComponent, we can do nothing so we return
+            // The handles return null if the entities were deleted, in which case we search for them again
+            Entity* player = world->get(playerEntity);
+            if (!player) player = world->findByName(playerName);
+            // We use the first camera in the camera storage (it is only searched again if a camera was added or removed)
+            CameraComponent* camera = world->findFirst<CameraComponent>(cameraEntity, camerasTick);
+            // If there is no camera or no player, we can do nothing so we return
             if(!(camera && player)) return;
+            playerEntity = player->getHandle();
 
             // We get a reference to the entity's position
             glm::vec3& position = camera->getOwner()->localTransform.position;
@@ -48,8 +47,9 @@ namespace our
         }
 
         void exit(){
-            camera = nullptr;
-            player = nullptr;
+            camerasTick = 0;
+            cameraEntity = EntityHandle();
+            playerEntity = EntityHandle();
         }
     };
 }
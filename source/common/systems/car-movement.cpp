@@ -0,0 +1,128 @@
+#include "car-movement.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// With SSE2, 4 cars are moved at once. Other targets use the scalar loop.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUR_TRAFFIC_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace our {
+
+    void CarMovementSystem::buildLanes(World* world){
+        // The lanes that still have cars keep their directions, so deleting the cars of a lane doesn't turn the cars of the others around
+        std::vector<Lane> previousLanes;
+        previousLanes.swap(lanes);
+        positions.clear();
+        speeds.clear();
+        lengths.clear();
+        cars.clear();
+        entityListVersion = world->getEntityListVersion();
+        nameVersion = world->getNameVersion();
+        restoreCount = world->getRestoreCount();
+        lanesBuilt = true;
+
+        std::vector<Entity*> found = world->findAllByName(carName);
+        std::stable_sort(found.begin(), found.end(), [](Entity* first, Entity* second){
+            return first->localTransform.position.z > second->localTransform.position.z;
+        });
+        for(Entity* car : found){
+            const glm::vec3& position = car->localTransform.position;
+            if(lanes.empty() || lanes.back().z - position.z >= laneTolerance){
+                // The new lanes alternate between driving toward -x and toward +x, starting with -x for the farthest one along z
+                float direction = lanes.empty() ? -1.0f : -lanes.back().direction;
+                for(const Lane& previous : previousLanes)
+                    if(std::abs(previous.z - position.z) < laneTolerance) { direction = previous.direction; break; }
+                lanes.push_back(Lane{position.y, position.z, direction, (std::uint32_t)cars.size(), 0});
+            }
+            lanes.back().count++;
+            positions.push_back(position.x);
+            speeds.push_back(car_speed);
+            lengths.push_back(car_length);
+            cars.push_back(car->getHandle());
+        }
+    }
+
+    // A car that is past the end of the road (in its direction) jumps back by the width of the road minus its length.
+    // Otherwise, it moves unless it is next to the player.
+    std::uint32_t traffic::advanceCarsSSE(const LaneStep& step, float* x, const float* speed, const float* length,
+        std::uint32_t first, std::uint32_t end, std::vector<std::uint32_t>& wrapped){
+        std::uint32_t index = first;
+#if OUR_TRAFFIC_SSE
+        __m128 direction = _mm_set1_ps(step.direction);
+        __m128 half = _mm_set1_ps(step.roadWidth / 2.0f), width = _mm_set1_ps(step.roadWidth);
+        __m128 player = _mm_set1_ps(step.playerX), offset2 = _mm_set1_ps(step.playerOffset2);
+        __m128 stop2 = _mm_set1_ps(step.stopDistance * step.stopDistance);
+        __m128 move = _mm_mul_ps(direction, _mm_set1_ps(step.deltaTime));
+        for(; index + 4 <= end; index += 4){
+            __m128 position = _mm_loadu_ps(x + index);
+            __m128 wrap = _mm_cmpgt_ps(_mm_mul_ps(position, direction), half);
+            __m128 dx = _mm_sub_ps(position, player);
+            __m128 moving = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), offset2), stop2);
+            __m128 moved = _mm_add_ps(position, _mm_and_ps(moving, _mm_mul_ps(move, _mm_loadu_ps(speed + index))));
+            __m128 jumped = _mm_sub_ps(position, _mm_mul_ps(direction, _mm_sub_ps(width, _mm_loadu_ps(length + index))));
+            _mm_storeu_ps(x + index, _mm_or_ps(_mm_and_ps(wrap, jumped), _mm_andnot_ps(wrap, moved)));
+            int mask = _mm_movemask_ps(wrap);
+            for(int bit = 0; mask != 0; ++bit, mask >>= 1)
+                if(mask & 1) wrapped.push_back(index + bit);
+        }
+#else
+        (void)step; (void)x; (void)speed; (void)length; (void)end; (void)wrapped;
+#endif
+        return index;
+    }
+
+    void traffic::advanceCarsScalar(const LaneStep& step, float* x, const float* speed, const float* length,
+        std::uint32_t first, std::uint32_t end, std::vector<std::uint32_t>& wrapped){
+        const float halfWidth = step.roadWidth / 2.0f, stopDistance2 = step.stopDistance * step.stopDistance;
+        for(std::uint32_t index = first; index < end; ++index){
+            if(step.direction * x[index] > halfWidth){
+                x[index] -= step.direction * (step.roadWidth - length[index]);
+                wrapped.push_back(index);
+            } else {
+                float dx = x[index] - step.playerX;
+                if(dx * dx + step.playerOffset2 > stopDistance2)
+                    x[index] += step.direction * speed[index] * step.deltaTime;
+            }
+        }
+    }
+
+    void CarMovementSystem::advanceLane(const Lane& lane, float playerX, float playerOffset2, float deltaTime, std::vector<std::uint32_t>& wrapped){
+        traffic::LaneStep step{lane.direction, road_width, playerX, playerOffset2, stopDistance, deltaTime};
+        std::uint32_t end = lane.first + lane.count;
+        // The cars that don't fill a group of 4 are moved by the scalar loop
+        std::uint32_t index = traffic::advanceCarsSSE(step, positions.data(), speeds.data(), lengths.data(), lane.first, end, wrapped);
+        traffic::advanceCarsScalar(step, positions.data(), speeds.data(), lengths.data(), index, end, wrapped);
+    }
+
+    void CarMovementSystem::update(World* world, float deltaTime){
+        Entity* player = world->get(playerEntity);
+        if (!player) player = world->findByName(playerName);
+        if(!player) return;
+        playerEntity = player->getHandle();
+        // The cars are read again when they could have changed: cars may have been added, deleted or renamed,
+        // and after a restore, the cars are back where the snapshot saved them (or were even recreated).
+        // Otherwise, the world isn't searched, even if it has no cars at all.
+        if (!lanesBuilt || world->getEntityListVersion() != entityListVersion || world->getNameVersion() != nameVersion
+            || world->getRestoreCount() != restoreCount) buildLanes(world);
+
+        glm::vec3 playerCenter = player->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
+        wrappedCars.clear();
+        for (const Lane& lane : lanes){
+            float dy = playerCenter.y - lane.y, dz = playerCenter.z - lane.z;
+            advanceLane(lane, playerCenter.x, dy * dy + dz * dz, deltaTime, wrappedCars);
+        }
+
+        // The handles are checked since a car could be deleted directly (not through the command buffer) after the lanes were built
+        for (size_t index = 0; index < cars.size(); ++index){
+            if (Entity* car = world->get(cars[index])) car->localTransform.position.x = positions[index];
+        }
+        for (std::uint32_t index : wrappedCars){
+            // The car jumps to the other side of the road, so it isn't blended with its old position when drawn
+            if (Entity* car = world->get(cars[index])) car->skipInterpolation();
+        }
+    }
+
+}
@@ -4,61 +4,96 @@
 #include "../application.hpp"
 
 #include <glm/glm.hpp>
-#include <glm/gtc/constants.hpp>
-#include <glm/gtx/euler_angles.hpp>
+
+#include <cstdint>
+#include <vector>
 
 namespace our
 {
 
+    // The kernels that move the cars of a lane. They work on the arrays of "CarMovementSystem", and the SIMD kernel
+    // must give the same result as the scalar one (the scalar one moves the cars that don't fill a group of 4).
+    namespace traffic {
+        // The values shared by all the cars of a lane in an update (see "CarMovementSystem::advanceLane")
+        struct LaneStep {
+            float direction; // +1 if the cars drive toward +x, -1 if they drive toward -x
+            float roadWidth; // The cars jump back when they are more than half of this from the middle of the road
+            float playerX, playerOffset2; // The x coordinate of the player and its squared distance to the lane's line
+            float stopDistance; // The cars stop while they are closer than this to the player
+            float deltaTime;
+        };
+
+        // Moves the cars [first, end) in groups of 4 with SSE2 and returns the index of the first car that is left (a group of 4 didn't fit).
+        // Without SSE2, it moves no car and returns "first". The indices of the cars that jumped back are added to "wrapped".
+        std::uint32_t advanceCarsSSE(const LaneStep& step, float* x, const float* speed, const float* length,
+            std::uint32_t first, std::uint32_t end, std::vector<std::uint32_t>& wrapped);
+        // Moves the cars [first, end) one by one. The indices of the cars that jumped back are added to "wrapped".
+        void advanceCarsScalar(const LaneStep& step, float* x, const float* speed, const float* length,
+            std::uint32_t first, std::uint32_t end, std::vector<std::uint32_t>& wrapped);
+    }
+
+    // The cars drive along the x axis in lanes (all the cars of a lane have the same z) and jump back to the other side of the road
+    // when they leave it. The state of the cars is not read from the entities every update: it is kept as a structure of arrays
+    // (one array for the positions, one for the speeds, ...) sorted by lane, so the update is a tight loop that moves 4 cars
+    // with each SIMD instruction. The positions are then written back to the entities' transforms in one pass.
     class CarMovementSystem {
+        // The cars of a lane are the range [first, first + count) of the arrays below
+        struct Lane {
+            float y, z; // The height and the depth of the lane's cars (they only move along x)
+            float direction; // +1 if the cars drive toward +x, -1 if they drive toward -x
+            std::uint32_t first, count;
+        };
+
         Application* app; // The application in which the state runs
         const float road_width = 24.0f;
-        const float car_length = 1.5f;
-        glm::vec3 v = glm::vec3(4.0f, 0.0f, 0.0f);
-        std::vector<Entity*> cars;
-        Entity* player = nullptr;
+        const float car_length = 1.5f; // The length given to every car that is found in the world
+        const float car_speed = 4.0f; // The speed given to every car that is found in the world
+        const float stopDistance = 1.3f; // The cars stop moving while their center is closer than this to the player's center
+        const float laneTolerance = 0.5f; // The cars whose depths differ by less than this share a lane
+        std::vector<Lane> lanes;
+        std::vector<float> positions; // The x coordinate of each car
+        std::vector<float> speeds;
+        std::vector<float> lengths;
+        std::vector<EntityHandle> cars; // We keep handles since the cars could be deleted while we hold them
+        std::vector<std::uint32_t> wrappedCars; // The cars that jumped to the other side of the road in the current update
+        // The world's versions when the lanes were built. The cars are searched again only if entities were added, deleted, renamed or restored.
+        std::uint32_t entityListVersion = 0, nameVersion = 0, restoreCount = 0;
+        bool lanesBuilt = false; // False till the cars are searched for the first time (or after "exit")
+        EntityHandle playerEntity;
+        const NameID playerName = internName("player"); // The names are interned once so that the lookups don't hash strings every frame
+        const NameID carName = internName("car");
+
+        // Finds the cars of the world, sorts them into lanes and reads their state from their transforms.
+        // The cars are expected to be root entities, so their local position is also their world position.
+        void buildLanes(World* world);
+
     public:
         // When a state enters, it should call this function and give it the pointer to the application
         void enter(Application* app){
             this->app = app;
         }
 
-        // This should be called every frame to update all entities containing a FreeCameraControllerComponent 
-        void update(World* world, float deltaTime) {
-            if (!player){
-                for(auto entity : world->getEntities()){
-                    if (!player && entity->name == "player") player = entity;
-                }
-            }
-            if(!player) return;
-            if (cars.empty()){
-                for(auto entity : world->getEntities()){
-                    if (entity->name == "car") cars.push_back(entity);
-                }
-                std::sort(cars.begin(), cars.end(), [](Entity*& first, Entity*& second){
-                    return first->localTransform.position.z > second->localTransform.position.z;
-                });
-            }
-            float lmao = 1;
-            for (auto& car: cars){
-                Transform& transform = car->localTransform;
-                if (-lmao * transform.position.x > road_width/2.0f) {
-                    transform.position += glm::vec3(lmao) * glm::vec3(road_width - car_length, 0, 0);
-                }
-                else {
-                    glm::vec3 carCenter = car->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-                    glm::vec3 playerCenter = player->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-                    float distance = glm::distance(carCenter, playerCenter);
-                    if (distance > 1.3)   
-                        transform.position -= glm::vec3(lmao) * v * deltaTime;
-                }
-                lmao = -lmao;
-            }
-        }
+        // This should be called every fixed update to move the cars and write their positions to their entities
+        void update(World* world, float deltaTime);
+
+        // Moves the cars of a lane. "playerX" is the x coordinate of the player and "playerOffset2" is the squared distance
+        // between the player and the lane's line, so the squared distance of a car to the player is "(x - playerX)^2 + playerOffset2".
+        // The indices (counted from the start of the arrays, so "lane.first" is the first car of the lane) of the cars
+        // that jumped to the other side of the road are added to "wrapped".
+        void advanceLane(const Lane& lane, float playerX, float playerOffset2, float deltaTime, std::vector<std::uint32_t>& wrapped);
+
+        // Returns the number of cars and lanes in the simulation
+        size_t getCarCount() const { return cars.size(); }
+        size_t getLaneCount() const { return lanes.size(); }
 
         void exit(){
+            lanes.clear();
+            positions.clear();
+            speeds.clear();
+            lengths.clear();
             cars.clear();
-            player = nullptr;
+            lanesBuilt = false;
+            playerEntity = EntityHandle();
         }
     };
 
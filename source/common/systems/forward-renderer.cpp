@@ -48,6 +48,17 @@ namespace our {
             this->skyMaterial->transparent = false;
         }
 
+        // Then we read the error allowed when picking the levels of detail of the meshes
+        lodBias = config.value("lodBias", lodBias);
+
+        // Then we check if the occlusion culling is enabled in the configuration
+        if(config.contains("occlusion")){
+            const auto& occlusion = config["occlusion"];
+            occlusionBuffer.resize(occlusion.value("width", 256), occlusion.value("height", 128));
+            maxOccluders = occlusion.value("maxOccluders", maxOccluders);
+            occlusionEnabled = true;
+        }
+
         // Then we check if there is a postprocessing shader in the configuration
         if(config.contains("postprocess")){
             //DONE: (Req 11) Create a framebuffer
@@ -90,6 +101,8 @@ namespace our {
     }
 
     void ForwardRenderer::destroy(){
+        // Stop observing the lights of the world
+        observeLights(nullptr);
         // Delete all objects related to the sky
         if(skyMaterial){
             delete skySphere;
@@ -109,53 +122,191 @@ namespace our {
             delete postprocessMaterial;
         }
         postprocessingRequested = false;
+        occlusionEnabled = false;
+    }
+
+    void ForwardRenderer::observeLights(World* world){
+        if(observedWorld)
+            for(auto observer : lightObservers) observedWorld->unobserve(observer);
+        observedWorld = world;
+        lights.clear();
+        lightsChanged = true;
+        if(!world) return;
+        // We search for the lights once, then the observers keep the list up to date
+        for(auto light : world->getComponents<LightComponent>())
+            lights.push_back(light);
+        lightObservers[0] = world->observe<LightComponent>(ComponentEvent::ADDED, [this](LightComponent* light){
+            lights.push_back(light);
+            lightsChanged = true;
+        });
+        lightObservers[1] = world->observe<LightComponent>(ComponentEvent::REMOVED, [this](LightComponent* light){
+            lights.erase(std::remove(lights.begin(), lights.end(), light), lights.end());
+            lightsChanged = true;
+        });
+        lightObservers[2] = world->observe<LightComponent>(ComponentEvent::MODIFIED, [this](LightComponent*){
+            lightsChanged = true;
+        });
+    }
+
+    void ForwardRenderer::updateLightEffects(){
+        // A light effect depends on the light's data and on the transform of its owner.
+        // A light whose drawn matrix is blended moves a little every frame even if the simulation didn't move it,
+        // so the effects are rebuilt while any light is blended and once more after that (to drop the last blended position).
+        if(!lightsChanged){
+            lightsChanged = lightsBlended;
+            for(size_t index = 0; index < lights.size() && !lightsChanged; ++index){
+                const Entity* owner = lights[index]->getOwner();
+                lightsChanged = owner->getLocalToWorldVersion() != lightVersions[index] || owner->isInterpolated();
+            }
+            if(!lightsChanged) return;
+        }
+        lightEffects.clear();
+        lightVersions.clear();
+        lightsBlended = false;
+        for(auto light : lights){
+            lightEffects.push_back(LightEffect(light));
+            lightVersions.push_back(light->getOwner()->getLocalToWorldVersion());
+            lightsBlended = lightsBlended || light->getOwner()->isInterpolated();
+        }
+        lightsChanged = false;
+    }
+
+    void ForwardRenderer::drawOccluders(World* world, CameraComponent* camera, const glm::mat4& VP, const Frustum& frustum, JobSystem* jobs){
+        // The occluders are ranked by their size on the screen (the radius of their sphere over its distance from the camera)
+        glm::vec3 cameraPosition = camera->getOwner()->getInterpolatedLocalToWorldMatrix()[3];
+        occluders.clear();
+        for(auto occluder : world->getComponents<OccluderComponent>()){
+            Mesh* mesh = occluder->getOccluderMesh();
+            if(!mesh) continue;
+            BoundingSphere sphere = mesh->getBoundingSphere().transformed(occluder->getOwner()->getInterpolatedLocalToWorldMatrix());
+            if(!frustum.intersects(sphere)) continue;
+            float distance = std::max(glm::distance(sphere.center, cameraPosition), 1e-3f);
+            occluders.emplace_back(sphere.radius / distance, occluder);
+        }
+        if(occluders.size() > maxOccluders){
+            std::nth_element(occluders.begin(), occluders.begin() + maxOccluders, occluders.end(), [](const auto& first, const auto& second){
+                return first.first > second.first;
+            });
+            occluders.resize(maxOccluders);
+        }
+        occlusionBuffer.begin(VP);
+        for(auto& [size, occluder] : occluders){
+            Mesh* mesh = occluder->getOccluderMesh();
+            occlusionBuffer.addOccluder(occluder->getOwner()->getInterpolatedLocalToWorldMatrix(), mesh->getPositions(), mesh->getTriangles());
+        }
+        occlusionBuffer.rasterize(jobs);
     }
 
-    void ForwardRenderer::render(World* world){
+    void ForwardRenderer::render(World* world, JobSystem* jobs){
         // First of all, we search for a camera and for all the mesh renderers
         CameraComponent* camera = nullptr;
         opaqueCommands.clear();
         transparentCommands.clear();
-        lightEffects.clear();
-        for(auto entity : world->getEntities()){
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if(!camera) camera = entity->getComponent<CameraComponent>();
-            //Task4
-            // If this entity has a light component
-            if(auto light = entity->getComponent<LightComponent>(); light) lightEffects.push_back(LightEffect(light));
-            // If this entity has a mesh renderer component
-            if(auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer){
+        // Each component type is stored contiguously in the world, so we walk each storage instead of probing every entity
+        // We pick the first camera we find
+        for(auto candidate : world->getComponents<CameraComponent>()){
+            camera = candidate;
+            break;
+        }
+        //Task4
+        // We collect the effect of every light component (only if a light changed since the last frame)
+        if(world != observedWorld) observeLights(world);
+        updateLightEffects();
+
+        // If there is no camera, we return (we cannot render without a camera)
+        if(camera == nullptr){
+            stats = RenderStats();
+            return;
+        }
+
+        //DONE: (Req 9) Get the camera ViewProjection matrix and store it in VP
+        const glm::mat4 projection = camera->getProjectionMatrix(windowSize);
+        const glm::mat4 VP = projection * camera->getViewMatrix();
+
+        // For every mesh renderer component whose owner may be in the camera frustum
+        // The frustum is tested against the world's bounding volume hierarchy, so the groups of entities outside the view are skipped at once.
+        // The hierarchy holds the simulated bounds, which are at most one fixed update of movement away from the drawn ones.
+        const Frustum frustum = Frustum::fromMatrix(VP);
+        candidateCommands.clear();
+        for(auto* array : {&sphereX, &sphereY, &sphereZ, &sphereRadius})
+            array->clear();
+        world->getBVH().queryFrustumNodes(frustum, [this](Entity* entity){
+            entity->forEachComponent<MeshRendererComponent>([this](MeshRendererComponent* meshRenderer){
                 // We construct a command from it
                 RenderCommand command;
-                command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
+                command.localToWorld = meshRenderer->getOwner()->getInterpolatedLocalToWorldMatrix();
                 command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
                 command.mesh = meshRenderer->mesh;
                 command.material = meshRenderer->material;
-                // if it is transparent, we add it to the transparent commands list
-                if(command.material->transparent){
-                    transparentCommands.push_back(command);
-                } else {
-                // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
+                candidateCommands.push_back(command);
+                // and we store the sphere of its mesh in world space for the culling test
+                BoundingSphere sphere = command.mesh->getBoundingSphere().transformed(command.localToWorld);
+                sphereX.push_back(sphere.center.x);
+                sphereY.push_back(sphere.center.y);
+                sphereZ.push_back(sphere.center.z);
+                sphereRadius.push_back(sphere.radius);
+            });
+        });
+        // The arrays are padded to a full batch (the masks of the padding are ignored)
+        size_t padded = (candidateCommands.size() + Frustum::SPHERE_BATCH - 1) / Frustum::SPHERE_BATCH * Frustum::SPHERE_BATCH;
+        for(auto* array : {&sphereX, &sphereY, &sphereZ, &sphereRadius})
+            array->resize(padded, 0.0f);
+        visibleMasks.resize(padded / Frustum::SPHERE_BATCH);
+        frustum.cullSpheres(sphereX.data(), sphereY.data(), sphereZ.data(), sphereRadius.data(), padded, visibleMasks.data());
+        // The commands in the frustum are then tested against the occluders (if the occlusion culling is enabled)
+        stats.occluded = 0;
+        stats.occluders = 0;
+        if(occlusionEnabled){
+            drawOccluders(world, camera, VP, frustum, jobs);
+            stats.occluders = occluders.size();
+        }
+        // A unit of the world at a distance "d" in front of the camera covers "pixelsPerUnit / d" pixels of the screen's height
+        // (and "pixelsPerUnit" pixels whatever the distance for an orthographic camera)
+        const float pixelsPerUnit = projection[1][1] * windowSize.y * 0.5f;
+        const bool perspective = camera->cameraType == CameraType::PERSPECTIVE;
+        const glm::vec3 cameraPosition = camera->getOwner()->getInterpolatedLocalToWorldMatrix()[3];
+        stats.simplified = 0;
+        for(size_t index = 0; index < candidateCommands.size(); ++index){
+            if(!((visibleMasks[index / Frustum::SPHERE_BATCH] >> (index % Frustum::SPHERE_BATCH)) & 1)) continue;
+            RenderCommand& command = candidateCommands[index];
+            if(occlusionEnabled && !occlusionBuffer.isVisible(command.mesh->getBounds().transformed(command.localToWorld))){
+                stats.occluded++;
+                continue;
+            }
+            // We pick the simplest level of detail whose error stays under "lodBias" pixels, measured at the nearest point of the mesh's sphere
+            if(lodBias > 0.0f && command.mesh->getLODCount() > 1){
+                const glm::mat4& M = command.localToWorld;
+                float scale = std::max(std::max(glm::length(glm::vec3(M[0])), glm::length(glm::vec3(M[1]))), glm::length(glm::vec3(M[2])));
+                float distance = 1.0f;
+                if(perspective){
+                    glm::vec3 center(sphereX[index], sphereY[index], sphereZ[index]);
+                    distance = std::max(glm::distance(center, cameraPosition) - sphereRadius[index], camera->near);
                 }
+                command.lod = command.mesh->selectLOD(lodBias * distance / (pixelsPerUnit * scale));
+                if(command.lod > 0) stats.simplified++;
+            }
+            // if it is transparent, we add it to the transparent commands list
+            if(command.material->transparent){
+                transparentCommands.push_back(command);
+            } else {
+            // Otherwise, we add it to the opaque command list
+                opaqueCommands.push_back(command);
             }
         }
-
-        // If there is no camera, we return (we cannot render without a camera)
-        if(camera == nullptr) return;
+        stats.meshRenderers = world->getComponents<MeshRendererComponent>().size();
+        stats.tested = candidateCommands.size();
+        stats.visible = opaqueCommands.size() + transparentCommands.size();
+        stats.culled = stats.meshRenderers - stats.visible;
 
         //DONE: (Req 9) Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
         // HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
-        glm::vec3 cameraForward = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0.0, 0.0, -1.0f, 0);
+        glm::vec3 cameraForward = camera->getOwner()->getInterpolatedLocalToWorldMatrix() * glm::vec4(0.0, 0.0, -1.0f, 0);
         std::sort(transparentCommands.begin(), transparentCommands.end(), [&cameraForward](const RenderCommand& first, const RenderCommand& second){
             //DONE: (Req 9) Finish this function
             // HINT: the following return should return true "first" should be drawn before "second". 
             return glm::dot(cameraForward, first.center) > glm::dot(cameraForward, second.center);
         });
 
-        //DONE: (Req 9) Get the camera ViewProjection matrix and store it in VP
-        const glm::mat4 VP = camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
-        
         //DONE: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
         glViewport(0, 0, windowSize.x, windowSize.y);
         
@@ -178,7 +329,7 @@ namespace our {
         
 
         //DONE: (Req 10) Get the camera position
-        glm::vec3 cameraPos = camera->getOwner()->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
+        glm::vec3 cameraPos = camera->getOwner()->getInterpolatedLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
 
         //DONE: (Req 9) Draw all the opaque commands
         // Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
@@ -194,7 +345,7 @@ namespace our {
             command.material->shader->set("view_projection", VP);
             //Useful when computing the specular component
             command.material->shader->set("camera_position", cameraPos);
-            command.mesh->draw();
+            command.mesh->draw(command.lod);
         }
         
         // If there is a sky material, draw the sky
@@ -233,7 +384,7 @@ namespace our {
             command.material->shader->set("object_to_world_inv_transpose", glm::transpose(glm::inverse(command.localToWorld)));
             command.material->shader->set("view_projection", VP);
             command.material->shader->set("camera_position", cameraPos);
-            command.mesh->draw();
+            command.mesh->draw(command.lod);
         }
         
 
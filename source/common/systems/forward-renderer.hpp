@@ -4,7 +4,10 @@
 #include "../components/camera.hpp"
 #include "../components/light.hpp"
 #include "../components/mesh-renderer.hpp"
+#include "../components/occluder.hpp"
 #include "../asset-loader.hpp"
+#include "../spatial/frustum.hpp"
+#include "../spatial/occlusion-buffer.hpp"
 
 #include <glad/gl.h>
 #include <vector>
@@ -21,6 +24,7 @@ namespace our
         glm::vec3 center;
         Mesh* mesh;
         Material* material;
+        size_t lod = 0; // The level of detail of the mesh that is drawn (see "Mesh::selectLOD")
     };
     //Task4
     struct LightEffect {
@@ -60,6 +64,17 @@ namespace our
         }
     };
 
+    // The number of mesh renderers that the last frame drew or culled
+    struct RenderStats {
+        size_t meshRenderers = 0; // The number of mesh renderers in the world
+        size_t tested = 0; // The number of mesh renderers whose bounding sphere was tested against the frustum (the others were skipped by the BVH)
+        size_t visible = 0; // The number of mesh renderers that were drawn
+        size_t culled = 0; // The number of mesh renderers that were not drawn (because they are outside the frustum or hidden)
+        size_t occluded = 0; // The number of mesh renderers in the frustum that were not drawn because they are hidden behind the occluders
+        size_t occluders = 0; // The number of occluders drawn into the occlusion buffer
+        size_t simplified = 0; // The number of mesh renderers that were drawn with a simplified level of detail
+    };
+
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
@@ -71,8 +86,38 @@ namespace our
         // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
         std::vector<RenderCommand> opaqueCommands;
         std::vector<RenderCommand> transparentCommands;
+        // The commands that may be visible and the world space bounding spheres of their meshes as a structure of arrays.
+        // The spheres are tested against the frustum 8 at a time, then the visible commands are moved to the opaque or the transparent list.
+        std::vector<RenderCommand> candidateCommands;
+        std::vector<float> sphereX, sphereY, sphereZ, sphereRadius;
+        std::vector<std::uint8_t> visibleMasks;
+        RenderStats stats;
+        // The error (in pixels) that a simplified level of detail can show on the screen. It is read from "lodBias" in the renderer's config.
+        // A bigger bias switches to the simpler levels closer to the camera, and 0 (the default) always draws the full meshes.
+        float lodBias = 0.0f;
+        // The occlusion culling is enabled by an "occlusion" object in the renderer's config.
+        // Every frame, the biggest occluders on the screen (at most "maxOccluders") are drawn into the occlusion buffer,
+        // then the commands whose boxes are hidden by them are dropped.
+        bool occlusionEnabled = false;
+        size_t maxOccluders = 24;
+        OcclusionBuffer occlusionBuffer;
+        std::vector<std::pair<float, OccluderComponent*>> occluders; // The occluders in the frustum with their size on the screen
+        // Draws the biggest occluders of the world into the occlusion buffer
+        void drawOccluders(World* world, CameraComponent* camera, const glm::mat4& VP, const Frustum& frustum, JobSystem* jobs);
         //Task4
         std::vector<LightEffect> lightEffects;
+        // The light effects are only rebuilt if a light was added, removed or modified or if a light moved.
+        // The list of lights is kept up to date by observing the light events of the world, so we never search for the lights every frame.
+        World* observedWorld = nullptr;
+        World::ObserverID lightObservers[3] = {0, 0, 0};
+        std::vector<LightComponent*> lights; // The lights of the observed world
+        std::vector<std::uint32_t> lightVersions; // The local to world version of each light's owner when the effects were built
+        bool lightsChanged = true; // True if a light was added, removed or modified since the effects were built
+        bool lightsBlended = false; // True if the effects were built from the blended matrix of a light (see "Entity::isInterpolated")
+        // Starts observing the lights of the given world (and stops observing the previous one)
+        void observeLights(World* world);
+        // Rebuilds the light effects if any light changed
+        void updateLightEffects();
         // Objects used for rendering a skybox
         Mesh* skySphere;
         TexturedMaterial* skyMaterial;
@@ -88,8 +133,11 @@ namespace our
         // Clean up the renderer
         void destroy();
         // This function should be called every frame to draw the given world
-        void render(World* world);
+        // If a job system is given, the occlusion buffer is rasterized by its workers.
+        void render(World* world, JobSystem* jobs = nullptr);
         void requestPostProcessing();
+        // Returns the culling statistics of the last rendered frame
+        const RenderStats& getStats() const { return stats; }
 
 
     };
@@ -19,16 +19,13 @@ namespace our
 
         // This should be called every frame to update all entities containing a MovementComponent. 
         void update(World* world, float deltaTime) {
-            // For each entity in the world
-            for(auto entity : world->getEntities()){
-                // Get the movement component if it exists
-                MovementComponent* movement = entity->getComponent<MovementComponent>();
-                // If the movement component exists
-                if(movement){
-                    // Change the position and rotation based on the linear & angular velocity and delta time.
-                    entity->localTransform.position += deltaTime * movement->linearVelocity;
-                    entity->localTransform.rotation += deltaTime * movement->angularVelocity;
-                }
+            // For each movement component in the world (they are stored contiguously so we don't need to visit every entity)
+            for(auto movement : world->getComponents<MovementComponent>()){
+                // Get the entity that owns this movement component
+                Entity* entity = movement->getOwner();
+                // Change the position and rotation based on the linear & angular velocity and delta time.
+                entity->localTransform.position += deltaTime * movement->linearVelocity;
+                entity->localTransform.rotation += deltaTime * movement->angularVelocity;
             }
         }
 
@@ -8,6 +8,9 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtx/euler_angles.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace our
 {
     struct lock{
@@ -20,9 +23,27 @@ namespace our
     class PlayerMovementSystem {
     public:
         Application* app; // The application in which the state runs
-        Entity* player = nullptr;
-        std::unordered_map<Entity*, bool> collisions;
-        std::unordered_map<Entity*, lock> entityLocking;
+        EntityHandle playerEntity; // We keep a handle since the player could be deleted while we hold it
+        // The entities that the player can collide with (the floors and the lights are left out) when the world's spatial hash is queried
+        SpatialHash::Filter isObstacle = [this](const Entity* entity){
+            NameID name = entity->getNameID();
+            return name != floorName && name != lightName;
+        };
+        // The entities touching the player as of the last update. The collision maps are keyed by handles so that a deleted entity never matches a new one
+        std::vector<EntityHandle> contacts;
+        std::vector<EntityHandle> previousContacts;
+        std::unordered_map<EntityHandle, lock> entityLocking;
+        const WorldSnapshot* restartSnapshot = nullptr; // If given, the whole world is restored from this snapshot when the player restarts
+        // The names are interned once so that the per-frame checks compare integers instead of strings
+        const NameID playerName = internName("player");
+        const NameID floorName = internName("floor");
+        const NameID lightName = internName("light");
+        const NameID carName = internName("car");
+        const float collisionDistance = 1.3f; // The player collides with the entities whose centers are closer than this to its center
+        // The moves longer than this in one update are teleports (a car wrapping around the road or a restart), so they are not swept
+        const float maxSweepDistance = 4.0f;
+        glm::vec3 previousPlayerCenter; // The player's center at the last collision check
+        bool hasPreviousPlayerCenter = false;
         float facing = 180;
         const float deathAngular = 5;
         const float speed = 10;
@@ -42,27 +63,36 @@ namespace our
 
         // This should be called every frame to update all entities containing a FreeCameraControllerComponent 
         void update(World* world, float deltaTime) {
-            if (!player){
-                for(auto entity : world->getEntities()){
-                    if (!player && entity->name == "player") player = entity;
-                }
-            }
+            Entity* player = world->get(playerEntity);
+            if (!player) player = world->findByName(playerName);
 
             if(!player) return;
+            playerEntity = player->getHandle();
 
             //print win
             //restart game
-            if(!playing && app->getKeyboard().justPressed(GLFW_KEY_ENTER)){
-                player->localTransform.position = glm::vec3(0, 1, 5);
-                player->localTransform.rotation = glm::vec3(0, glm::pi<float>(), 0);
+            // This runs in the fixed updates, so the key press is compared with the last fixed update instead of the last frame
+            if(!playing && app->getKeyboard().justPressedSinceFixedUpdate(GLFW_KEY_ENTER)){
                 forward = true;
                 left = true;
                 right = true;
                 backward = true;
                 playing = true;
                 win = false;
-                collisions.clear();
+                contacts.clear();
                 entityLocking.clear();
+                hasPreviousPlayerCenter = false;
+                if(restartSnapshot){
+                    // The level (the player, the cars, the lights, ...) is put back exactly in its initial state.
+                    // The restore is recorded in the command buffer since this system could be running concurrently with others.
+                    // Since the player is still where it died till the end of the frame, we skip the collision checks of this frame.
+                    const WorldSnapshot* snapshot = restartSnapshot;
+                    world->getCommandBuffer().custom([snapshot](World* world){ world->restore(*snapshot); });
+                    return;
+                }
+                player->localTransform.position = glm::vec3(0, 1, 5);
+                player->localTransform.rotation = glm::vec3(0, glm::pi<float>(), 0);
+                player->skipInterpolation();
             }
             
             if (!playing){
@@ -81,19 +111,29 @@ namespace our
                 }
                 return;
             }
-            glm::vec3 playerCenter;
-            for(auto entity : world->getEntities()){
-                if (entity->name == "floor" || entity->name == "light" || entity == player) continue;
-                glm::vec3 entityCenter = entity->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-                if (entityCenter.y >= 3 || entityCenter.y <= -3) continue;
-                playerCenter = player->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
-                float distance = glm::distance(entityCenter, playerCenter);
-                if (distance < 1.3){
-                    onCollisionEnter(entity, entityCenter, playerCenter);       
-                }else if (collisions.find(entity) != collisions.end() && collisions[entity]){
-                    onCollisionExit(entity, entityCenter, playerCenter);
-                }
-            }
+            // Only the entities in the cells of the world's spatial hash around the player are tested, then the contacts are compared
+            // with the ones of the last update to generate the enter and exit events. The contacts are few, so the lists are searched linearly.
+            // The player and the entities are swept from where they were at the last update to where they are now,
+            // so a fast car (or a long step) can't jump over the player between two updates.
+            glm::vec3 playerCenter = player->getLocalToWorldMatrix() * glm::vec4(0, 0, 0, 1);
+            glm::vec3 playerStart = playerCenter;
+            if(hasPreviousPlayerCenter && glm::distance(previousPlayerCenter, playerCenter) <= maxSweepDistance) playerStart = previousPlayerCenter;
+            previousPlayerCenter = playerCenter;
+            hasPreviousPlayerCenter = true;
+            std::swap(contacts, previousContacts);
+            contacts.clear();
+            world->getSpatialHash().querySwept(playerStart, playerCenter, collisionDistance, maxSweepDistance,
+                [&](Entity* entity, const glm::vec3& entityStart, const glm::vec3& entityCenter, float time){
+                if (entity == player || entityCenter.y >= 3 || entityCenter.y <= -3) return;
+                contacts.push_back(entity->getHandle());
+                // The direction of the collision is taken at the moment they touched, not where they ended up
+                if (std::find(previousContacts.begin(), previousContacts.end(), entity->getHandle()) == previousContacts.end())
+                    onCollisionEnter(entity, glm::mix(entityStart, entityCenter, time), glm::mix(playerStart, playerCenter, time));
+            }, isObstacle);
+            for (EntityHandle handle : previousContacts)
+                if (std::find(contacts.begin(), contacts.end(), handle) == contacts.end())
+                    onCollisionExit(handle);
+            updateLocks();
 
             if(app->getKeyboard().isPressed(GLFW_KEY_W) && forward) facing = glm::pi<float>();
             else if(app->getKeyboard().isPressed(GLFW_KEY_S) && backward) facing = 0.0f;
@@ -110,35 +150,45 @@ namespace our
         void onCollisionEnter(Entity* entity, glm::vec3 entityCenter, glm::vec3 playerCenter){
             glm::vec3 dir = entityCenter - playerCenter;
             const float eps = 1e-3f;
-            if (dir.x > eps){ right = false; entityLocking[entity].right = true;}
-            else if (dir.x < -eps){ left = false; entityLocking[entity].left = true;}
-            if (dir.z > eps){ backward = false; entityLocking[entity].backward = true;}
-            else if (dir.z < -eps){ forward = false; entityLocking[entity].forward = true;}
-            if (entity->name == "car"){
+            lock& locking = entityLocking[entity->getHandle()];
+            if (dir.x > eps) locking.right = true;
+            else if (dir.x < -eps) locking.left = true;
+            if (dir.z > eps) locking.backward = true;
+            else if (dir.z < -eps) locking.forward = true;
+            if (entity->getNameID() == carName){
                 playing = false;
             }
-            collisions[entity] = true;
         }
 
-        void onCollisionExit(Entity* entity, glm::vec3 entityCenter, glm::vec3 playerCenter){
-            right ^= entityLocking[entity].right;
-            left ^= entityLocking[entity].left;
-            backward ^= entityLocking[entity].backward;
-            forward ^= entityLocking[entity].forward;
-            entityLocking[entity] = {0, 0, 0, 0};
-            collisions[entity] = false;
-        } 
+        // This is called with a handle since the entity could have been deleted while it touched the player
+        void onCollisionExit(EntityHandle entity){
+            entityLocking.erase(entity);
+        }
+
+        // A direction stays blocked as long as any entity touching the player blocks it (e.g. two fences on the right),
+        // so the directions are worked out again from all the current contacts after the enter and exit events
+        void updateLocks(){
+            forward = left = right = backward = true;
+            for (const auto& [handle, locking] : entityLocking){
+                if (locking.right) right = false;
+                if (locking.left) left = false;
+                if (locking.backward) backward = false;
+                if (locking.forward) forward = false;
+            }
+        }
 
         void exit(){
-            player = nullptr;
+            playerEntity = EntityHandle();
             forward = true;
             left = true;
             right = true;
             backward = true;
             playing = true;
             win = false;
-            collisions.clear();
+            contacts.clear();
+            previousContacts.clear();
             entityLocking.clear();
+            hasPreviousPlayerCenter = false;
         }
     };
 
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace our
+{
+
+    // The system scheduler runs the update functions of the registered systems every frame.
+    // Each system declares which component types it reads and which it writes. Two systems conflict if one of them writes
+    // a type that the other reads or writes, and conflicting systems always run in the order they were registered.
+    // Systems that don't conflict (directly or through the systems between them) run concurrently as jobs on the job system.
+    // If every system depends on the one registered before it, no two systems can ever overlap, so they are run directly
+    // on the calling thread instead of paying for a job (and a wake up of a worker) per system.
+    // Since the local transform is stored in the entity instead of a component, "Transform" can be used as an access type too,
+    // and a system that only moves some entities declares them as a group (see "Access::writeTransforms").
+    // Reading a transform includes "Entity::getLocalToWorldMatrix", which only reads the matrix cached by the last "World::updateTransforms"
+    // unless the cache is invalid. The systems are only run concurrently if every cache is valid (see "World::areTransformsUpToDate"),
+    // so two systems that read the same transform never compute its matrix at once and "read<Transform>()" doesn't conflict with itself.
+    // WARNING: A system running on a worker thread must not add or delete entities or components directly,
+    // it should record them in the world's command buffer instead (see "World::getCommandBuffer").
+    class SystemScheduler {
+    public:
+        // The component types that a system reads and writes
+        struct Access {
+            ComponentMask reads;
+            ComponentMask writes;
+            // The groups of entities whose transforms the system reads and writes (see "readTransforms" and "writeTransforms").
+            // A group is either the owners of a component type (its type ID) or the entities with a name ("NAME_GROUP" | the name's ID).
+            std::vector<std::uint64_t> transformReads;
+            std::vector<std::uint64_t> transformWrites;
+            static constexpr std::uint64_t NAME_GROUP = std::uint64_t(1) << 32;
+
+            // Adds the types "Types..." to the read set
+            template<typename... Types>
+            Access& read() { reads |= makeComponentMask<Types...>(); return *this; }
+            // Adds the types "Types..." to the write set (writing implies reading)
+            template<typename... Types>
+            Access& write() { writes |= makeComponentMask<Types...>(); return *this; }
+
+            // "read<Transform>()" and "write<Transform>()" cover the transforms of every entity. A system that only touches some entities
+            // should name them instead, so that it can run next to the systems that touch other entities:
+            // the transforms of the entities that own a component of type T (e.g. "writeTransforms<CameraComponent>()")
+            // or the transforms of the entities with a given name (e.g. "writeTransforms(internName("car"))").
+            // Different groups are assumed to hold different entities, so an entity in two groups must be declared with the same group
+            // by every system that touches it.
+            template<typename T>
+            Access& readTransforms() { transformReads.push_back(getComponentTypeID<T>()); return *this; }
+            Access& readTransforms(NameID name) { transformReads.push_back(NAME_GROUP | name); return *this; }
+            template<typename T>
+            Access& writeTransforms() { transformWrites.push_back(getComponentTypeID<T>()); return *this; }
+            Access& writeTransforms(NameID name) { transformWrites.push_back(NAME_GROUP | name); return *this; }
+
+            // Returns true if running the two systems concurrently could cause a data race
+            bool conflictsWith(const Access& other) const {
+                if((writes & (other.reads | other.writes)).any() || (other.writes & reads).any()) return true;
+                // An access to every transform conflicts with the groups that the other system writes (or touches if it writes them all)
+                ComponentTypeID transform = getComponentTypeID<Transform>();
+                if(writes.test(transform) && other.touchesTransforms()) return true;
+                if(other.writes.test(transform) && touchesTransforms()) return true;
+                if(reads.test(transform) && !other.transformWrites.empty()) return true;
+                if(other.reads.test(transform) && !transformWrites.empty()) return true;
+                return shares(transformWrites, other.transformReads) || shares(transformWrites, other.transformWrites)
+                    || shares(transformReads, other.transformWrites);
+            }
+
+        private:
+            bool touchesTransforms() const { return !transformReads.empty() || !transformWrites.empty(); }
+            // The lists are a few elements long, so they are compared pair by pair
+            static bool shares(const std::vector<std::uint64_t>& first, const std::vector<std::uint64_t>& second){
+                for(std::uint64_t group : first)
+                    if(std::find(second.begin(), second.end(), group) != second.end()) return true;
+                return false;
+            }
+        };
+
+        typedef std::function<void(World*, float)> UpdateFunction;
+        typedef std::function<bool()> Condition;
+
+    private:
+        struct System {
+            std::string name; // The name of the system (useful for debugging)
+            Access access; // The component types the system reads and writes
+            UpdateFunction update; // The function that updates the system
+            Condition condition; // If given, the system is skipped in frames where it returns false (it is checked after the dependencies ran)
+            std::vector<size_t> dependencies; // The indices of the systems that must finish before this one starts
+            std::vector<size_t> dependents; // The indices of the systems that wait for this one
+        };
+
+        // The state of a frame that is being run
+        struct Frame {
+            World* world;
+            float deltaTime;
+            JobSystem* jobs;
+            JobCounter counter; // Counts the systems that were started and are not done yet
+            std::unique_ptr<std::atomic<size_t>[]> remaining; // For each system, the number of its dependencies that are not done yet
+        };
+
+        std::vector<System> systems; // The systems in the order they were registered
+        bool warmedUp = false; // False till the first frame is run
+        bool chain = true; // True if each system depends on the previous one (so the systems can only run one after the other)
+
+        // Schedules the system as a job. When it is done, the dependents whose dependencies are all done are scheduled in turn.
+        void launch(size_t index, Frame& frame){
+            frame.jobs->schedule([this, index, &frame](){
+                System& system = systems[index];
+                if(!system.condition || system.condition()) system.update(frame.world, frame.deltaTime);
+                for(size_t dependent : system.dependents)
+                    if(frame.remaining[dependent].fetch_sub(1) == 1) launch(dependent, frame);
+            }, &frame.counter);
+        }
+
+    public:
+        // Registers a system and returns its index.
+        // "after" lists the systems that must run before this one even if their declared access doesn't conflict
+        // (e.g. if this system reads a flag set by them outside of the ECS).
+        size_t add(std::string name, Access access, UpdateFunction update, Condition condition = nullptr, std::vector<size_t> after = {}){
+            System system{std::move(name), access, std::move(update), std::move(condition), std::move(after), {}};
+            // Since the systems are registered in order, every dependency points to an earlier system, so the graph can't have cycles
+            for(size_t index = 0; index < systems.size(); ++index)
+                if(systems[index].access.conflictsWith(system.access)) system.dependencies.push_back(index);
+            // We remove the duplicates in case a system was given in "after" and also conflicts with this one
+            std::sort(system.dependencies.begin(), system.dependencies.end());
+            system.dependencies.erase(std::unique(system.dependencies.begin(), system.dependencies.end()), system.dependencies.end());
+            for(size_t dependency : system.dependencies)
+                systems[dependency].dependents.push_back(systems.size());
+            // The dependencies are sorted, so the last one is the previous system if this system depends on it
+            if(!systems.empty() && (system.dependencies.empty() || system.dependencies.back() != systems.size() - 1)) chain = false;
+            systems.push_back(std::move(system));
+            return systems.size() - 1;
+        }
+
+        // Runs all the systems for one frame on the given job system and returns when they are all done.
+        // The calling thread runs systems too while it waits.
+        void run(World* world, float deltaTime, JobSystem& jobs){
+            // The first frame is run sequentially so that the storages, views and lookups that the systems create lazily
+            // are created on one thread, then the following frames only read them concurrently.
+            // A chain of systems is always run sequentially since none of them could run next to another one.
+            // If some entities were created or reparented since the last transform update, their matrices would be computed
+            // by the first system that reads them, so the systems are run sequentially too.
+            if(!warmedUp || chain || !world->areTransformsUpToDate()){
+                for(auto& system : systems)
+                    if(!system.condition || system.condition()) system.update(world, deltaTime);
+                warmedUp = true;
+                return;
+            }
+            // We start the systems that have no dependencies, and each finished system starts the dependents that became ready
+            Frame frame{world, deltaTime, &jobs, {}, std::make_unique<std::atomic<size_t>[]>(systems.size())};
+            for(size_t index = 0; index < systems.size(); ++index)
+                frame.remaining[index] = systems[index].dependencies.size();
+            for(size_t index = 0; index < systems.size(); ++index)
+                if(systems[index].dependencies.empty()) launch(index, frame);
+            jobs.wait(frame.counter);
+        }
+
+        // Removes all the registered systems
+        void clear(){
+            systems.clear();
+            warmedUp = false;
+            chain = true;
+        }
+    };
+
+}
@@ -16,11 +16,12 @@ namespace our
 {
     class WinSystem {
         Application* app;
-        CameraComponent* camera = nullptr;
-        LightComponent* pointLight = nullptr;
-        Entity* player = nullptr;
-        Entity* winBarrier = nullptr;
-        Entity* winParent = nullptr;
+        // We keep handles instead of pointers since the entities could be deleted while we hold them
+        EntityHandle cameraEntity;
+        EntityHandle pointLightEntity;
+        EntityHandle playerEntity;
+        EntityHandle winBarrierEntity;
+        EntityHandle winParentEntity;
         const float winObjectSpeed = 1.0f;
         const float cameraAngular = 0.3f;
         const float lightDecay = 0.7f;
@@ -31,35 +32,61 @@ namespace our
         const glm::vec3 diffuse = glm::vec3(1, 0, 0);
         const glm::vec3 ambient = glm::vec3(1, 1, 1);
         float accum = 1.0f;
-        std::vector<LightComponent*> directionLights;
+        std::vector<EntityHandle> directionLights;
+        Tick lightsTick = 0; // The light structure tick of the world when the lights were last searched for
+        Tick camerasTick = 0; // The camera structure tick of the world when the camera was last searched for
+        // The names are interned once so that the lookups don't hash strings every frame
+        const NameID playerName = internName("player");
+        const NameID winBarrierName = internName("win-barrier");
+        const NameID winParentName = internName("win-parent");
     public:
         void enter(Application* app){
             this->app = app;
         }
 
         void update(World* world, float deltaTime) {
-            if (!(camera && player && winBarrier && winParent)){
-                for(auto entity : world->getEntities()){
-                    if (!player && entity->name == "player") player = entity;
-                    if (!camera) camera = entity->getComponent<CameraComponent>();
-                    if (entity->name == "win-barrier") winBarrier = entity;
-                    if (entity->name == "win-parent") winParent = entity;
-                    LightComponent* tempLight = entity->getComponent<LightComponent>();
-                    if (!pointLight && tempLight && tempLight->lightType == LightType::POINT) pointLight = tempLight;
-                    if (tempLight && tempLight->lightType == LightType::DIRECTIONAL) directionLights.push_back(tempLight);
+            // The handles return null if the entities were deleted, in which case we search for them again
+            Entity* player = world->get(playerEntity);
+            Entity* winBarrier = world->get(winBarrierEntity);
+            Entity* winParent = world->get(winParentEntity);
+            LightComponent* pointLight = nullptr;
+            if (Entity* entity = world->get(pointLightEntity); entity) pointLight = entity->getComponent<LightComponent>();
+            if (!player) player = world->findByName(playerName);
+            if (!winBarrier) winBarrier = world->findByName(winBarrierName);
+            if (!winParent) winParent = world->findByName(winParentName);
+            // The storages are only searched again if a component of their type was added or removed since the last search
+            // We use the first camera in the camera storage
+            CameraComponent* camera = world->findFirst<CameraComponent>(cameraEntity, camerasTick);
+            if (world->hasStructureChanged<LightComponent>(lightsTick)){
+                // The lights are found by walking the light storage instead of all the entities
+                pointLight = nullptr;
+                directionLights.clear();
+                for(auto light : world->getComponents<LightComponent>()){
+                    if (!pointLight && light->lightType == LightType::POINT) pointLight = light;
+                    if (light->lightType == LightType::DIRECTIONAL) directionLights.push_back(light->getOwner()->getHandle());
                 }
             }
 
+            // The handle is kept as soon as the light is found since the storage is not searched again till its structure changes
+            if (pointLight) pointLightEntity = pointLight->getOwner()->getHandle();
             if(!(camera && player && winBarrier && winParent)) return;
+            playerEntity = player->getHandle();
+            winBarrierEntity = winBarrier->getHandle();
+            winParentEntity = winParent->getHandle();
 
             if (accum > lightThreshold){
-                for (auto &light: directionLights){
+                for (auto &handle: directionLights){
+                    Entity* entity = world->get(handle);
+                    if (!entity) continue;
+                    LightComponent* light = entity->getComponent<LightComponent>();
+                    if (!light) continue;
                     const float factor = glm::pow(lightDecay, deltaTime);
                     accum *= factor;
                     glm::vec3 vecFactor = glm::vec3(factor);
                     light->diffuse *= vecFactor;
                     light->specular *= vecFactor;
                     light->ambient *= vecFactor;
+                    light->markChanged(); // So that the renderer knows that it has to update the light
                 }
             }
 
@@ -69,6 +96,7 @@ namespace our
                 pointLight->diffuse = interpolation * diffuse;
                 pointLight->specular = interpolation * specular;
                 pointLight->diffuse = interpolation * diffuse;
+                pointLight->markChanged();
             }
 
             winBarrier->localTransform.position.y = 0;
@@ -86,12 +114,14 @@ namespace our
         void exit(){
             timeAccum = 0;
             accum = 1;
-            pointLight = nullptr;
-            camera = nullptr;
-            player = nullptr;
-            winBarrier = nullptr;
-            winParent = nullptr;
+            pointLightEntity = EntityHandle();
+            cameraEntity = EntityHandle();
+            playerEntity = EntityHandle();
+            winBarrierEntity = EntityHandle();
+            winParentEntity = EntityHandle();
             directionLights.clear();
+            lightsTick = 0;
+            camerasTick = 0;
         }
     };
 }
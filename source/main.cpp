@@ -4,6 +4,7 @@
 #include <json/json.hpp>
 
 #include <application.hpp>
+#include <json-stream.hpp>
 
 #include "states/menu-state.hpp"
 #include "states/play-state.hpp"
@@ -35,11 +36,13 @@ int main(int argc, char** argv) {
         return -1;
     }
     // Read the file into a json object then close the file
-    nlohmann::json app_config = nlohmann::json::parse(file_in, nullptr, true, true);
+    // The assets and the entities of the scene are left out (they become null) since they are only needed while a state loads the scene
+    // and they are most of the file for big levels. The states stream them from the config file instead (see "loadAllAssets" and "loadWorld").
+    nlohmann::json app_config = our::parseJsonStreaming(file_in, {{"/scene/assets", nullptr}, {"/scene/world", nullptr}});
     file_in.close();
 
     // Create the application
-    our::Application app(app_config);
+    our::Application app(app_config, config_path);
     
     // Register all the states of the project in the application
     app.registerState<Menustate>("menu");
@@ -2,6 +2,7 @@
 
 #include <asset-loader.hpp>
 #include <ecs/world.hpp>
+#include <ecs/cooked-scene.hpp>
 #include <components/camera.hpp>
 #include <components/mesh-renderer.hpp>
 #include <application.hpp>
@@ -9,9 +10,8 @@
 // This is a helper function that will search for a component and will return the first one found
 template<typename T>
 T* find(our::World *world){
-    for(auto& entity : world->getEntities()){
-        T* component = entity->getComponent<T>();
-        if(component) return component;
+    for(T* component : world->getComponents<T>()){
+        return component;
     }
     return nullptr;
 }
@@ -25,13 +25,18 @@ class EntityTestState: public our::State {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // (they are streamed from the config file since they are left out of the app config, see "main.cpp")
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::loadAllAssets(config["assets"], getApp()->getConfigPath());
         }
 
+        // The prefabs are built before the world since its entities can be instances of them
+        if(config.contains("prefabs")){
+            world.deserializePrefabs(config["prefabs"]);
+        }
         // If we have a world in the scene config, we use it to populate our world
         if(config.contains("world")){
-            world.deserialize(config["world"]);
+            our::loadWorld(world, config["world"], getApp()->getConfigPath());
         }
         
     }
@@ -47,10 +52,9 @@ class EntityTestState: public our::State {
         //DONE: (Req 8) Change the following line to compute the correct view projection matrix 
         glm::mat4 VP = camera->getProjectionMatrix(size) * camera->getViewMatrix();
 
-        for(auto& entity : world.getEntities()){
-            // For each entity, we look for a mesh renderer (if none was found, we skip this entity)
-            our::MeshRendererComponent* meshRenderer = entity->getComponent<our::MeshRendererComponent>();
-            if(meshRenderer == nullptr) continue;
+        for(auto meshRenderer : world.getComponents<our::MeshRendererComponent>()){
+            // For each mesh renderer, we get the entity that owns it
+            our::Entity* entity = meshRenderer->getOwner();
             //DONE: (Req 8) Complete the loop body to draw the current entity
             // Then we setup the material, send the transform matrix to the shader then draw the mesh
 
@@ -62,6 +66,7 @@ class EntityTestState: public our::State {
 
     void onDestroy() override {
         world.clear();
+        world.clearPrefabs();
         our::clearAllAssets();
     }
 };
\ No newline at end of file
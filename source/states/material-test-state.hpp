@@ -21,8 +21,9 @@ class MaterialTestState: public our::State {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // (they are streamed from the config file since they are left out of the app config, see "main.cpp")
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::loadAllAssets(config["assets"], getApp()->getConfigPath());
         }
         // We get the mesh and the material from AssetLoader 
         mesh = our::AssetLoader<our::Mesh>::get("mesh");
@@ -3,6 +3,7 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
+#include <ecs/cooked-scene.hpp>
 #include <systems/forward-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/camera-lock.hpp>
@@ -10,36 +11,68 @@
 #include <systems/car-movement.hpp>
 #include <systems/win.hpp>
 #include <systems/movement.hpp>
+#include <systems/system-scheduler.hpp>
 #include <asset-loader.hpp>
 
 // This state shows how to use the ECS framework and deserialization.
 class Playstate: public our::State {
 
     our::World world;
+    our::WorldSnapshot initialState; // The state of the world right after it was loaded (it is restored when the player restarts)
     our::ForwardRenderer renderer;
     our::MovementSystem movement;
     our::CameraLockSystem cameraLock;
     our::PlayerMovementSystem playerMovementSystem;
     our::CarMovementSystem carMovementSystem;
     our::WinSystem winSystem;
+    our::SystemScheduler scheduler;
 
     void onInitialize(std::string msg) override {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // (they are streamed from the config file since they are left out of the app config, see "main.cpp")
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::loadAllAssets(config["assets"], getApp()->getConfigPath());
+        }
+        // The prefabs are built before the world since its entities can be instances of them
+        if(config.contains("prefabs")){
+            world.deserializePrefabs(config["prefabs"]);
         }
         // If we have a world in the scene config, we use it to populate our world
+        // The world is loaded from the cooked copy of the config if it is up to date, otherwise it is streamed from the config file and cooked
         if(config.contains("world")){
-            world.deserialize(config["world"]);
+            our::loadWorld(world, config["world"], getApp()->getConfigPath());
         }
+        // We save the loaded world so that restarting the level is a copy instead of a reload
+        world.snapshot(initialState);
         // We initialize the camera controller system since it needs a pointer to the app
         cameraLock.enter(getApp());
         playerMovementSystem.enter(getApp());
+        playerMovementSystem.restartSnapshot = &initialState;
         carMovementSystem.enter(getApp());
         winSystem.enter(getApp());
 
+        // We register the systems with the components they read and write so that the scheduler can run the independent ones concurrently.
+        // Each system only moves some entities, so it declares them instead of every transform: the player movement and the car movement
+        // run next to the movement system, and the camera lock runs next to the car movement once the player moved.
+        using Access = our::SystemScheduler::Access;
+        const our::NameID playerName = our::internName("player");
+        size_t player = scheduler.add("player-movement", Access().writeTransforms(playerName),
+            [this](our::World* world, float deltaTime){ playerMovementSystem.update(world, deltaTime); });
+        // The car movement and the win systems depend on the "win" flag set by the player movement system
+        scheduler.add("car-movement", Access().readTransforms(playerName).writeTransforms(our::internName("car")),
+            [this](our::World* world, float deltaTime){ carMovementSystem.update(world, deltaTime); },
+            [this](){ return !playerMovementSystem.win; }, {player});
+        scheduler.add("camera-lock", Access().read<our::CameraComponent>().readTransforms(playerName).writeTransforms<our::CameraComponent>(),
+            [this](our::World* world, float deltaTime){ cameraLock.update(world, deltaTime); });
+        scheduler.add("movement", Access().read<our::MovementComponent>().writeTransforms<our::MovementComponent>(),
+            [this](our::World* world, float deltaTime){ movement.update(world, deltaTime); });
+        scheduler.add("win", Access().read<our::CameraComponent>().write<our::LightComponent>().writeTransforms<our::CameraComponent>()
+                .writeTransforms(our::internName("win-barrier")).writeTransforms(our::internName("win-parent")),
+            [this](our::World* world, float deltaTime){ winSystem.update(world, deltaTime); },
+            [this](){ return playerMovementSystem.win; }, {player});
+
         // Then we initialize the renderer
         auto size = getApp()->getFrameBufferSize();
         renderer.initialize(size, config["renderer"]);
@@ -48,19 +81,26 @@ class Playstate: public our::State {
         }
     }
 
-    void onDraw(double deltaTime) override {
+    void onFixedUpdate(double fixedDeltaTime) override {
+        // A new step starts, so the changes made from now on get a new tick
+        world.advanceTick();
+        // The world matrices are saved so that the frames drawn before the next step can blend them with the new ones
+        world.beginFixedStep();
         // Here, we just run a bunch of systems to control the world logic
-        //movementSystem.update(&world, (float)deltaTime);
-        playerMovementSystem.update(&world, (float)deltaTime);
-        if (!playerMovementSystem.win)
-            carMovementSystem.update(&world, (float)deltaTime);
-        cameraLock.update(&world, (float)deltaTime);
-        movement.update(&world, (float)deltaTime);
+        // The scheduler runs them in the order they were registered unless their declared accesses allow them to run concurrently
+        // Since they always advance by the same step, a slow frame can't make the cars jump over the player
+        scheduler.run(&world, (float)fixedDeltaTime, getApp()->getJobSystem());
+        // The structural changes recorded by the systems are applied here, when no system is iterating over the world
+        world.playbackCommands();
+        // Then we compute all the world matrices in one pass now that the systems are done moving the entities
+        world.updateTransforms(&getApp()->getJobSystem());
+    }
 
-        if (playerMovementSystem.win)
-            winSystem.update(&world, (float)deltaTime);
-        // And finally we use the renderer system to draw the scene
-        renderer.render(&world);
+    void onDraw(double deltaTime) override {
+        // The frame falls between two fixed updates, so the entities are drawn between their world matrices at the start and the end of the last one
+        world.setInterpolationFactor(getApp()->getInterpolationFactor());
+        // And finally we use the renderer system to draw the scene (the occlusion culling is split between the workers of the job system)
+        renderer.render(&world, &getApp()->getJobSystem());
 
         // Get a reference to the keyboard object
         auto& keyboard = getApp()->getKeyboard();
@@ -79,8 +119,10 @@ class Playstate: public our::State {
         playerMovementSystem.exit();
         carMovementSystem.exit();
         winSystem.exit();
-        // Clear the world
+        scheduler.clear();
+        // Clear the world and its prefabs (before the assets they refer to)
         world.clear();
+        world.clearPrefabs();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
         our::clearAllAssets();
     }
@@ -2,6 +2,7 @@
 
 #include <asset-loader.hpp>
 #include <ecs/world.hpp>
+#include <ecs/cooked-scene.hpp>
 #include <components/camera.hpp>
 #include <components/mesh-renderer.hpp>
 #include <systems/forward-renderer.hpp>
@@ -17,13 +18,18 @@ class RendererTestState: public our::State {
         // First of all, we get the scene configuration from the app config
         auto& config = getApp()->getConfig()["scene"];
         // If we have assets in the scene config, we deserialize them
+        // (they are streamed from the config file since they are left out of the app config, see "main.cpp")
         if(config.contains("assets")){
-            our::deserializeAllAssets(config["assets"]);
+            our::loadAllAssets(config["assets"], getApp()->getConfigPath());
         }
 
+        // The prefabs are built before the world since its entities can be instances of them
+        if(config.contains("prefabs")){
+            world.deserializePrefabs(config["prefabs"]);
+        }
         // If we have a world in the scene config, we use it to populate our world
         if(config.contains("world")){
-            world.deserialize(config["world"]);
+            our::loadWorld(world, config["world"], getApp()->getConfigPath());
         }
 
         glm::ivec2 size = getApp()->getFrameBufferSize();
@@ -31,12 +37,15 @@ class RendererTestState: public our::State {
     }
 
     void onDraw(double deltaTime) override {
+        // The world matrices and the bounds used by the renderer to cull the entities are updated first
+        world.updateTransforms();
         // We simply call the renderer's "render" function and it should do all the rendering work
         renderer.render(&world);
     }
 
     void onDestroy() override {
         world.clear();
+        world.clearPrefabs();
         our::clearAllAssets();
     }
 };
\ No newline at end of file
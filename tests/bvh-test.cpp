@@ -0,0 +1,231 @@
+// The tests of the bounding volume hierarchy (see "spatial/bvh.hpp").
+// The entities only have boxes (no meshes), so these tests only need the ECS sources (no OpenGL context or window).
+
+#include <ecs/world.hpp>
+
+#include "check.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // The entities are in 6 rows that start at the origin and go along +X, -X, +Y, -Y, +Z and -Z.
+    // The distance of each entity from the origin is 4 times the distance of the previous one, so the box of a subtree
+    // is much smaller once its farthest entities are removed. The surface area heuristic then peels off a few entities per level,
+    // and the tree is about 25 levels deep instead of the 7 levels of a balanced tree.
+    constexpr int ROW_LENGTH = 14;
+    constexpr float ROW_GROWTH = 4.0f;
+    // The distance of the farthest entities from the origin
+    const float SCENE_EXTENT = std::pow(ROW_GROWTH, float(ROW_LENGTH - 1));
+
+    // Fills the world with the rows of entities and one entity without bounds, which is never in the hierarchy
+    std::vector<our::Entity*> buildRows(our::World& world){
+        std::vector<our::Entity*> rows;
+        for(int axis = 0; axis < 3; ++axis){
+            for(float sign : {1.0f, -1.0f}){
+                float distance = 1.0f;
+                for(int index = 0; index < ROW_LENGTH; ++index){
+                    our::Entity* entity = world.add();
+                    entity->localTransform.position[axis] = sign * distance;
+                    entity->addComponent<tests::BoxComponent>();
+                    rows.push_back(entity);
+                    distance *= ROW_GROWTH;
+                }
+            }
+        }
+        world.add();
+        world.updateTransforms();
+        return rows;
+    }
+
+    typedef std::function<bool(const our::AABB&)> BoundsTest;
+
+    // Compares the entities reported by a query with the ones found by testing the bounds of every entity of the world.
+    // Every entity passing "mustReport" is reported, and every reported entity passes "mayReport" (if given).
+    bool matches(our::World& world, std::vector<our::Entity*> reported, const BoundsTest& mustReport, const BoundsTest& mayReport){
+        std::vector<our::Entity*> required, allowed;
+        for(our::Entity* entity : world.getEntities()){
+            our::AABB bounds;
+            if(!entity->getWorldBounds(bounds)) continue;
+            if(mustReport(bounds)) required.push_back(entity);
+            if(!mayReport || mayReport(bounds)) allowed.push_back(entity);
+        }
+        std::sort(reported.begin(), reported.end());
+        std::sort(required.begin(), required.end());
+        std::sort(allowed.begin(), allowed.end());
+        // Every entity is reported once
+        if(std::adjacent_find(reported.begin(), reported.end()) != reported.end()) return false;
+        return std::includes(reported.begin(), reported.end(), required.begin(), required.end())
+            && std::includes(allowed.begin(), allowed.end(), reported.begin(), reported.end());
+    }
+    // The query must report exactly the entities passing the test
+    bool matches(our::World& world, const std::vector<our::Entity*>& reported, const BoundsTest& test){
+        return matches(world, reported, test, test);
+    }
+
+    // Returns the frustum with its planes moved along their normals by the given distance.
+    // The plane tests of a node box and of a box inside it round differently, and with boxes as big as the scene (the rows reach 6.7e7)
+    // the difference is big enough to decide a box that touches a plane either way. So the frustum queries are compared with a frustum
+    // that is a bit smaller (whose entities must be reported) and with one that is a bit bigger (out of which none may be).
+    our::Frustum movePlanes(our::Frustum frustum, float distance){
+        for(auto& plane : frustum.planes) plane.w += distance;
+        return frustum;
+    }
+
+    // Runs random frustum, overlap and ray queries spread along the rows and compares them with the brute force
+    void checkQueries(our::World& world, const std::vector<our::Entity*>& entities, std::mt19937& random){
+        const our::BVH& bvh = world.getBVH();
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        std::uniform_int_distribution<size_t> pick(0, entities.size() - 1);
+        int visibleFrustums = 0;
+        for(int query = 0; query < 200; ++query){
+            // A point near a random entity and a size that is about the distance to its neighbours
+            const glm::vec3 anchor = entities[pick(random)]->getLocalToWorldMatrix()[3];
+            glm::vec3 center = anchor;
+            float size = 1.0f + glm::length(center) * 0.2f;
+            center += glm::vec3(unit(random), unit(random), unit(random)) * size;
+
+            our::AABB box(center - size * (0.5f + 0.5f * std::abs(unit(random))), center + size * (0.5f + 0.5f * std::abs(unit(random))));
+            std::vector<our::Entity*> reported;
+            bvh.queryOverlap(box, [&](our::Entity* entity){ reported.push_back(entity); });
+            CHECK(matches(world, reported, [&](const our::AABB& bounds){ return box.overlaps(bounds); }));
+
+            // The direction is never parallel to an axis, so no slab computes 0 * infinity
+            glm::vec3 origin = center, direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-3f));
+            float maxDistance = query % 4 == 0 ? std::numeric_limits<float>::max() : size * 4.0f;
+            reported.clear();
+            bool distancesMatch = true;
+            bvh.queryRay(origin, direction, maxDistance, [&](our::Entity* entity, float distance){
+                reported.push_back(entity);
+                our::AABB bounds;
+                float expected = -1.0f;
+                entity->getWorldBounds(bounds);
+                bounds.intersectRay(origin, 1.0f / direction, maxDistance, expected);
+                distancesMatch = distancesMatch && distance == expected;
+                return maxDistance;
+            });
+            CHECK(distancesMatch);
+            CHECK(matches(world, reported, [&](const our::AABB& bounds){
+                float distance;
+                return bounds.intersectRay(origin, 1.0f / direction, maxDistance, distance);
+            }));
+
+            // A camera at the point looking (roughly) at the entity it is near
+            glm::vec3 forward = glm::normalize(glm::normalize(anchor - center + glm::vec3(1e-3f)) + glm::vec3(unit(random), unit(random), unit(random)) * 0.3f);
+            glm::vec3 up = std::abs(forward.y) > 0.9f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+            glm::mat4 viewProjection = glm::perspective(glm::radians(30.0f + 60.0f * std::abs(unit(random))), 1.5f, size * 0.01f, size * 10.0f)
+                * glm::lookAt(center, center + forward, up);
+            our::Frustum frustum = our::Frustum::fromMatrix(viewProjection);
+            our::Frustum smaller = movePlanes(frustum, -1e-6f * SCENE_EXTENT), bigger = movePlanes(frustum, 1e-6f * SCENE_EXTENT);
+            auto inSmaller = [&](const our::AABB& bounds){ return smaller.intersects(bounds); };
+            auto inBigger = [&](const our::AABB& bounds){ return bigger.intersects(bounds); };
+            reported.clear();
+            bvh.queryFrustum(frustum, [&](our::Entity* entity){ reported.push_back(entity); });
+            CHECK(matches(world, reported, inSmaller, inBigger));
+            if(!reported.empty()) ++visibleFrustums;
+            // The node query doesn't test the entities' own bounds, so it can report entities outside the frustum
+            reported.clear();
+            bvh.queryFrustumNodes(frustum, [&](our::Entity* entity){ reported.push_back(entity); });
+            CHECK(matches(world, reported, inSmaller, nullptr));
+        }
+        // Most cameras see an entity, so the comparisons above are not only made with empty lists
+        CHECK(visibleFrustums > 150);
+    }
+
+    // Every query over a degenerate (deep) tree finds the same entities as a brute force scan
+    void testDeepTreeMatchesBruteForce(){
+        our::World world;
+        std::vector<our::Entity*> entities = buildRows(world);
+        const our::BVH& bvh = world.getBVH();
+        CHECK(bvh.size() == entities.size());
+        CHECK(bvh.getDynamicCount() == 0);
+        std::mt19937 random(1);
+        checkQueries(world, entities, random);
+
+        // A query that covers everything reports every entity once
+        std::vector<our::Entity*> reported;
+        bvh.queryOverlap(our::AABB(glm::vec3(-1e20f), glm::vec3(1e20f)), [&](our::Entity* entity){ reported.push_back(entity); });
+        CHECK(matches(world, reported, [](const our::AABB&){ return true; }));
+        // A ray along the X axis (from the far end of the +X row) crosses every box of the +X and -X rows, and only them
+        reported.clear();
+        glm::vec3 end = entities[ROW_LENGTH - 1]->getLocalToWorldMatrix()[3];
+        bvh.queryRay(end + glm::vec3(1, 0.1f, 0.1f), glm::vec3(-1, 0, 0), std::numeric_limits<float>::max(),
+            [&](our::Entity* entity, float){ reported.push_back(entity); return std::numeric_limits<float>::max(); });
+        std::sort(reported.begin(), reported.end());
+        std::vector<our::Entity*> rowsX(entities.begin(), entities.begin() + 2 * ROW_LENGTH);
+        std::sort(rowsX.begin(), rowsX.end());
+        CHECK(reported == rowsX);
+    }
+
+    // The entities that move are migrated from the static tree to the dynamic one once, then the dynamic tree is refit as they keep moving
+    void testMigrationAndRefit(){
+        our::World world;
+        std::vector<our::Entity*> entities = buildRows(world);
+        const our::BVH& bvh = world.getBVH();
+        std::mt19937 random(2);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        // An update without any move changes nothing
+        world.updateTransforms();
+        CHECK(bvh.getDynamicCount() == 0);
+
+        // The first move of an entity migrates it
+        std::vector<our::Entity*> moving = {entities[0], entities[5], entities[30], entities[60], entities.back()};
+        for(our::Entity* entity : moving) entity->localTransform.position.y += 3.0f;
+        world.updateTransforms();
+        CHECK(bvh.size() == entities.size());
+        CHECK(bvh.getDynamicCount() == moving.size());
+        checkQueries(world, entities, random);
+
+        // The next moves refit the dynamic tree (or rebuild it once the refit boxes got too loose) and the moved entities stay in it.
+        // Some moves swap the places of the entities, which makes the refit boxes overlap a lot.
+        for(int step = 0; step < 20; ++step){
+            for(size_t index = 0; index < moving.size(); ++index){
+                our::Entity* entity = moving[index];
+                glm::vec3 other = moving[(index + step) % moving.size()]->localTransform.position;
+                float size = 1.0f + glm::length(other) * 0.1f;
+                entity->localTransform.position = other + glm::vec3(unit(random), unit(random), unit(random)) * size;
+            }
+            world.updateTransforms();
+            CHECK(bvh.getDynamicCount() == moving.size());
+            checkQueries(world, entities, random);
+        }
+
+        // Adding an entity rebuilds both trees, and the entities that moved before stay in the dynamic tree
+        our::Entity* added = world.add();
+        added->addComponent<tests::BoxComponent>();
+        world.updateTransforms();
+        CHECK(bvh.size() == entities.size() + 1);
+        CHECK(bvh.getDynamicCount() == moving.size());
+        // Deleting a moved entity forgets it
+        world.markForRemoval(moving[1]);
+        world.deleteMarkedEntities();
+        world.updateTransforms();
+        CHECK(bvh.size() == entities.size());
+        CHECK(bvh.getDynamicCount() == moving.size() - 1);
+        entities.erase(std::find(entities.begin(), entities.end(), moving[1]));
+        entities.push_back(added);
+        checkQueries(world, entities, random);
+
+        // An entity of the static tree that moves later is migrated too
+        entities[10]->localTransform.position.z -= 2.0f;
+        world.updateTransforms();
+        CHECK(bvh.getDynamicCount() == moving.size());
+        checkQueries(world, entities, random);
+    }
+
+}
+
+int main(){
+    testDeepTreeMatchesBruteForce();
+    testMigrationAndRefit();
+    return tests::report();
+}
@@ -0,0 +1,107 @@
+// The tests of the kernels that move the cars of a lane (see "traffic::advanceCarsSSE" in "systems/car-movement.hpp").
+// The kernels work on plain arrays, so these tests don't need a world with cars (no OpenGL context or window).
+
+#include <systems/car-movement.hpp>
+
+#include "check.hpp"
+
+#include <random>
+#include <vector>
+
+namespace {
+
+    // The arrays of a few lanes. The lanes don't start at the beginning of the arrays, so the kernels must index from "first".
+    struct Cars {
+        std::vector<float> x, speed, length;
+    };
+
+    // Moves the cars [first, end) like "CarMovementSystem::advanceLane" (the groups of 4 with SSE2, then the rest one by one)
+    // and with the scalar kernel alone, then checks that both give the same positions (for every car of the arrays) and the same wrapped cars
+    void checkSamePath(const Cars& cars, std::uint32_t first, std::uint32_t end, const our::traffic::LaneStep& step){
+        Cars simd = cars, scalar = cars;
+        std::vector<std::uint32_t> simdWrapped, scalarWrapped;
+        std::uint32_t index = our::traffic::advanceCarsSSE(step, simd.x.data(), simd.speed.data(), simd.length.data(), first, end, simdWrapped);
+        our::traffic::advanceCarsScalar(step, simd.x.data(), simd.speed.data(), simd.length.data(), index, end, simdWrapped);
+        our::traffic::advanceCarsScalar(step, scalar.x.data(), scalar.speed.data(), scalar.length.data(), first, end, scalarWrapped);
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        // The groups of 4 are all moved by the SSE kernel
+        CHECK(index == first + (end - first) / 4 * 4);
+#else
+        CHECK(index == first);
+#endif
+        // The moves are multiplied by a direction of +1 or -1, so both kernels round the same way
+        CHECK(simd.x == scalar.x);
+        CHECK(simdWrapped == scalarWrapped);
+    }
+
+    // Lanes of 1 to 9 cars in both directions, with cars next to the player, on the edge of the road and past it
+    void testLanesOfEverySize(){
+        const float roadWidth = 24.0f;
+        for(std::uint32_t count = 1; count <= 9; ++count){
+            for(float direction : {-1.0f, 1.0f}){
+                const std::uint32_t first = 3;
+                Cars cars;
+                cars.x.assign(first + count + 2, 100.0f);
+                cars.speed.assign(cars.x.size(), 4.0f);
+                cars.length.assign(cars.x.size(), 1.5f);
+                for(std::uint32_t car = 0; car < count; ++car){
+                    // The cars go from past the start of the road to past its end (in the lane's direction), 3.5 apart
+                    cars.x[first + car] = direction * (-14.0f + 3.5f * car);
+                    cars.speed[first + car] = 2.0f + car;
+                    cars.length[first + car] = 1.0f + 0.25f * car;
+                }
+                // A car exactly on the edge of the road moves on, it only jumps back once it is past the edge
+                if(count >= 6) cars.x[first + 5] = direction * roadWidth / 2.0f;
+                // The player stands next to the second car, on the lane's line
+                float playerX = count >= 2 ? cars.x[first + 1] + 0.5f : 0.0f;
+                our::traffic::LaneStep step{direction, roadWidth, playerX, 0.0f, 1.3f, 0.1f};
+                checkSamePath(cars, first, first + count, step);
+
+                // The results are also checked against the rules themselves
+                Cars moved = cars;
+                std::vector<std::uint32_t> wrapped;
+                std::uint32_t index = our::traffic::advanceCarsSSE(step, moved.x.data(), moved.speed.data(), moved.length.data(), first, first + count, wrapped);
+                our::traffic::advanceCarsScalar(step, moved.x.data(), moved.speed.data(), moved.length.data(), index, first + count, wrapped);
+                for(std::uint32_t car = first; car < first + count; ++car){
+                    bool past = direction * cars.x[car] > roadWidth / 2.0f;
+                    bool nearPlayer = std::abs(cars.x[car] - playerX) < 1.3f;
+                    if(past) CHECK(moved.x[car] == cars.x[car] - direction * (roadWidth - cars.length[car]));
+                    else if(nearPlayer) CHECK(moved.x[car] == cars.x[car]);
+                    else CHECK(moved.x[car] == cars.x[car] + direction * cars.speed[car] * 0.1f);
+                }
+                for(std::uint32_t car = 0; car < first; ++car) CHECK(moved.x[car] == 100.0f);
+                for(std::uint32_t car = first + count; car < moved.x.size(); ++car) CHECK(moved.x[car] == 100.0f);
+                // The cars past the end of the road are the ones placed more than 12 away from the middle in the lane's direction
+                std::uint32_t expectedWrapped = 0;
+                for(std::uint32_t car = first; car < first + count; ++car) if(direction * cars.x[car] > roadWidth / 2.0f) ++expectedWrapped;
+                CHECK(wrapped.size() == expectedWrapped);
+            }
+        }
+    }
+
+    // Random lanes, including players far from the lane's line (so no car stops) and on it
+    void testRandomLanes(){
+        std::mt19937 random(42);
+        std::uniform_real_distribution<float> position(-15.0f, 15.0f), unit(0.0f, 1.0f);
+        for(int run = 0; run < 500; ++run){
+            std::uint32_t first = random() % 5, count = 1 + random() % 9;
+            Cars cars;
+            for(std::uint32_t car = 0; car < first + count; ++car){
+                cars.x.push_back(position(random));
+                cars.speed.push_back(1.0f + 5.0f * unit(random));
+                cars.length.push_back(1.0f + unit(random));
+            }
+            float direction = random() % 2 ? 1.0f : -1.0f;
+            float playerX = cars.x[first + random() % count] + 2.0f * unit(random) - 1.0f;
+            float offset2 = (random() % 3) * unit(random);
+            checkSamePath(cars, first, first + count, our::traffic::LaneStep{direction, 24.0f, playerX, offset2, 1.3f, 0.02f + 0.1f * unit(random)});
+        }
+    }
+
+}
+
+int main(){
+    testLanesOfEverySize();
+    testRandomLanes();
+    return tests::report();
+}
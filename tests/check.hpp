@@ -0,0 +1,38 @@
+#pragma once
+
+// The helpers shared by the tests.
+// Each check prints the failed condition and the program fails if any check failed (see "tests::report").
+
+#include <ecs/component.hpp>
+
+#include <cstdio>
+#include <string>
+
+namespace tests {
+
+    // The number of checks that failed so far
+    inline int failures = 0;
+
+    // Prints the number of failed checks and returns the exit code of the test (1 if any check failed). "main" should end with it.
+    inline int report(){
+        if(failures > 0) std::printf("%d checks failed\n", failures);
+        else std::printf("All checks passed\n");
+        return failures > 0 ? 1 : 0;
+    }
+
+    // A component that gives its owner a box (a unit cube by default) but no triangles,
+    // so the entity is added to the hierarchy and the queries test its world bounds
+    class BoxComponent : public our::Component {
+    public:
+        our::AABB box = our::AABB(glm::vec3(-0.5f), glm::vec3(0.5f));
+        static std::string getID() { return "Box"; }
+        void deserialize(const nlohmann::json&) override {}
+        void writeCooked(our::CookedWriter&) const override {}
+        void readCooked(our::CookedReader&) override {}
+        bool getLocalBounds(our::AABB& bounds) const override { bounds = box; return true; }
+    };
+
+}
+
+// Prints the failed condition with its line, then continues with the next check
+#define CHECK(condition) do { if(!(condition)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); ++tests::failures; } } while(false)
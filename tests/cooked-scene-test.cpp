@@ -0,0 +1,312 @@
+// The tests of the cooked scenes (see "ecs/cooked-scene.hpp").
+// The scenes only use components without assets, so these tests only need the ECS sources (no OpenGL context or window).
+
+#include <ecs/world.hpp>
+#include <ecs/cooked-scene.hpp>
+#include <components/camera.hpp>
+#include <components/free-camera-controller.hpp>
+#include <components/light.hpp>
+#include <components/movement.hpp>
+
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // A scene that uses every feature of the cooked file: names, tags, children and components with plain and enum fields
+    const char* SCENE_A = R"([
+        { "name": "root", "tags": ["level", "static"], "position": [1, 2, 3], "rotation": [0, 90, 0], "scale": [2, 2, 2],
+          "components": [{ "type": "Movement", "linearVelocity": [1, 0, 0], "angularVelocity": [0, 45, 0] }],
+          "children": [
+            { "name": "lamp", "tags": ["light"], "position": [0, 5, 0],
+              "components": [{ "type": "Light", "lightType": "spot", "diffuse": [1, 0.5, 0.25], "attenuation": [0.5, 0.25, 1], "cone": [30, 15] }] },
+            { "name": "eye", "rotation": [10, 20, 30],
+              "components": [
+                { "type": "Camera", "cameraType": "orthographic", "near": 0.5, "far": 50, "orthoHeight": 4 },
+                { "type": "Free Camera Controller", "rotationSensitivity": 0.5, "positionSensitivity": [1, 2, 3], "speedupFactor": 7 }
+              ],
+              "children": [{ "name": "", "tags": ["light"], "scale": [1, 3, 1] }] }
+          ] },
+        { "name": "sun", "components": [{ "type": "Light", "lightType": "point", "specular": [0.1, 0.2, 0.3] }] }
+    ])";
+    // Another scene, used to tell which of the json or the cooked file was loaded
+    const char* SCENE_B = R"([{ "name": "other", "position": [4, 5, 6] }])";
+
+    std::vector<unsigned char> readBytes(const std::string& path){
+        std::ifstream file(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    void writeBytes(const std::string& path, const std::vector<unsigned char>& bytes){
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(bytes.data()), (std::streamsize)bytes.size());
+    }
+
+    bool sameTransform(const our::Transform& first, const our::Transform& second){
+        return first.position == second.position && first.rotation == second.rotation && first.scale == second.scale;
+    }
+
+    // Returns the index of the entity in the world's list (or -1 for a null entity)
+    long indexOf(our::World& world, our::Entity* entity){
+        const auto& entities = world.getEntities();
+        return entity ? (long)(std::find(entities.begin(), entities.end(), entity) - entities.begin()) : -1;
+    }
+
+    // Returns true if both worlds hold the same entities (in the same order) with the same names, tags, parents, transforms and components
+    bool sameWorld(our::World& first, our::World& second){
+        const auto& firstEntities = first.getEntities();
+        const auto& secondEntities = second.getEntities();
+        if(firstEntities.size() != secondEntities.size()) return false;
+        bool same = true;
+        // Every check is made on its own line so that a failure points at the field that differs
+        for(size_t index = 0; index < firstEntities.size(); ++index){
+            our::Entity* a = firstEntities[index];
+            our::Entity* b = secondEntities[index];
+            auto check = [&same](bool condition, int line){
+                if(!condition) { std::printf("%s:%d: the cooked entity differs\n", __FILE__, line); same = false; }
+            };
+            check(a->getName() == b->getName(), __LINE__);
+            check(a->getTags() == b->getTags(), __LINE__);
+            check(indexOf(first, a->getParent()) == indexOf(second, b->getParent()), __LINE__);
+            check(sameTransform(a->localTransform, b->localTransform), __LINE__);
+            check(a->getComponentMask() == b->getComponentMask(), __LINE__);
+            if(auto* movement = a->getComponent<our::MovementComponent>()){
+                auto* other = b->getComponent<our::MovementComponent>();
+                check(other && movement->linearVelocity == other->linearVelocity && movement->angularVelocity == other->angularVelocity, __LINE__);
+            }
+            if(auto* light = a->getComponent<our::LightComponent>()){
+                auto* other = b->getComponent<our::LightComponent>();
+                check(other && light->lightType == other->lightType && light->diffuse == other->diffuse && light->specular == other->specular
+                    && light->ambient == other->ambient && light->attenuation == other->attenuation && light->cone == other->cone, __LINE__);
+            }
+            if(auto* camera = a->getComponent<our::CameraComponent>()){
+                auto* other = b->getComponent<our::CameraComponent>();
+                check(other && camera->cameraType == other->cameraType && camera->near == other->near && camera->far == other->far
+                    && camera->fovY == other->fovY && camera->orthoHeight == other->orthoHeight, __LINE__);
+            }
+            if(auto* controller = a->getComponent<our::FreeCameraControllerComponent>()){
+                auto* other = b->getComponent<our::FreeCameraControllerComponent>();
+                check(other && controller->rotationSensitivity == other->rotationSensitivity && controller->fovSensitivity == other->fovSensitivity
+                    && controller->positionSensitivity == other->positionSensitivity && controller->speedupFactor == other->speedupFactor, __LINE__);
+            }
+        }
+        return same;
+    }
+
+    // The offsets of the arrays of a cooked file (computed like "World::deserializeCooked" does)
+    struct Layout {
+        our::cooked::Header header;
+        size_t entities, tags, components, data, stringOffsets, characters;
+        explicit Layout(const std::vector<unsigned char>& bytes){
+            std::memcpy(&header, bytes.data(), sizeof(header));
+            entities = our::cooked::align(sizeof(our::cooked::Header));
+            tags = entities + our::cooked::align(header.entityCount * sizeof(our::cooked::EntityRecord));
+            components = tags + our::cooked::align(header.tagCount * sizeof(std::uint32_t));
+            data = components + our::cooked::align(header.componentCount * sizeof(our::cooked::ComponentRecord));
+            stringOffsets = data + our::cooked::align(header.dataSize);
+            characters = stringOffsets + our::cooked::align((header.stringCount + 1) * sizeof(std::uint32_t));
+        }
+    };
+
+    // Copies the value at the offset out of the bytes, changes it, then copies it back
+    template<typename T, typename Change>
+    std::vector<unsigned char> patch(std::vector<unsigned char> bytes, size_t offset, Change change){
+        T value;
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        change(value);
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+        return bytes;
+    }
+
+    // Writes the bytes into a file and returns true if loading it was rejected without adding any entity
+    bool isRejected(const std::vector<unsigned char>& bytes, std::uint64_t sourceSize = 7, std::uint64_t sourceHash = 11){
+        writeBytes("corrupted.cooked", bytes);
+        our::World world;
+        bool loaded = world.deserializeCooked("corrupted.cooked", sourceSize, sourceHash);
+        return !loaded && world.getEntities().empty();
+    }
+
+    // A cooked world holds the same entities as the json it was cooked from
+    void testRoundtrip(){
+        our::World original;
+        original.deserialize(nlohmann::json::parse(SCENE_A));
+        CHECK(original.getEntities().size() == 5);
+        CHECK(original.cook("roundtrip.cooked", 7, 11));
+
+        our::World cooked;
+        CHECK(cooked.deserializeCooked("roundtrip.cooked", 7, 11));
+        CHECK(sameWorld(original, cooked));
+        // The name and tag indices are rebuilt, so the cooked entities can be found like the deserialized ones
+        CHECK(cooked.findByName("lamp") == cooked.getEntities()[1]);
+        CHECK(cooked.findAllByTag("light").size() == 2);
+        // The cached matrices of the cooked entities follow their parents
+        cooked.updateTransforms();
+        original.updateTransforms();
+        CHECK(cooked.getEntities()[3]->getLocalToWorldMatrix() == original.getEntities()[3]->getLocalToWorldMatrix());
+
+        // A cooked scene is added after the entities that are already in the world, and the parents are offset accordingly
+        cooked.deserializeCooked("roundtrip.cooked", 7, 11);
+        CHECK(cooked.getEntities().size() == 10);
+        CHECK(cooked.getEntities()[6]->getParent() == cooked.getEntities()[5]);
+
+        // An empty world gives an empty scene
+        our::World empty, emptyCooked;
+        CHECK(empty.cook("empty.cooked"));
+        CHECK(emptyCooked.deserializeCooked("empty.cooked"));
+        CHECK(emptyCooked.getEntities().empty());
+    }
+
+    // A cooked scene whose source size or hash differs from the config file is not loaded, so the json is loaded instead
+    void testStaleSourceFallsBackToJson(){
+        const std::string source = "scene.json";
+        const std::string cachePath = our::cooked::getCachePath(source);
+        std::filesystem::remove(cachePath);
+        nlohmann::json sceneA = nlohmann::json::parse(SCENE_A), sceneB = nlohmann::json::parse(SCENE_B);
+        std::string content = "{ \"version\": 1 }";
+        writeBytes(source, std::vector<unsigned char>(content.begin(), content.end()));
+
+        // The first load deserializes the json and cooks it
+        our::World first;
+        our::loadWorld(first, sceneA, source);
+        CHECK(first.getEntities().size() == 5);
+        CHECK(std::filesystem::exists(cachePath));
+        // While the config file is unchanged, the cooked scene is loaded instead of the given json
+        our::World second;
+        our::loadWorld(second, sceneB, source);
+        CHECK(sameWorld(first, second));
+
+        // The size and the hash are both checked
+        std::uint64_t size = content.size(), hash = our::cooked::hashBytes(reinterpret_cast<const unsigned char*>(content.data()), content.size());
+        our::World direct;
+        CHECK(direct.deserializeCooked(cachePath, size, hash));
+        CHECK(!direct.deserializeCooked(cachePath, size + 1, hash));
+        CHECK(!direct.deserializeCooked(cachePath, size, hash ^ 1));
+        CHECK(direct.getEntities().size() == 5);
+
+        // An edit that keeps the size of the config only changes its hash
+        content = "{ \"version\": 2 }";
+        writeBytes(source, std::vector<unsigned char>(content.begin(), content.end()));
+        our::World edited;
+        our::loadWorld(edited, sceneB, source);
+        CHECK(edited.getEntities().size() == 1 && edited.getEntities()[0]->getName() == "other");
+        // The json was cooked again, so the next load gets the new scene
+        our::World recooked;
+        our::loadWorld(recooked, sceneA, source);
+        CHECK(recooked.getEntities().size() == 1 && recooked.getEntities()[0]->getName() == "other");
+
+        // An edit that changes the size
+        content += " ";
+        writeBytes(source, std::vector<unsigned char>(content.begin(), content.end()));
+        our::World resized;
+        our::loadWorld(resized, sceneA, source);
+        CHECK(sameWorld(first, resized));
+    }
+
+    // A truncated or corrupted file is rejected before any entity is added, and its counts or indices are never trusted to read the file
+    void testCorruptedFilesAreRejected(){
+        our::World original;
+        original.deserialize(nlohmann::json::parse(SCENE_A));
+        CHECK(original.cook("valid.cooked", 7, 11));
+        const std::vector<unsigned char> bytes = readBytes("valid.cooked");
+        const Layout layout(bytes);
+        CHECK(layout.characters + layout.header.stringSize <= bytes.size());
+        CHECK(!isRejected(bytes));
+
+        // Only the padding after the last string can be cut without losing data
+        for(size_t size = 0; size < layout.characters + layout.header.stringSize; ++size)
+            CHECK(isRejected(std::vector<unsigned char>(bytes.begin(), bytes.begin() + size)));
+
+        using our::cooked::Header;
+        using our::cooked::EntityRecord;
+        using our::cooked::ComponentRecord;
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.magic ^= 1; })));
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.version += 1; })));
+        // Counts that would put the arrays past the end of the file
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.entityCount = 0xFFFFFFFFu; })));
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.componentCount += 1000; })));
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.stringCount = 0xFFFFFFFFu; })));
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.dataSize = 0xFFFFFFF8u; })));
+        CHECK(isRejected(patch<Header>(bytes, 0, [](Header& header){ header.stringSize += 8; })));
+        // Indices out of their arrays
+        const size_t lamp = layout.entities + sizeof(EntityRecord);
+        CHECK(isRejected(patch<EntityRecord>(bytes, lamp, [&](EntityRecord& record){ record.parent = (std::int32_t)layout.header.entityCount; })));
+        CHECK(isRejected(patch<EntityRecord>(bytes, lamp, [](EntityRecord& record){ record.parent = -2; })));
+        CHECK(isRejected(patch<EntityRecord>(bytes, lamp, [&](EntityRecord& record){ record.name = layout.header.stringCount; })));
+        CHECK(isRejected(patch<EntityRecord>(bytes, lamp, [&](EntityRecord& record){ record.firstTag = layout.header.tagCount; })));
+        CHECK(isRejected(patch<EntityRecord>(bytes, lamp, [](EntityRecord& record){ record.componentCount = 0xFFFFFFFFu; })));
+        CHECK(isRejected(patch<std::uint32_t>(bytes, layout.tags, [&](std::uint32_t& tag){ tag = layout.header.stringCount; })));
+        CHECK(isRejected(patch<ComponentRecord>(bytes, layout.components, [&](ComponentRecord& record){ record.offset = layout.header.dataSize; })));
+        CHECK(isRejected(patch<ComponentRecord>(bytes, layout.components, [](ComponentRecord& record){ record.size = 0xFFFFFFFFu; })));
+        CHECK(isRejected(patch<ComponentRecord>(bytes, layout.components, [](ComponentRecord& record){ record.type ^= 1; })));
+        CHECK(isRejected(patch<std::uint32_t>(bytes, layout.stringOffsets + sizeof(std::uint32_t), [](std::uint32_t& offset){ offset = 0xFFFFFFFFu; })));
+        CHECK(isRejected(patch<std::uint32_t>(bytes, layout.stringOffsets + layout.header.stringCount * sizeof(std::uint32_t),
+            [&](std::uint32_t& offset){ offset = layout.header.stringSize + 1; })));
+
+        // Any single corrupted byte is either rejected (leaving the world empty) or loaded as a whole scene
+        for(size_t index = 0; index < bytes.size(); ++index){
+            std::vector<unsigned char> corrupted = bytes;
+            corrupted[index] ^= 0xFF;
+            writeBytes("corrupted.cooked", corrupted);
+            our::World world;
+            bool loaded = world.deserializeCooked("corrupted.cooked", 7, 11);
+            CHECK(loaded ? !world.getEntities().empty() : world.getEntities().empty());
+        }
+    }
+
+    // The json is only cooked if the world was empty before loading it, since the cooked file would hold the other entities too
+    void testCookingOnlyIntoEmptyWorld(){
+        const std::string source = "empty-only.json";
+        const std::string cachePath = our::cooked::getCachePath(source);
+        std::filesystem::remove(cachePath);
+        std::string content = "{}";
+        writeBytes(source, std::vector<unsigned char>(content.begin(), content.end()));
+        nlohmann::json scene = nlohmann::json::parse(SCENE_A);
+
+        our::World filled;
+        filled.add()->setName("existing");
+        our::loadWorld(filled, scene, source);
+        CHECK(filled.getEntities().size() == 6);
+        CHECK(!std::filesystem::exists(cachePath));
+
+        our::World empty;
+        our::loadWorld(empty, scene, source);
+        CHECK(std::filesystem::exists(cachePath));
+        // A cooked scene can still be added to a world that has entities
+        our::loadWorld(filled, scene, source);
+        CHECK(filled.getEntities().size() == 11);
+
+        // A missing config file is never cooked
+        const std::string missing = "missing.json";
+        std::filesystem::remove(our::cooked::getCachePath(missing));
+        our::World world;
+        our::loadWorld(world, scene, missing);
+        CHECK(world.getEntities().size() == 5);
+        CHECK(!std::filesystem::exists(our::cooked::getCachePath(missing)));
+    }
+
+}
+
+int main(){
+    // The files are written into a temporary directory (including the cache of "loadWorld", which is relative to the working directory)
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "cooked-scene-test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory / our::cooked::CACHE_DIRECTORY);
+    std::filesystem::current_path(directory);
+
+    testRoundtrip();
+    testStaleSourceFallsBackToJson();
+    testCorruptedFilesAreRejected();
+    testCookingOnlyIntoEmptyWorld();
+
+    std::filesystem::current_path(directory.parent_path());
+    std::filesystem::remove_all(directory);
+    return tests::report();
+}
@@ -0,0 +1,140 @@
+// The tests of the batched sphere culling (see "Frustum::cullSpheres"), which tests 8 spheres at once with AVX, SSE2 or a scalar loop
+// depending on the target, so the test checks whichever of them the build uses (build it with "-mavx" to test the AVX path, or with "-U__SSE2__" to test the scalar loop).
+// Every bit of the masks is compared with "Frustum::intersects" for the same sphere. Only the frustum source is needed.
+
+#include <spatial/frustum.hpp>
+
+#include "check.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+    constexpr size_t SPHERE_COUNT = 1237; // Not a multiple of 8, so the last batch has padding slots
+
+    // The spheres as a structure of arrays padded to a multiple of SPHERE_BATCH (like the renderer's candidates)
+    struct Spheres {
+        std::vector<float> x, y, z, radius;
+        size_t count = 0;
+
+        size_t paddedCount() const { return (count + our::Frustum::SPHERE_BATCH - 1) / our::Frustum::SPHERE_BATCH * our::Frustum::SPHERE_BATCH; }
+
+        void add(const glm::vec3& center, float r){
+            x.push_back(center.x);
+            y.push_back(center.y);
+            z.push_back(center.z);
+            radius.push_back(r);
+            ++count;
+        }
+
+        // Fills the padding slots with the given sphere
+        void pad(const glm::vec3& center, float r){
+            size_t padded = paddedCount();
+            x.resize(count); y.resize(count); z.resize(count); radius.resize(count);
+            x.resize(padded, center.x); y.resize(padded, center.y); z.resize(padded, center.z); radius.resize(padded, r);
+        }
+
+        std::vector<std::uint8_t> cull(const our::Frustum& frustum) const {
+            std::vector<std::uint8_t> masks(paddedCount() / our::Frustum::SPHERE_BATCH, 0xAB);
+            frustum.cullSpheres(x.data(), y.data(), z.data(), radius.data(), paddedCount(), masks.data());
+            return masks;
+        }
+
+        our::BoundingSphere sphere(size_t index) const { return our::BoundingSphere(glm::vec3(x[index], y[index], z[index]), radius[index]); }
+    };
+
+    bool visibleBit(const std::vector<std::uint8_t>& masks, size_t index){
+        return (masks[index / our::Frustum::SPHERE_BATCH] >> (index % our::Frustum::SPHERE_BATCH)) & 1;
+    }
+
+    // The smallest distance between the surface of the sphere and a plane of the frustum, on either side of the plane.
+    // The batched test adds the terms in another order than "intersects", so the spheres that touch a plane within rounding can go either way.
+    float closestMargin(const our::Frustum& frustum, const our::BoundingSphere& sphere){
+        float margin = std::numeric_limits<float>::max();
+        for(const auto& plane : frustum.planes)
+            margin = std::min(margin, std::abs(glm::dot(glm::vec3(plane), sphere.center) + plane.w + sphere.radius));
+        return margin;
+    }
+
+    our::Frustum cameraFrustum(){
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(3, 2, 5), glm::vec3(-4, 0, -20), glm::vec3(0, 1, 0));
+        return our::Frustum::fromMatrix(projection * view);
+    }
+
+    // Random spheres around a perspective camera: every mask bit must match the test of the single sphere,
+    // and the padding slots must not change the bits of the real spheres whatever they hold
+    void testRandomSpheres(){
+        our::Frustum frustum = cameraFrustum();
+        std::mt19937 random(19);
+        std::uniform_real_distribution<float> position(-120.0f, 120.0f), size(0.0f, 8.0f);
+        Spheres spheres;
+        while(spheres.count < SPHERE_COUNT){
+            glm::vec3 center(position(random), position(random), position(random));
+            float radius = size(random);
+            if(closestMargin(frustum, our::BoundingSphere(center, radius)) > 1e-3f) spheres.add(center, radius);
+        }
+
+        // The renderer pads with zeros (a point at the origin, which is inside this frustum)
+        spheres.pad(glm::vec3(0.0f), 0.0f);
+        std::vector<std::uint8_t> masks = spheres.cull(frustum);
+        size_t visible = 0, mismatches = 0;
+        for(size_t index = 0; index < spheres.count; ++index){
+            bool expected = frustum.intersects(spheres.sphere(index));
+            if(visibleBit(masks, index) != expected) ++mismatches;
+            if(expected) ++visible;
+        }
+        CHECK(mismatches == 0);
+        // Both outcomes are tested
+        CHECK(visible > 50 && visible < spheres.count - 50);
+
+        // Padding with spheres that are far outside, huge or not numbers only changes the padding bits
+        const float infinity = std::numeric_limits<float>::infinity(), nan = std::numeric_limits<float>::quiet_NaN();
+        for(float fill : {-1e30f, 1e30f, infinity, nan}){
+            spheres.pad(glm::vec3(fill), fill);
+            std::vector<std::uint8_t> padded = spheres.cull(frustum);
+            bool same = true;
+            for(size_t index = 0; index < spheres.count; ++index) same = same && visibleBit(padded, index) == visibleBit(masks, index);
+            CHECK(same);
+        }
+    }
+
+    // Spheres just outside each plane, straddling it with their center outside, and just inside it
+    void testSpheresNearPlanes(){
+        our::Frustum frustum = cameraFrustum();
+        // A point well inside the frustum (between the near and the far planes, on the view direction)
+        glm::vec3 inside = glm::vec3(3, 2, 5) + 20.0f * glm::normalize(glm::vec3(-7, -2, -25));
+        Spheres spheres;
+        std::vector<bool> expected;
+        for(const auto& plane : frustum.planes){
+            // The point of the plane closest to the inside point, which is inside the other planes
+            glm::vec3 normal(plane);
+            glm::vec3 onPlane = inside - (glm::dot(normal, inside) + plane.w) * normal;
+            spheres.add(onPlane - 0.5f * normal, 0.49f);
+            expected.push_back(false);
+            spheres.add(onPlane - 0.5f * normal, 0.51f);
+            expected.push_back(true);
+            spheres.add(onPlane + 0.05f * normal, 0.01f);
+            expected.push_back(true);
+        }
+        spheres.pad(glm::vec3(0.0f), 0.0f);
+        std::vector<std::uint8_t> masks = spheres.cull(frustum);
+        for(size_t index = 0; index < spheres.count; ++index){
+            CHECK(frustum.intersects(spheres.sphere(index)) == expected[index]);
+            CHECK(visibleBit(masks, index) == expected[index]);
+        }
+    }
+
+}
+
+int main(){
+    testRandomSpheres();
+    testSpheresNearPlanes();
+    return tests::report();
+}
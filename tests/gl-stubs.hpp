@@ -0,0 +1,32 @@
+#pragma once
+
+// The meshes upload their data with OpenGL in their constructor, but the tests have no OpenGL context.
+// So the tests that build meshes link glad and replace the few GL functions that "Mesh" calls by functions that do nothing.
+
+#include <glad/gl.h>
+
+namespace gl_stubs {
+
+    // The GL functions called by the constructor and the destructor of "Mesh"
+    inline void GLAD_API_PTR generateNames(GLsizei count, GLuint* names) { for(GLsizei index = 0; index < count; ++index) names[index] = GLuint(index + 1); }
+    inline void GLAD_API_PTR deleteNames(GLsizei, const GLuint*) {}
+    inline void GLAD_API_PTR bindVertexArray(GLuint) {}
+    inline void GLAD_API_PTR bindBuffer(GLenum, GLuint) {}
+    inline void GLAD_API_PTR bufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+    inline void GLAD_API_PTR vertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+    inline void GLAD_API_PTR enableVertexAttribArray(GLuint) {}
+
+    // Must be called before the first mesh is created
+    inline void install(){
+        glad_glGenVertexArrays = generateNames;
+        glad_glGenBuffers = generateNames;
+        glad_glDeleteVertexArrays = deleteNames;
+        glad_glDeleteBuffers = deleteNames;
+        glad_glBindVertexArray = bindVertexArray;
+        glad_glBindBuffer = bindBuffer;
+        glad_glBufferData = bufferData;
+        glad_glVertexAttribPointer = vertexAttribPointer;
+        glad_glEnableVertexAttribArray = enableVertexAttribArray;
+    }
+
+}
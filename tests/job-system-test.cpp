@@ -0,0 +1,164 @@
+// The tests of the job system (see "jobs/job-system.hpp").
+// The job system only needs the standard library, so these tests only compile the job sources (no OpenGL context or window).
+
+#include <jobs/job-system.hpp>
+
+#include "check.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Every index of the range is given to exactly one call, whatever the grain (including grains that don't divide the range)
+    void testParallelForCoversEveryIndexOnce(){
+        our::JobSystem jobs(4);
+        for(size_t grain : {size_t(0), size_t(1), size_t(7), size_t(64), size_t(1000), size_t(5000)}){
+            const size_t begin = 3, end = 1003;
+            std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[end]);
+            for(size_t index = 0; index < end; ++index) visits[index] = 0;
+            std::atomic<bool> validRanges{true};
+            jobs.parallelFor(begin, end, grain, [&](size_t rangeBegin, size_t rangeEnd){
+                if(rangeBegin >= rangeEnd || rangeEnd - rangeBegin > std::max<size_t>(grain, 1)) validRanges = false;
+                for(size_t index = rangeBegin; index < rangeEnd; ++index) visits[index]++;
+            });
+            CHECK(validRanges);
+            for(size_t index = 0; index < end; ++index)
+                CHECK(visits[index] == (index >= begin ? 1 : 0));
+        }
+        // An empty range never calls the function
+        bool called = false;
+        jobs.parallelFor(10, 10, 4, [&](size_t, size_t){ called = true; });
+        CHECK(!called);
+    }
+
+    // A job scheduled with a dependency starts after every job counted by the dependency finished, and never before
+    void testDependencyGatesJobs(){
+        our::JobSystem jobs(4);
+        for(int run = 0; run < 20; ++run){
+            our::JobCounter first, second;
+            std::atomic<int> finished{0};
+            std::atomic<int> startedEarly{0};
+            std::atomic<bool> release{false};
+            const int count = 8;
+            for(int job = 0; job < count; ++job){
+                jobs.schedule([&, job](){
+                    // The first job holds the others back for a while, so a gated job that started too early would see it
+                    while(job == 0 && !release) std::this_thread::yield();
+                    finished++;
+                }, &first);
+            }
+            for(int job = 0; job < count; ++job){
+                jobs.schedule([&](){
+                    if(finished.load() != count) startedEarly++;
+                }, &second, &first);
+            }
+            // The gated jobs are waiting in the dependency, not in the deques, so they can't run yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            CHECK(!second.isDone());
+            release = true;
+            jobs.wait(second);
+            CHECK(first.isDone());
+            CHECK(startedEarly == 0);
+        }
+        // A dependency that is already done doesn't hold the job back
+        our::JobCounter done, counter;
+        std::atomic<bool> ran{false};
+        jobs.schedule([&](){ ran = true; }, &counter, &done);
+        jobs.wait(counter);
+        CHECK(ran);
+    }
+
+    // Jobs that run "parallelFor" (and so wait for their own jobs) finish even if every worker is busy with such a job
+    void testNestedParallelForDoesNotDeadlock(){
+        our::JobSystem jobs(3);
+        std::atomic<size_t> total{0};
+        jobs.parallelFor(0, 16, 1, [&](size_t, size_t){
+            jobs.parallelFor(0, 100, 10, [&](size_t begin, size_t end){
+                jobs.parallelFor(begin, end, 3, [&](size_t innerBegin, size_t innerEnd){ total += innerEnd - innerBegin; });
+            });
+        });
+        CHECK(total == 16 * 100);
+    }
+
+    // The counter can be destroyed right after "wait" returns, while the continuations it released are still being pushed
+    void testCounterLifetime(){
+        our::JobSystem jobs(4);
+        std::atomic<int> ran{0};
+        for(int run = 0; run < 200; ++run){
+            our::JobCounter outer;
+            {
+                auto dependency = std::make_unique<our::JobCounter>();
+                our::JobCounter counter;
+                jobs.schedule([](){}, dependency.get());
+                jobs.schedule([&](){ ran++; }, &outer, dependency.get());
+                jobs.wait(*dependency);
+                dependency.reset();
+                jobs.schedule([&](){ ran++; }, &counter);
+                jobs.wait(counter);
+            }
+            jobs.wait(outer);
+        }
+        CHECK(ran == 400);
+    }
+
+    // The workers go to sleep when there is nothing to run and wake up for the next jobs.
+    // Job systems can be created and destroyed many times, with or without pending work.
+    void testSleepWakeAndRepeatedCreation(){
+        our::JobSystem jobs(4);
+        std::atomic<int> ran{0};
+        for(int round = 0; round < 5; ++round){
+            // Long enough for every worker to find nothing to do and sleep
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            our::JobCounter counter;
+            std::atomic<int> running{0}, mostRunning{0};
+            // Each job waits (for a bounded time) till the other one runs too, which needs a worker to wake up and steal it
+            for(int job = 0; job < 2; ++job)
+                jobs.schedule([&](){
+                    int now = ++running;
+                    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+                    while(now < 2 && std::chrono::steady_clock::now() < deadline) now = running.load();
+                    int most = mostRunning.load();
+                    while(now > most && !mostRunning.compare_exchange_weak(most, now)) {}
+                    ran++;
+                    // The job stays counted till the other one saw it
+                    while(mostRunning.load() < 2 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+                    --running;
+                }, &counter);
+            jobs.wait(counter);
+            CHECK(mostRunning == 2);
+        }
+        CHECK(ran == 10);
+
+        for(int round = 0; round < 50; ++round){
+            our::JobSystem shortLived(1 + round % 4);
+            CHECK(shortLived.getWorkerCount() == size_t(1 + round % 4));
+            std::atomic<int> sum{0};
+            shortLived.parallelFor(0, 100, 8, [&](size_t begin, size_t end){ sum += int(end - begin); });
+            CHECK(sum == 100);
+            // Jobs that didn't start before the destruction are dropped without blocking the destructor
+            if(round % 2 == 0) shortLived.schedule([](){});
+        }
+        // A single worker system runs everything on the calling thread
+        our::JobSystem single(1);
+        std::thread::id caller = std::this_thread::get_id();
+        bool sameThread = true;
+        single.parallelFor(0, 10, 1, [&](size_t, size_t){ sameThread = sameThread && std::this_thread::get_id() == caller; });
+        CHECK(sameThread);
+    }
+
+}
+
+int main(){
+    testParallelForCoversEveryIndexOnce();
+    testDependencyGatesJobs();
+    testNestedParallelForDoesNotDeadlock();
+    testCounterLifetime();
+    testSleepWakeAndRepeatedCreation();
+    return tests::report();
+}
@@ -0,0 +1,87 @@
+// The tests of the levels of detail made by the mesh simplification (see "mesh_utils::generateLODs").
+// The sphere is made by "mesh_utils::sphere", whose mesh is uploaded with OpenGL, so the few GL functions it calls are replaced by functions that do nothing.
+
+#include <mesh/mesh-utils.hpp>
+
+#include "check.hpp"
+#include "gl-stubs.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace {
+
+    // The direction that the front of a triangle must face at a point of the original surface
+    typedef std::function<glm::vec3(const glm::vec3&)> Outside;
+
+    // Checks the levels of detail of a mesh:
+    //  - there are some levels and each one has fewer triangles than the previous one (the first is compared to the full mesh)
+    //  - the error never decreases from a level to the next
+    //  - every index is a vertex of the shared vertex buffer
+    //  - no triangle folds over (its front still faces the outside of the original surface)
+    void checkLODs(const std::vector<our::Vertex>& vertices, const std::vector<unsigned int>& elements, const Outside& outside){
+        std::vector<our::MeshLOD> lods = our::mesh_utils::generateLODs(vertices, elements);
+        CHECK(lods.size() >= 2);
+        size_t previousCount = elements.size() / 3;
+        float previousError = 0.0f;
+        for(const our::MeshLOD& lod : lods){
+            CHECK(lod.elements.size() % 3 == 0);
+            size_t count = lod.elements.size() / 3;
+            CHECK(count > 0 && count < previousCount);
+            CHECK(lod.error >= previousError);
+            previousCount = count;
+            previousError = lod.error;
+
+            bool validIndices = true, facingOutside = true;
+            for(size_t index = 0; index + 2 < lod.elements.size(); index += 3){
+                unsigned int a = lod.elements[index], b = lod.elements[index + 1], c = lod.elements[index + 2];
+                if(a >= vertices.size() || b >= vertices.size() || c >= vertices.size()) { validIndices = false; continue; }
+                const glm::vec3& p0 = vertices[a].position;
+                const glm::vec3& p1 = vertices[b].position;
+                const glm::vec3& p2 = vertices[c].position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                if(glm::dot(normal, outside((p0 + p1 + p2) / 3.0f)) <= 0.0f) facingOutside = false;
+            }
+            CHECK(validIndices);
+            CHECK(facingOutside);
+        }
+    }
+
+    // A flat square in the XZ plane divided into a grid of quads (the triangles face +Y)
+    void testSubdividedPlane(){
+        const int divisions = 24;
+        std::vector<our::Vertex> vertices;
+        for(int z = 0; z <= divisions; ++z)
+            for(int x = 0; x <= divisions; ++x){
+                glm::vec2 uv = glm::vec2(x, z) / float(divisions);
+                vertices.push_back({glm::vec3(2.0f * uv.x - 1.0f, 0.0f, 2.0f * uv.y - 1.0f), our::Color(255), uv, glm::vec3(0, 1, 0)});
+            }
+        std::vector<unsigned int> elements;
+        for(int z = 0; z < divisions; ++z)
+            for(int x = 0; x < divisions; ++x){
+                unsigned int corner = z * (divisions + 1) + x;
+                unsigned int right = corner + 1, down = corner + divisions + 1, diagonal = down + 1;
+                elements.insert(elements.end(), {corner, down, right, right, down, diagonal});
+            }
+        checkLODs(vertices, elements, [](const glm::vec3&){ return glm::vec3(0, 1, 0); });
+    }
+
+    // A closed sphere made by "mesh_utils::sphere" (the vertices on its seam and at its poles share their positions)
+    void testSphere(){
+        std::unique_ptr<our::Mesh> mesh(our::mesh_utils::sphere(glm::ivec2(32, 16)));
+        // The mesh only keeps the positions, and the normals of a unit sphere are its positions
+        std::vector<our::Vertex> vertices;
+        for(const glm::vec3& position : mesh->getPositions()) vertices.push_back({position, our::Color(255), glm::vec2(0), position});
+        checkLODs(vertices, mesh->getTriangles(), [](const glm::vec3& point){ return point; });
+    }
+
+}
+
+int main(){
+    gl_stubs::install();
+    testSubdividedPlane();
+    testSphere();
+    return tests::report();
+}
@@ -0,0 +1,163 @@
+// The tests of the occlusion buffer (see "spatial/occlusion-buffer.hpp").
+// The buffer is filled on the CPU, so these tests only need the spatial and the job sources (no OpenGL context or window).
+
+#include <spatial/occlusion-buffer.hpp>
+#include <jobs/job-system.hpp>
+
+#include "check.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+    const std::vector<unsigned int> QUAD_TRIANGLES = {0, 1, 2, 2, 3, 0};
+
+    // Returns the corners of a rectangle parallel to the xy plane at the given depth (counter clockwise seen from +z)
+    std::vector<glm::vec3> makeQuad(glm::vec2 min, glm::vec2 max, float z){
+        return {glm::vec3(min.x, min.y, z), glm::vec3(max.x, min.y, z), glm::vec3(max.x, max.y, z), glm::vec3(min.x, max.y, z)};
+    }
+
+    // A camera at the origin looking toward -z
+    glm::mat4 makeCamera(){
+        return glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    }
+
+    // Returns the depths of all the visible pixels of the buffer
+    std::vector<float> readDepths(const our::OcclusionBuffer& buffer){
+        std::vector<float> depths;
+        for(int y = 0; y < buffer.getHeight(); ++y)
+            for(int x = 0; x < buffer.getWidth(); ++x)
+                depths.push_back(buffer.getDepth(x, y));
+        return depths;
+    }
+
+    // A quad in front of the camera hides the boxes behind it but not the boxes in front of it
+    void testQuadHidesBoxBehind(){
+        our::OcclusionBuffer buffer;
+        buffer.resize(128, 128);
+        buffer.begin(makeCamera());
+        buffer.addOccluder(glm::mat4(1.0f), makeQuad(glm::vec2(-2.0f), glm::vec2(2.0f), -5.0f), QUAD_TRIANGLES);
+        buffer.rasterize();
+        CHECK(buffer.getTriangleCount() == 2);
+
+        our::AABB behind{glm::vec3(-0.5f, -0.5f, -12.0f), glm::vec3(0.5f, 0.5f, -10.0f)};
+        our::AABB inFront{glm::vec3(-0.5f, -0.5f, -4.0f), glm::vec3(0.5f, 0.5f, -3.0f)};
+        our::AABB besides{glm::vec3(5.0f, -0.5f, -12.0f), glm::vec3(7.0f, 0.5f, -10.0f)}; // Behind the quad's plane but not behind the quad
+        CHECK(!buffer.isVisible(behind));
+        CHECK(buffer.isVisible(inFront));
+        CHECK(buffer.isVisible(besides));
+    }
+
+    // A triangle that crosses the near plane is clipped, so only the part in front of the camera is drawn with depths from 0 to 1
+    void testNearPlaneClipping(){
+        our::OcclusionBuffer buffer;
+        buffer.resize(64, 64);
+        buffer.begin(makeCamera());
+        std::vector<glm::vec3> positions = {glm::vec3(-1.0f, -1.0f, -5.0f), glm::vec3(1.0f, -1.0f, -5.0f), glm::vec3(0.0f, -1.0f, 3.0f)};
+        buffer.addOccluder(glm::mat4(1.0f), positions, {0, 1, 2});
+        // One corner is behind the camera, so the triangle is clipped into a quad
+        CHECK(buffer.getTriangleCount() == 2);
+        buffer.rasterize();
+        int covered = 0;
+        for(float depth : readDepths(buffer)){
+            CHECK(std::isfinite(depth) && depth >= 0.0f && depth <= 1.0f);
+            if(depth < 1.0f) ++covered;
+        }
+        CHECK(covered > 0);
+        // The triangle lies on the floor (y = -1), so the upper half of the screen is left empty
+        for(int y = 32; y < 64; ++y)
+            for(int x = 0; x < 64; ++x)
+                CHECK(buffer.getDepth(x, y) == 1.0f);
+
+        // A triangle that is completely behind the camera draws nothing
+        buffer.begin(makeCamera());
+        buffer.addOccluder(glm::mat4(1.0f), {glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 2.0f)}, {0, 1, 2});
+        buffer.rasterize();
+        CHECK(buffer.getTriangleCount() == 0);
+        for(float depth : readDepths(buffer)) CHECK(depth == 1.0f);
+    }
+
+    // A box that crosses the near plane can't be projected, so it is visible even if the whole screen is covered
+    void testBoxCrossingNearPlaneIsVisible(){
+        our::OcclusionBuffer buffer;
+        buffer.resize(64, 64);
+        buffer.begin(makeCamera());
+        buffer.addOccluder(glm::mat4(1.0f), makeQuad(glm::vec2(-10.0f), glm::vec2(10.0f), -2.0f), QUAD_TRIANGLES);
+        buffer.rasterize();
+        CHECK(!buffer.isVisible(our::AABB{glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -5.0f)}));
+        CHECK(buffer.isVisible(our::AABB{glm::vec3(-1.0f, -1.0f, -5.0f), glm::vec3(1.0f, 1.0f, 1.0f)}));
+        CHECK(buffer.isVisible(our::AABB{glm::vec3(-1.0f, -1.0f, -0.05f), glm::vec3(1.0f, 1.0f, -0.01f)})); // Between the camera and the near plane
+    }
+
+    // Splitting the tiles between the workers of a job system gives the same depths as rasterizing them on one thread
+    void testJobsMatchSingleThread(){
+        our::JobSystem jobs(4);
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> coordinate(-6.0f, 6.0f), depth(-30.0f, -1.0f);
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> triangles;
+        for(unsigned int index = 0; index < 300; ++index){
+            positions.emplace_back(coordinate(random), coordinate(random), depth(random));
+            triangles.push_back(index);
+        }
+
+        our::OcclusionBuffer single, parallel;
+        // An odd size so that the last tiles of each row and column are only partly on the screen
+        single.resize(203, 97);
+        parallel.resize(203, 97);
+        glm::mat4 camera = makeCamera() * glm::lookAt(glm::vec3(0.5f, 0.3f, 2.0f), glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        single.begin(camera);
+        parallel.begin(camera);
+        single.addOccluder(glm::mat4(1.0f), positions, triangles);
+        parallel.addOccluder(glm::mat4(1.0f), positions, triangles);
+        single.rasterize(nullptr);
+        parallel.rasterize(&jobs);
+        std::vector<float> singleDepths = readDepths(single), parallelDepths = readDepths(parallel);
+        CHECK(singleDepths == parallelDepths);
+    }
+
+    // The rows of a triangle start at its first pixel rounded down to a multiple of 4. The pixels between the two must be left alone,
+    // and the part of a triangle in the next tile must start at that tile (not at the rounded pixel, which is in the previous tile).
+    void testTileEdges(){
+        our::JobSystem jobs(4);
+        // The clip space is the screen, so with 64 pixels, the pixel x starts at "x / 32 - 1"
+        auto pixelToClip = [](float x){ return x / 32.0f - 1.0f; };
+        for(int run = 0; run < 2; ++run){
+            our::OcclusionBuffer buffer;
+            buffer.resize(64, our::OcclusionBuffer::TILE_HEIGHT);
+            buffer.begin(glm::mat4(1.0f));
+            // The first quad covers the pixels from 34 to 44 (inside the second tile, starting 2 pixels after a multiple of 4).
+            // The last one covers the pixels from 30 to 32, so its rows start at 28 over the pixels of the second quad (with a farther depth)
+            // and it crosses the border of the first two tiles at 32.
+            buffer.addOccluder(glm::mat4(1.0f), makeQuad(glm::vec2(pixelToClip(34.0f), -1.0f), glm::vec2(pixelToClip(45.0f), 1.0f), 0.0f), QUAD_TRIANGLES);
+            buffer.addOccluder(glm::mat4(1.0f), makeQuad(glm::vec2(pixelToClip(22.0f), -1.0f), glm::vec2(pixelToClip(30.0f), 1.0f), 0.5f), QUAD_TRIANGLES);
+            buffer.addOccluder(glm::mat4(1.0f), makeQuad(glm::vec2(pixelToClip(30.0f), -1.0f), glm::vec2(pixelToClip(33.0f), 1.0f), -0.5f), QUAD_TRIANGLES);
+            buffer.rasterize(run == 0 ? nullptr : &jobs);
+            for(int y = 0; y < buffer.getHeight(); ++y){
+                for(int x = 0; x < 64; ++x){
+                    float expected = 1.0f;
+                    if(x >= 34 && x < 45) expected = 0.5f;
+                    else if(x >= 22 && x < 30) expected = 0.75f;
+                    else if(x >= 30 && x < 33) expected = 0.25f;
+                    CHECK(std::abs(buffer.getDepth(x, y) - expected) < 1e-5f);
+                }
+            }
+        }
+    }
+
+}
+
+int main(){
+    testQuadHidesBoxBehind();
+    testNearPlaneClipping();
+    testBoxCrossingNearPlaneIsVisible();
+    testJobsMatchSingleThread();
+    testTileEdges();
+    return tests::report();
+}
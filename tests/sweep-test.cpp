@@ -0,0 +1,118 @@
+// The tests of the swept sphere test (see "spatial/sweep.hpp") and of the swept queries of the spatial hash (see "SpatialHash::querySwept").
+// The entities only need their transforms, so these tests only need the ECS sources (no OpenGL context or window).
+
+#include <ecs/world.hpp>
+#include <spatial/spatial-hash.hpp>
+#include <spatial/sweep.hpp>
+
+#include "check.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+    bool near(float first, float second) { return std::abs(first - second) < 1e-4f; }
+
+    // A point that crosses the whole sphere during the move hits it, even though both ends of the move are outside
+    void testPassingThroughIsHit(){
+        float time = -1.0f;
+        CHECK(our::sweepPointSphere(glm::vec3(-10, 0, 0), glm::vec3(20, 0, 0), 1.0f, time));
+        CHECK(near(time, 0.45f));
+        // The same along a diagonal that passes 0.5 away from the center
+        time = -1.0f;
+        CHECK(our::sweepPointSphere(glm::vec3(-10, 0.5f, -10), glm::vec3(20, 0, 20), 1.0f, time));
+        CHECK(time > 0.0f && time < 0.5f);
+        // A move that passes outside the sphere or stops before it is not a hit
+        CHECK(!our::sweepPointSphere(glm::vec3(-10, 2, 0), glm::vec3(20, 0, 0), 1.0f, time));
+        CHECK(!our::sweepPointSphere(glm::vec3(-10, 0, 0), glm::vec3(8, 0, 0), 1.0f, time));
+        // Touching the sphere is not being strictly closer than the radius
+        CHECK(!our::sweepPointSphere(glm::vec3(-10, 1, 0), glm::vec3(20, 0, 0), 1.0f, time));
+    }
+
+    // A point that starts inside the sphere hits it at time 0, wherever it goes
+    void testStartingInsideIsTimeZero(){
+        for(const glm::vec3& displacement : {glm::vec3(0), glm::vec3(10, 0, 0), glm::vec3(-10, 0, 0)}){
+            float time = -1.0f;
+            CHECK(our::sweepPointSphere(glm::vec3(0.5f, 0, 0), displacement, 1.0f, time));
+            CHECK(time == 0.0f);
+        }
+    }
+
+    // A point that moves away from the sphere (or doesn't move) never hits it
+    void testMovingAwayIsMiss(){
+        float time;
+        CHECK(!our::sweepPointSphere(glm::vec3(2, 0, 0), glm::vec3(10, 0, 0), 1.0f, time));
+        CHECK(!our::sweepPointSphere(glm::vec3(2, 0, 0), glm::vec3(0, 10, 0), 1.0f, time));
+        CHECK(!our::sweepPointSphere(glm::vec3(2, 0, 0), glm::vec3(0), 1.0f, time));
+    }
+
+    // A hit reported by "querySwept"
+    struct Hit {
+        our::Entity* entity;
+        glm::vec3 previous, center;
+        float time;
+    };
+
+    // Moves the car between two updates of the spatial hash, then sweeps a player from "from" to "to" against it
+    std::vector<Hit> sweepCar(const glm::vec3& carStart, const glm::vec3& carEnd, const glm::vec3& from, const glm::vec3& to, float maxMove){
+        our::World world;
+        our::Entity* car = world.add();
+        car->localTransform.position = carStart;
+        world.updateTransforms();
+        our::SpatialHash hash(2.0f);
+        hash.update(&world);
+        car->localTransform.position = carEnd;
+        world.updateTransforms();
+        hash.update(&world);
+        std::vector<Hit> hits;
+        hash.querySwept(from, to, 1.0f, maxMove, [&](our::Entity* entity, const glm::vec3& previous, const glm::vec3& center, float time){
+            hits.push_back({entity, previous, center, time});
+        });
+        return hits;
+    }
+
+    // The swept queries of the spatial hash find the cars that crossed the player between two updates
+    void testQuerySwept(){
+        // A car that passes through a standing player in one step is a hit, though it is far from the player at both updates
+        auto hits = sweepCar(glm::vec3(-10, 0, 0), glm::vec3(10, 0, 0), glm::vec3(0), glm::vec3(0), 50.0f);
+        CHECK(hits.size() == 1);
+        if(hits.size() == 1){
+            CHECK(hits[0].previous == glm::vec3(-10, 0, 0));
+            CHECK(hits[0].center == glm::vec3(10, 0, 0));
+            CHECK(near(hits[0].time, 0.45f));
+        }
+        // The same when both move: the player crosses the road while the car drives along it, and they meet at the middle of the step.
+        // Their distance is "sqrt(2) * |10 - 20 * time|", which is less than 1 a bit before the middle.
+        hits = sweepCar(glm::vec3(-10, 0, 0), glm::vec3(10, 0, 0), glm::vec3(0, 0, -10), glm::vec3(0, 0, 10), 50.0f);
+        CHECK(hits.size() == 1);
+        if(hits.size() == 1) CHECK(near(hits[0].time, 0.5f - 1.0f / (20.0f * std::sqrt(2.0f))));
+        // A car that starts inside the player's sphere is hit at time 0
+        hits = sweepCar(glm::vec3(0.5f, 0, 0), glm::vec3(10, 0, 0), glm::vec3(0), glm::vec3(0), 50.0f);
+        CHECK(hits.size() == 1);
+        if(hits.size() == 1) CHECK(hits[0].time == 0.0f);
+        // A car that drives away from the player is not a hit
+        hits = sweepCar(glm::vec3(2, 0, 0), glm::vec3(10, 0, 0), glm::vec3(0), glm::vec3(0), 50.0f);
+        CHECK(hits.empty());
+        // A car that moved further than "maxMove" was teleported, so it is only tested at its current position:
+        // it isn't a hit for crossing the player, but it is one for landing on the player
+        hits = sweepCar(glm::vec3(-10, 0, 0), glm::vec3(10, 0, 0), glm::vec3(0), glm::vec3(0), 5.0f);
+        CHECK(hits.empty());
+        hits = sweepCar(glm::vec3(30, 0, 0), glm::vec3(0.5f, 0, 0), glm::vec3(0), glm::vec3(0), 5.0f);
+        CHECK(hits.size() == 1);
+        if(hits.size() == 1){
+            CHECK(hits[0].previous == hits[0].center);
+            CHECK(hits[0].time == 0.0f);
+        }
+    }
+
+}
+
+int main(){
+    testPassingThroughIsHit();
+    testStartingInsideIsTimeZero();
+    testMovingAwayIsMiss();
+    testQuerySwept();
+    return tests::report();
+}
@@ -0,0 +1,161 @@
+// The tests of the system scheduler (see "systems/system-scheduler.hpp").
+// The systems are plain functions that record when they ran, so these tests only need the ECS and the job sources (no OpenGL context or window).
+
+#include <systems/system-scheduler.hpp>
+
+#include "check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Component types that are only used to declare accesses
+    struct Position {};
+    struct Velocity {};
+    struct Health {};
+
+    using Access = our::SystemScheduler::Access;
+
+    // The transforms can be split into groups, and only the groups that one system writes and the other touches conflict
+    void testAccessConflicts(){
+        const our::NameID player = our::internName("player"), car = our::internName("car");
+        CHECK(Access().write<Position>().conflictsWith(Access().read<Position>()));
+        CHECK(Access().read<Position>().conflictsWith(Access().write<Position>()));
+        CHECK(!Access().read<Position>().conflictsWith(Access().read<Position>()));
+        CHECK(!Access().write<Position>().conflictsWith(Access().write<Velocity>()));
+        // Reading every transform only reads the cached matrices, so two readers don't conflict
+        CHECK(!Access().read<our::Transform>().conflictsWith(Access().read<our::Transform>()));
+        CHECK(Access().read<our::Transform>().conflictsWith(Access().writeTransforms(car)));
+        CHECK(Access().write<our::Transform>().conflictsWith(Access().readTransforms<Health>()));
+        CHECK(!Access().read<our::Transform>().conflictsWith(Access().readTransforms(car)));
+        // The groups
+        CHECK(Access().writeTransforms(player).conflictsWith(Access().readTransforms(player)));
+        CHECK(Access().readTransforms(player).conflictsWith(Access().writeTransforms(player)));
+        CHECK(Access().writeTransforms<Health>().conflictsWith(Access().writeTransforms<Health>()));
+        CHECK(!Access().readTransforms(player).conflictsWith(Access().readTransforms(player)));
+        CHECK(!Access().writeTransforms(player).conflictsWith(Access().writeTransforms(car)));
+        CHECK(!Access().writeTransforms<Health>().conflictsWith(Access().writeTransforms<Velocity>()));
+        // A component type and a name with the same number are different groups
+        CHECK(!Access().writeTransforms<Health>().conflictsWith(Access().writeTransforms(our::getComponentTypeID<Health>())));
+    }
+
+    // The times at which each system of a frame started and ended, counted by a shared clock
+    struct Timeline {
+        std::atomic<int> clock{0};
+        std::vector<int> starts, ends;
+        explicit Timeline(size_t systems) : starts(systems, -1), ends(systems, -1) {}
+    };
+
+    // Waits (for a bounded time) till the flag is set and returns whether it was set
+    bool waitFor(const std::atomic<bool>& flag){
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while(!flag.load()){
+            if(std::chrono::steady_clock::now() > deadline) return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    // A graph that is not a chain runs on the job system: every system starts after the systems it depends on ended,
+    // and two independent systems run at the same time
+    void testGraphRunsConcurrently(){
+        our::JobSystem jobs(4);
+        our::World world;
+        world.updateTransforms();
+        our::SystemScheduler scheduler;
+        const our::NameID player = our::internName("player"), car = our::internName("car");
+
+        std::atomic<bool> concurrent{false}; // Set after the first frame, which is always run on the calling thread
+        std::atomic<bool> playerStarted{false}, movementStarted{false};
+        std::atomic<bool> playerSawMovement{false}, movementSawPlayer{false};
+        bool skippedRan = false;
+        Timeline* timeline = nullptr;
+        // Records the start and the end of the system, and runs "body" in between
+        auto record = [&timeline](size_t index, auto body){
+            return [&timeline, index, body](our::World*, float){
+                timeline->starts[index] = timeline->clock++;
+                body();
+                timeline->ends[index] = timeline->clock++;
+            };
+        };
+        auto nothing = [](){};
+
+        // The player and the movement systems are independent, so each one waits for the other to start
+        size_t playerSystem = scheduler.add("player", Access().writeTransforms(player), record(0, [&](){
+            if(!concurrent) return;
+            playerStarted = true;
+            playerSawMovement = waitFor(movementStarted);
+        }));
+        size_t carSystem = scheduler.add("car", Access().readTransforms(player).writeTransforms(car), record(1, nothing));
+        size_t cameraSystem = scheduler.add("camera", Access().read<Position>().readTransforms(player).writeTransforms<Health>(), record(2, nothing));
+        size_t movementSystem = scheduler.add("movement", Access().read<Velocity>().writeTransforms<Velocity>(), record(3, [&](){
+            if(!concurrent) return;
+            movementStarted = true;
+            movementSawPlayer = waitFor(playerStarted);
+        }));
+        // This system is skipped, but the systems that depend on it still run after its dependencies
+        size_t skippedSystem = scheduler.add("skipped", Access().write<Position>(), [&](our::World*, float){ skippedRan = true; },
+            [](){ return false; }, {movementSystem});
+        size_t lastSystem = scheduler.add("last", Access().read<Position>().write<our::Transform>(), record(5, nothing));
+        std::vector<std::vector<size_t>> dependencies = {
+            {}, {playerSystem}, {playerSystem}, {}, {movementSystem}, {playerSystem, carSystem, cameraSystem, movementSystem, skippedSystem}
+        };
+        // The table lists the systems in the order they were added, so it must end with the last one
+        CHECK(lastSystem + 1 == dependencies.size());
+
+        for(int frame = 0; frame < 4; ++frame){
+            Timeline frameTimeline(dependencies.size());
+            timeline = &frameTimeline;
+            concurrent = frame > 0;
+            scheduler.run(&world, 0.0f, jobs);
+            for(size_t system = 0; system < dependencies.size(); ++system){
+                if(system == skippedSystem) continue;
+                CHECK(frameTimeline.starts[system] >= 0 && frameTimeline.ends[system] > frameTimeline.starts[system]);
+                for(size_t dependency : dependencies[system])
+                    if(dependency != skippedSystem) CHECK(frameTimeline.ends[dependency] < frameTimeline.starts[system]);
+            }
+        }
+        CHECK(!skippedRan);
+        CHECK(playerSawMovement);
+        CHECK(movementSawPlayer);
+    }
+
+    // While an entity was added since the last transform update, its matrix would be computed by the first system reading it,
+    // so the systems run one after the other
+    void testPendingTransformsRunSequentially(){
+        our::JobSystem jobs(4);
+        our::World world;
+        world.updateTransforms();
+        our::SystemScheduler scheduler;
+        std::atomic<int> running{0};
+        std::atomic<bool> overlapped{false};
+        auto system = [&](our::World*, float){
+            if(++running > 1) overlapped = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --running;
+        };
+        scheduler.add("first", Access().write<Position>(), system);
+        scheduler.add("second", Access().write<Velocity>(), system);
+        scheduler.add("third", Access().write<Health>(), system);
+        scheduler.run(&world, 0.0f, jobs); // The first frame is always sequential
+        world.add();
+        CHECK(!world.areTransformsUpToDate());
+        for(int frame = 0; frame < 4; ++frame)
+            scheduler.run(&world, 0.0f, jobs);
+        CHECK(!overlapped);
+        world.updateTransforms();
+        CHECK(world.areTransformsUpToDate());
+    }
+
+}
+
+int main(){
+    testAccessConflicts();
+    testGraphRunsConcurrently();
+    testPendingTransformsRunSequentially();
+    return tests::report();
+}
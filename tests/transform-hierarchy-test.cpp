@@ -0,0 +1,102 @@
+// The tests of the world matrices computed by the transform hierarchy (see "ecs/transform-hierarchy.hpp").
+// The hierarchy builds the local matrices 4 at a time with an approximated sine and cosine, so its matrices are compared
+// with "Transform::toMat4" multiplied through the parents. Only the ECS sources are needed (no OpenGL context or window).
+
+#include <ecs/world.hpp>
+#include <jobs/job-system.hpp>
+
+#include "check.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+    // The largest error of the world matrices relative to the largest element of the expected matrix.
+    // It is about 1e-5 for the hierarchy below, while a 1% error in one coefficient of the approximation already gives about 3e-3.
+    constexpr float TOLERANCE = 2e-4f;
+
+    constexpr int ENTITY_COUNT = 2001; // Not a multiple of 4, so the last group of local matrices is padded
+    constexpr int LEVELS = 8;
+
+    std::uniform_real_distribution<float> uniform(float low, float high) { return std::uniform_real_distribution<float>(low, high); }
+
+    // Gives the entity a random transform with angles up to 20 radians (several turns) in both directions
+    void randomize(our::Entity* entity, std::mt19937& random){
+        entity->localTransform.position = glm::vec3(uniform(-10.0f, 10.0f)(random), uniform(-10.0f, 10.0f)(random), uniform(-10.0f, 10.0f)(random));
+        entity->localTransform.rotation = glm::vec3(uniform(-20.0f, 20.0f)(random), uniform(-20.0f, 20.0f)(random), uniform(-20.0f, 20.0f)(random));
+        entity->localTransform.scale = glm::vec3(uniform(0.7f, 1.4f)(random), uniform(0.7f, 1.4f)(random), uniform(0.7f, 1.4f)(random));
+    }
+
+    // The local matrices from "Transform::toMat4" multiplied through the parents
+    glm::mat4 expectedMatrix(const our::Entity* entity){
+        glm::mat4 matrix = entity->localTransform.toMat4();
+        for(const our::Entity* parent = entity->getParent(); parent; parent = parent->getParent())
+            matrix = parent->localTransform.toMat4() * matrix;
+        return matrix;
+    }
+
+    // Returns the largest relative error of the world matrices of the entities
+    float largestError(const std::vector<our::Entity*>& entities){
+        float largest = 0.0f;
+        for(const our::Entity* entity : entities){
+            glm::mat4 expected = expectedMatrix(entity);
+            const glm::mat4& computed = entity->getLocalToWorldMatrix();
+            float size = 0.0f, error = 0.0f;
+            for(int column = 0; column < 4; ++column)
+                for(int row = 0; row < 4; ++row){
+                    size = std::max(size, std::abs(expected[column][row]));
+                    error = std::max(error, std::abs(computed[column][row] - expected[column][row]));
+                }
+            largest = std::max(largest, error / size);
+        }
+        return largest;
+    }
+
+    // A random hierarchy 8 levels deep: every entity after the first level gets a random parent from the level above
+    void testRandomHierarchy(){
+        std::mt19937 random(7);
+        our::World world;
+        std::vector<our::Entity*> entities;
+        std::vector<std::vector<our::Entity*>> levels(LEVELS);
+        for(int index = 0; index < ENTITY_COUNT; ++index){
+            int level = index * LEVELS / ENTITY_COUNT;
+            our::Entity* entity = world.add();
+            randomize(entity, random);
+            if(level > 0){
+                const auto& above = levels[level - 1];
+                entity->setParent(above[random() % above.size()]);
+            }
+            levels[level].push_back(entity);
+            entities.push_back(entity);
+        }
+        world.updateTransforms();
+        CHECK(largestError(entities) < TOLERANCE);
+
+        // Then only a few transforms change (an odd number, so the changed transforms don't fill the groups of 4),
+        // a subtree moves to another parent, and the matrices are computed by the job system
+        our::JobSystem jobs(4);
+        for(int change = 0; change < 37; ++change) randomize(entities[random() % entities.size()], random);
+        levels[3][0]->setParent(levels[1][1]);
+        world.updateTransforms(&jobs);
+        CHECK(largestError(entities) < TOLERANCE);
+
+        // The angles that are multiples of pi/2 (where the approximation switches between the sine and the cosine) are exact enough too
+        for(int index = 0; index < 40; ++index){
+            float angle = float(index - 20) * glm::half_pi<float>();
+            entities[index]->localTransform.rotation = glm::vec3(angle, -angle, angle * 0.5f);
+        }
+        world.updateTransforms();
+        CHECK(largestError(entities) < TOLERANCE);
+    }
+
+}
+
+int main(){
+    testRandomHierarchy();
+    return tests::report();
+}
@@ -0,0 +1,260 @@
+// The tests of the ray and shape queries of the world (see "World::raycast") and of the intersection tests they use (see "spatial/intersection.hpp").
+// The meshes are built by hand. Their constructor uploads them with OpenGL, so the few GL functions it calls are replaced by functions that do nothing.
+
+#include <ecs/world.hpp>
+#include <components/mesh-renderer.hpp>
+#include <spatial/intersection.hpp>
+
+#include "check.hpp"
+#include "gl-stubs.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+    bool near(float first, float second) { return std::abs(first - second) < 1e-4f; }
+    bool near(const glm::vec3& first, const glm::vec3& second) { return glm::all(glm::lessThan(glm::abs(first - second), glm::vec3(1e-4f))); }
+
+    std::unique_ptr<our::Mesh> makeMesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& elements){
+        std::vector<our::Vertex> vertices;
+        for(const glm::vec3& position : positions) vertices.push_back({position, our::Color(255), glm::vec2(0), glm::vec3(0)});
+        return std::make_unique<our::Mesh>(vertices, elements);
+    }
+
+    // The scene shared by the query tests:
+    //  - 3 walls (2x2 squares facing the Z axis) at z = 5, 10 and 15
+    //  - a ramp (the plane x + y = 1 in its local space) under a parent at x = -10 that scales it by (2, 1, 1)
+    //  - a box at z = -5 (scaled by 2 along Y) that has no triangles
+    struct Scene {
+        std::unique_ptr<our::Mesh> square, ramp;
+        our::World world;
+        our::Entity* walls[3];
+        our::Entity* rampEntity;
+        our::Entity* box;
+
+        Scene(){
+            square = makeMesh({{-1, -1, 0}, {1, -1, 0}, {1, 1, 0}, {-1, 1, 0}}, {0, 1, 2, 0, 2, 3});
+            ramp = makeMesh({{1, 0, -1}, {0, 1, -1}, {0, 1, 1}, {1, 0, 1}}, {0, 1, 2, 0, 2, 3});
+            for(int index = 0; index < 3; ++index){
+                walls[index] = world.add();
+                walls[index]->localTransform.position = glm::vec3(0, 0, 5.0f * (index + 1));
+                walls[index]->addComponent<our::MeshRendererComponent>()->mesh = square.get();
+            }
+            our::Entity* scaler = world.add();
+            scaler->localTransform.position = glm::vec3(-10, 0, 0);
+            scaler->localTransform.scale = glm::vec3(2, 1, 1);
+            rampEntity = world.add();
+            rampEntity->setParent(scaler);
+            rampEntity->addComponent<our::MeshRendererComponent>()->mesh = ramp.get();
+            box = world.add();
+            box->localTransform.position = glm::vec3(0, 0, -5);
+            box->localTransform.scale = glm::vec3(1, 2, 1);
+            box->addComponent<tests::BoxComponent>()->box = our::AABB(glm::vec3(-0.5f), glm::vec3(0.5f));
+            world.updateTransforms();
+        }
+    };
+
+    // The ray hits are sorted from the closest to the farthest, and their distances and points are in the world space
+    void testRaycast(){
+        Scene scene;
+        std::vector<our::QueryHit> hits;
+        CHECK(scene.world.raycast(glm::vec3(0.5f, 0.25f, 0), glm::vec3(0, 0, 1), 100.0f, hits));
+        CHECK(hits.size() == 3);
+        for(size_t index = 0; index < hits.size() && index < 3; ++index){
+            float z = 5.0f * (index + 1);
+            CHECK(hits[index].entity == scene.walls[index]);
+            CHECK(near(hits[index].distance, z));
+            CHECK(near(hits[index].point, glm::vec3(0.5f, 0.25f, z)));
+            CHECK(near(hits[index].normal, glm::vec3(0, 0, -1)));
+        }
+        // The direction doesn't need to be normalized and the distances are still in world units
+        CHECK(scene.world.raycast(glm::vec3(0, 0, 20), glm::vec3(0, 0, -4), 12.0f, hits));
+        CHECK(hits.size() == 2 && hits[0].entity == scene.walls[2] && hits[1].entity == scene.walls[1]);
+        CHECK(near(hits[0].distance, 5.0f) && near(hits[1].distance, 10.0f));
+        CHECK(near(hits[0].normal, glm::vec3(0, 0, 1)));
+        // The filter skips entities, and a ray that misses every triangle hits nothing (even though it enters the bounds of the ramp)
+        CHECK(scene.world.raycast(glm::vec3(0), glm::vec3(0, 0, 1), 100.0f, hits, [&](const our::Entity* entity){ return entity != scene.walls[0]; }));
+        CHECK(hits.size() == 2 && hits[0].entity == scene.walls[1]);
+        CHECK(!scene.world.raycast(glm::vec3(-8.5f, 0.5f, -5), glm::vec3(0, 0, 1), 100.0f, hits));
+        CHECK(hits.empty());
+        CHECK(!scene.world.raycast(glm::vec3(0), glm::vec3(0), 100.0f, hits));
+    }
+
+    // The normals stay perpendicular to the surface after a non uniform scale (they are transformed by the inverse transpose),
+    // and they face the origin of the ray (or the center of the shape)
+    void testNormalsUnderNonUniformScale(){
+        Scene scene;
+        // In the world space, the ramp is the plane (x + 10) / 2 + y = 1
+        const glm::vec3 origin(-10, 0, 0);
+        glm::vec3 surfaceNormal = glm::normalize(glm::vec3(0.5f, 1, 0));
+        std::vector<our::QueryHit> hits;
+        CHECK(scene.world.raycast(origin, glm::vec3(1, 1, 0), 100.0f, hits));
+        CHECK(hits.size() == 1 && hits[0].entity == scene.rampEntity);
+        if(!hits.empty()){
+            CHECK(near(hits[0].point, origin + glm::vec3(2.0f / 3.0f, 2.0f / 3.0f, 0)));
+            CHECK(near(hits[0].distance, glm::length(glm::vec3(2.0f / 3.0f, 2.0f / 3.0f, 0))));
+            CHECK(near(hits[0].normal, -surfaceNormal));
+        }
+        // From the other side, the normal is flipped
+        CHECK(scene.world.raycast(origin + glm::vec3(2, 2, 0), glm::vec3(-1, -1, 0), 100.0f, hits));
+        CHECK(hits.size() == 1 && near(hits[0].normal, surfaceNormal));
+        // The closest point of the ramp to the origin is along its normal
+        CHECK(scene.world.overlapSphere(origin, 1.0f, hits));
+        CHECK(hits.size() == 1 && hits[0].entity == scene.rampEntity);
+        if(!hits.empty()){
+            float distance = 1.0f / glm::length(glm::vec2(0.5f, 1));
+            CHECK(near(hits[0].distance, distance));
+            CHECK(near(hits[0].point, origin + surfaceNormal * distance));
+            CHECK(near(hits[0].normal, -surfaceNormal));
+        }
+    }
+
+    // "raycastClosest" finds the first hit and skips the bounds behind its best hit so far
+    void testRaycastClosest(){
+        Scene scene;
+        // More walls, so that many bounds are behind the first hit whatever the order of the tree
+        std::vector<our::Entity*> walls(scene.walls, scene.walls + 3);
+        for(int index = 3; index < 12; ++index){
+            our::Entity* wall = scene.world.add();
+            wall->localTransform.position = glm::vec3(0, 0, 5.0f * (index + 1));
+            wall->addComponent<our::MeshRendererComponent>()->mesh = scene.square.get();
+            walls.push_back(wall);
+        }
+        scene.world.updateTransforms();
+        size_t allTested = 0, closestTested = 0;
+        std::vector<our::QueryHit> hits;
+        scene.world.raycast(glm::vec3(0), glm::vec3(0, 0, 1), 1000.0f, hits, [&](const our::Entity*){ ++allTested; return true; });
+        CHECK(hits.size() == walls.size());
+        CHECK(allTested == walls.size());
+
+        our::QueryHit hit;
+        CHECK(scene.world.raycastClosest(glm::vec3(0), glm::vec3(0, 0, 1), 1000.0f, hit, [&](const our::Entity*){ ++closestTested; return true; }));
+        CHECK(hit.entity == walls[0] && near(hit.distance, 5.0f) && near(hit.point, glm::vec3(0, 0, 5)) && near(hit.normal, glm::vec3(0, 0, -1)));
+        CHECK(closestTested < allTested);
+        // The ray from the far end finds the last wall
+        CHECK(scene.world.raycastClosest(glm::vec3(0, 0, 100), glm::vec3(0, 0, -1), 1000.0f, hit));
+        CHECK(hit.entity == walls.back() && near(hit.distance, 40.0f));
+        // The filtered entities are not hits, so the next one is found
+        CHECK(scene.world.raycastClosest(glm::vec3(0), glm::vec3(0, 0, 1), 1000.0f, hit, [&](const our::Entity* entity){ return entity != walls[0]; }));
+        CHECK(hit.entity == walls[1]);
+        // Nothing is hit before the maximum distance
+        CHECK(!scene.world.raycastClosest(glm::vec3(0), glm::vec3(0, 0, 1), 4.0f, hit));
+    }
+
+    // An entity without triangles is hit on its world bounds, with the normal of the face that the ray enters (or that is the closest to the shape)
+    void testBoxFallback(){
+        Scene scene;
+        std::vector<our::QueryHit> hits;
+        our::QueryHit hit;
+        // The box spans x in [-0.5, 0.5], y in [-1, 1] and z in [-5.5, -4.5]
+        CHECK(scene.world.raycastClosest(glm::vec3(0), glm::vec3(0, 0, -1), 100.0f, hit));
+        CHECK(hit.entity == scene.box && near(hit.distance, 4.5f) && near(hit.point, glm::vec3(0, 0, -4.5f)) && near(hit.normal, glm::vec3(0, 0, 1)));
+        CHECK(scene.world.raycastClosest(glm::vec3(0, 5, -5), glm::vec3(0, -1, 0), 100.0f, hit));
+        CHECK(hit.entity == scene.box && near(hit.distance, 4.0f) && near(hit.normal, glm::vec3(0, 1, 0)));
+
+        CHECK(scene.world.overlapSphere(glm::vec3(0, 0, -3), 2.0f, hits));
+        CHECK(hits.size() == 1 && hits[0].entity == scene.box);
+        if(!hits.empty()){
+            CHECK(near(hits[0].distance, 1.5f));
+            CHECK(near(hits[0].point, glm::vec3(0, 0, -4.5f)));
+            CHECK(near(hits[0].normal, glm::vec3(0, 0, 1)));
+        }
+        CHECK(!scene.world.overlapSphere(glm::vec3(0, 0, -3), 1.4f, hits));
+        // A center inside the box gives the normal of the nearest face
+        CHECK(scene.world.overlapSphere(glm::vec3(0, 0.8f, -5), 0.1f, hits));
+        CHECK(hits.size() == 1 && hits[0].distance == 0.0f && near(hits[0].normal, glm::vec3(0, 1, 0)));
+        CHECK(scene.world.overlapBox(our::AABB(glm::vec3(0.4f, -0.1f, -5.1f), glm::vec3(0.7f, 0.1f, -4.9f)), hits));
+        CHECK(hits.size() == 1 && hits[0].entity == scene.box && near(hits[0].point, glm::vec3(0.5f, 0, -5)));
+        CHECK(near(hits[0].normal, glm::vec3(1, 0, 0)));
+    }
+
+    // The shape hits are the closest points of the triangles to the shape's center, sorted by distance
+    void testOverlaps(){
+        Scene scene;
+        std::vector<our::QueryHit> hits;
+        CHECK(scene.world.overlapSphere(glm::vec3(0.5f, 0, 8), 3.5f, hits));
+        CHECK(hits.size() == 2);
+        if(hits.size() == 2){
+            CHECK(hits[0].entity == scene.walls[1] && near(hits[0].distance, 2.0f) && near(hits[0].point, glm::vec3(0.5f, 0, 10)));
+            CHECK(near(hits[0].normal, glm::vec3(0, 0, -1)));
+            CHECK(hits[1].entity == scene.walls[0] && near(hits[1].distance, 3.0f) && near(hits[1].point, glm::vec3(0.5f, 0, 5)));
+            CHECK(near(hits[1].normal, glm::vec3(0, 0, 1)));
+        }
+        // Outside the edge of a wall, the closest point is on the edge
+        CHECK(scene.world.overlapSphere(glm::vec3(2, 0, 5.5f), 1.5f, hits));
+        CHECK(hits.size() == 1 && near(hits[0].point, glm::vec3(1, 0, 5)) && near(hits[0].distance, std::sqrt(1.25f)));
+        CHECK(!scene.world.overlapSphere(glm::vec3(2, 0, 5.5f), 1.0f, hits));
+
+        CHECK(scene.world.overlapBox(our::AABB(glm::vec3(0.25f, 0.25f, 4.75f), glm::vec3(0.75f, 0.75f, 10.25f)), hits));
+        CHECK(hits.size() == 2);
+        if(hits.size() == 2){
+            // The center (z = 7.5) is as far from both walls, so only the points are checked
+            CHECK(near(hits[0].point.x, 0.5f) && near(hits[0].point.y, 0.5f) && near(hits[0].distance, 2.5f));
+            CHECK(hits[0].entity != hits[1].entity);
+        }
+        // Between the walls without touching them, and with a filter
+        CHECK(!scene.world.overlapBox(our::AABB(glm::vec3(-1, -1, 6), glm::vec3(1, 1, 9)), hits));
+        CHECK(scene.world.overlapBox(our::AABB(glm::vec3(-1, -1, 4), glm::vec3(1, 1, 11)), hits,
+            [&](const our::Entity* entity){ return entity == scene.walls[1]; }));
+        CHECK(hits.size() == 1 && hits[0].entity == scene.walls[1]);
+    }
+
+    // The closest point is found in the regions of the vertices, of the edges and of the face, and a degenerate triangle gives a finite point
+    void testClosestPointOnTriangle(){
+        glm::vec3 a(0, 0, 0), b(1, 0, 0), c(0, 1, 0);
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(-1, -1, 0), a, b, c), a));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(2, -0.5f, 1), a, b, c), b));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(-0.5f, 2, -1), a, b, c), c));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(0.5f, -1, 0), a, b, c), glm::vec3(0.5f, 0, 0)));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(-1, 0.25f, 2), a, b, c), glm::vec3(0, 0.25f, 0)));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(1, 1, 0), a, b, c), glm::vec3(0.5f, 0.5f, 0)));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(0.25f, 0.25f, 3), a, b, c), glm::vec3(0.25f, 0.25f, 0)));
+        // Points on the triangle are their own closest points
+        CHECK(near(our::closestPointOnTriangle(b, a, b, c), b));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(0.5f, 0.5f, 0), a, b, c), glm::vec3(0.5f, 0.5f, 0)));
+        // A triangle whose vertices are on a line is a segment, and a triangle whose vertices are the same is a point
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(0.5f, 1, 0), a, b, glm::vec3(2, 0, 0)), glm::vec3(0.5f, 0, 0)));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(3, 1, 0), a, b, glm::vec3(2, 0, 0)), glm::vec3(2, 0, 0)));
+        CHECK(near(our::closestPointOnTriangle(glm::vec3(1, 2, 3), b, b, b), b));
+    }
+
+    // Each of the separating axes can be the only one that separates a triangle from a box
+    void testTriangleOverlapsBox(){
+        our::AABB box(glm::vec3(-1), glm::vec3(1));
+        // A triangle through the box without any vertex inside it, and one that is inside the box
+        CHECK(our::triangleOverlapsBox(glm::vec3(-5, -5, 0), glm::vec3(5, -5, 0), glm::vec3(0, 5, 0), box));
+        CHECK(our::triangleOverlapsBox(glm::vec3(-0.1f, 0, 0), glm::vec3(0.1f, 0, 0), glm::vec3(0, 0.1f, 0), box));
+        // The box axes
+        CHECK(!our::triangleOverlapsBox(glm::vec3(1.5f, -5, -5), glm::vec3(1.5f, 5, -5), glm::vec3(1.5f, 0, 5), box));
+        // Touching a face or a corner counts as overlapping
+        CHECK(our::triangleOverlapsBox(glm::vec3(1, -5, -5), glm::vec3(1, 5, -5), glm::vec3(1, 0, 5), box));
+        CHECK(our::triangleOverlapsBox(glm::vec3(1, 1, 1), glm::vec3(3, 1, 1), glm::vec3(1, 3, 1), box));
+        // The triangle's normal: the plane x + y + z = d misses the box's corner (1, 1, 1) when d > 3, but the bounds overlap the box
+        CHECK(!our::triangleOverlapsBox(glm::vec3(3.5f, 0, 0), glm::vec3(0, 3.5f, 0), glm::vec3(0, 0, 3.5f), box));
+        CHECK(our::triangleOverlapsBox(glm::vec3(2.9f, 0, 0), glm::vec3(0, 2.9f, 0), glm::vec3(0, 0, 2.9f), box));
+        // An edge axis: a degenerate triangle (a segment on the line x + y = 2.5) has no normal and its bounds overlap the box
+        glm::vec3 start(0, 2.5f, 0), end(2.5f, 0, 0);
+        CHECK(!our::triangleOverlapsBox(start, end, (start + end) * 0.5f, box));
+        CHECK(our::triangleOverlapsBox(glm::vec3(0, 1.5f, 0), glm::vec3(1.5f, 0, 0), glm::vec3(0.75f, 0.75f, 0), box));
+        // An off-center box
+        our::AABB shifted(glm::vec3(10, 10, 10), glm::vec3(11, 12, 13));
+        CHECK(our::triangleOverlapsBox(glm::vec3(10.5f, 11, 0), glm::vec3(10.5f, 11, 20), glm::vec3(30, 11, 10), shifted));
+        CHECK(!our::triangleOverlapsBox(glm::vec3(10.5f, 12.5f, 0), glm::vec3(10.5f, 12.5f, 20), glm::vec3(30, 12.5f, 10), shifted));
+    }
+
+}
+
+int main(){
+    gl_stubs::install();
+    testRaycast();
+    testNormalsUnderNonUniformScale();
+    testRaycastClosest();
+    testBoxFallback();
+    testOverlaps();
+    testClosestPointOnTriangle();
+    testTriangleOverlapsBox();
+    return tests::report();
+}
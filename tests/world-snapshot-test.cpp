@@ -0,0 +1,154 @@
+// The tests of the world snapshots (see "World::snapshot" and "World::restore"), which restart the level.
+// The entities only have boxes (no meshes), so these tests only need the ECS sources (no OpenGL context or window).
+// The parents are changed with "Entity::setParent", which asserts that no cycle is formed, so these tests must be built with the asserts.
+
+#include <ecs/world.hpp>
+
+#include "check.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+    // The level saved by the tests:
+    //  - "a": a root entity with the tag "road"
+    //  - "b": a child of "a"
+    //  - "c": a root entity with the tags "road" and "edge"
+    // Every entity has a box whose size tells it apart from the others.
+    struct Level {
+        our::World world;
+        our::Entity *a, *b, *c;
+        our::EntityHandle handles[3];
+
+        Level(){
+            a = world.add();
+            b = world.add();
+            c = world.add();
+            a->setName("a");
+            b->setName("b");
+            c->setName("c");
+            a->addTag(our::internName("road"));
+            c->addTag(our::internName("road"));
+            c->addTag(our::internName("edge"));
+            b->setParent(a);
+            our::Entity* entities[3] = {a, b, c};
+            for(int index = 0; index < 3; ++index){
+                entities[index]->localTransform.position = glm::vec3(float(index + 1), 0, 0);
+                entities[index]->addComponent<tests::BoxComponent>()->box = our::AABB(glm::vec3(0), glm::vec3(float(index + 1)));
+                handles[index] = entities[index]->getHandle();
+            }
+        }
+    };
+
+    float boxSize(our::Entity* entity) { return entity->getComponent<tests::BoxComponent>()->box.max.x; }
+
+    bool hasTags(our::Entity* entity, const std::vector<our::NameID>& tags){
+        return entity->getTags().size() == tags.size() && std::all_of(tags.begin(), tags.end(), [&](our::NameID tag){ return entity->hasTag(tag); });
+    }
+
+    bool contains(const std::vector<our::Entity*>& entities, our::Entity* entity){
+        return std::find(entities.begin(), entities.end(), entity) != entities.end();
+    }
+
+    // If the world still holds the saved entities with the same components, the data is copied in place:
+    // the handles stay valid, the hierarchy, the names and the tags are put back and the observers see MODIFIED events
+    void testRestoreInPlace(){
+        Level level;
+        our::World& world = level.world;
+        our::WorldSnapshot snapshot;
+        world.snapshot(snapshot);
+        CHECK(snapshot.size() == 3);
+        std::uint32_t restoreCount = world.getRestoreCount();
+        int modified = 0;
+        world.observe<tests::BoxComponent>(our::ComponentEvent::MODIFIED, [&](tests::BoxComponent*){ ++modified; });
+
+        // The parent and the child are swapped, so putting "b" back under "a" before detaching "a" from "b" would form a cycle
+        level.b->setParent(nullptr);
+        level.a->setParent(level.b);
+        level.c->setParent(level.a);
+        level.b->setName("renamed");
+        level.c->removeTag(our::internName("edge"));
+        level.c->addTag(our::internName("finish"));
+        level.a->localTransform.position = glm::vec3(0, 7, 0);
+        level.b->getComponent<tests::BoxComponent>()->box = our::AABB(glm::vec3(0), glm::vec3(9));
+        world.markForRemoval(level.c);
+
+        world.restore(snapshot);
+        CHECK(world.getRestoreCount() != restoreCount);
+        for(int index = 0; index < 3; ++index) CHECK(world.get(level.handles[index]) != nullptr);
+        CHECK(world.get(level.handles[0]) == level.a && world.get(level.handles[1]) == level.b && world.get(level.handles[2]) == level.c);
+        CHECK(modified == 3);
+
+        CHECK(level.a->getParent() == nullptr);
+        CHECK(level.b->getParent() == level.a);
+        CHECK(level.c->getParent() == nullptr);
+        CHECK(level.a->localTransform.position == glm::vec3(1, 0, 0));
+        world.updateTransforms();
+        CHECK(glm::vec3(level.b->getLocalToWorldMatrix()[3]) == glm::vec3(3, 0, 0));
+
+        CHECK(world.findByName("b") == level.b);
+        CHECK(world.findByName("renamed") == nullptr);
+        CHECK(hasTags(level.c, {our::internName("road"), our::internName("edge")}));
+        CHECK(contains(world.findAllByTag("edge"), level.c));
+        CHECK(world.findAllByTag("finish").empty());
+        CHECK(boxSize(level.b) == 2.0f);
+
+        // The entity that was marked for removal after the snapshot is kept, since it exists in the snapshot
+        world.deleteMarkedEntities();
+        CHECK(world.get(level.handles[2]) == level.c);
+        CHECK(world.getEntities().size() == 3);
+    }
+
+    // If entities were added or deleted since the snapshot, the world is rebuilt: the old handles become stale,
+    // and the new entities get the saved names, tags, parents, transforms and component data
+    void testRestoreByRebuild(){
+        Level level;
+        our::World& world = level.world;
+        our::WorldSnapshot snapshot;
+        world.snapshot(snapshot);
+        std::uint32_t restoreCount = world.getRestoreCount();
+        int added = 0;
+        world.observe<tests::BoxComponent>(our::ComponentEvent::ADDED, [&](tests::BoxComponent* box){ if(box->box.max.x > 0.0f) ++added; });
+
+        our::Entity* spawned = world.add();
+        spawned->setName("spawned");
+        world.markForRemoval(level.b);
+        world.deleteMarkedEntities();
+        world.markForRemoval(level.c);
+
+        world.restore(snapshot);
+        CHECK(world.getRestoreCount() != restoreCount);
+        for(int index = 0; index < 3; ++index) CHECK(world.get(level.handles[index]) == nullptr);
+        CHECK(world.getEntities().size() == 3);
+        CHECK(world.findByName("spawned") == nullptr);
+        // The observers see the restored data when the components are added
+        CHECK(added == 3);
+
+        our::Entity* a = world.findByName("a");
+        our::Entity* b = world.findByName("b");
+        our::Entity* c = world.findByName("c");
+        CHECK(a && b && c);
+        if(!(a && b && c)) return;
+        CHECK(a->getParent() == nullptr && b->getParent() == a && c->getParent() == nullptr);
+        CHECK(hasTags(a, {our::internName("road")}));
+        CHECK(hasTags(b, {}));
+        CHECK(hasTags(c, {our::internName("road"), our::internName("edge")}));
+        CHECK(world.findAllByTag("road").size() == 2);
+        CHECK(boxSize(a) == 1.0f && boxSize(b) == 2.0f && boxSize(c) == 3.0f);
+        world.updateTransforms();
+        CHECK(glm::vec3(b->getLocalToWorldMatrix()[3]) == glm::vec3(3, 0, 0));
+
+        // The entity that was marked for removal before the rebuild is gone, so nothing is deleted
+        world.deleteMarkedEntities();
+        CHECK(world.getEntities().size() == 3);
+        CHECK(world.findByName("c") == c);
+    }
+
+}
+
+int main(){
+    testRestoreInPlace();
+    testRestoreByRebuild();
+    return tests::report();
+}